@@ -0,0 +1,97 @@
+#include "ce.h"
+#include "ce_syntax.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <locale.h>
+
+FILE* g_ce_log = NULL;
+CeBuffer_t* g_ce_log_buffer = NULL;
+
+#define BENCH_LINE_COUNT 32
+#define BENCH_ITERATIONS 20
+
+static uint64_t now_usec(){
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return (uint64_t)(now.tv_sec) * 1000000ULL + (uint64_t)(now.tv_nsec / 1000);
+}
+
+// a mix of the things the c highlighter matches, with a multibyte rune thrown in
+static char* build_line(int64_t columns){
+     const char* pattern = "int x = 42; if(x) return \"héllo\"; /* NOTE */ ";
+     int64_t pattern_len = ce_utf8_strlen(pattern);
+     int64_t pattern_bytes = strlen(pattern);
+     int64_t repeats = (columns + pattern_len - 1) / pattern_len;
+     char* line = malloc(repeats * pattern_bytes + 1);
+     if(!line) return NULL;
+     for(int64_t i = 0; i < repeats; i++) memcpy(line + i * pattern_bytes, pattern, pattern_bytes);
+     line[repeats * pattern_bytes] = 0;
+     return line;
+}
+
+// roughly what ce_syntax_highlight_c() knows about, written as a syntax file
+static const char* c_language_definition =
+     "extensions .c .h\n"
+     "line_comment //\n"
+     "block_comment /* */\n"
+     "string \" \\\n"
+     "char ' \\\n"
+     "keywords type bool char double float int long short signed unsigned void\n"
+     "keywords keyword auto case default do else enum extern false for if inline register sizeof static struct switch\n"
+     "keywords keyword true typedef typeof union volatile while\n"
+     "keywords control break const continue goto return\n"
+     "numbers\n"
+     "caps_vars\n";
+
+static void bench_columns(const char* name, CeSyntaxHighlightFunc_t* syntax_function, void* user_data, int64_t columns){
+     CeBuffer_t buffer = {};
+     if(!ce_buffer_alloc(&buffer, BENCH_LINE_COUNT, "bench.c")) return;
+     for(int64_t y = 0; y < BENCH_LINE_COUNT; y++){
+          free(buffer.lines[y]);
+          buffer.lines[y] = build_line(columns);
+     }
+
+     CeView_t view = {};
+     view.buffer = &buffer;
+     view.rect = (CeRect_t){0, columns, 0, BENCH_LINE_COUNT - 1};
+
+     CeSyntaxDef_t syntax_defs[CE_SYNTAX_COLOR_COUNT] = {};
+     CeRangeList_t range_list = {};
+
+     uint64_t start = now_usec();
+     for(int64_t i = 0; i < BENCH_ITERATIONS; i++){
+          CeDrawColorList_t draw_color_list = {};
+          syntax_function(&view, &range_list, &draw_color_list, syntax_defs, user_data);
+          ce_draw_color_list_free(&draw_color_list);
+     }
+     uint64_t elapsed = now_usec() - start;
+
+     int64_t total_columns = columns * BENCH_LINE_COUNT * BENCH_ITERATIONS;
+     printf("%-9s %6ld columns: %8lu us per frame, %6.1f ns per column\n", name, columns, elapsed / BENCH_ITERATIONS,
+            ((double)(elapsed) * 1000.0) / (double)(total_columns));
+
+     ce_buffer_free(&buffer);
+}
+
+int main(){
+     setlocale(LC_ALL, "");
+
+     // ns per column should stay flat as lines get longer if highlighting is linear in the line length
+     int64_t columns[] = {1000, 2000, 5000, 10000};
+     for(size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++){
+          bench_columns("c", ce_syntax_highlight_c, NULL, columns[i]);
+     }
+
+     // the table driven lexer should keep up with the hand written one
+     CeSyntaxLanguage_t language = {};
+     if(!ce_syntax_language_load_string(&language, c_language_definition, "c")) return 1;
+     for(size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++){
+          bench_columns("c.syntax", ce_syntax_highlight_language, &language, columns[i]);
+     }
+     ce_syntax_language_free(&language);
+
+     return 0;
+}
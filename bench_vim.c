@@ -0,0 +1,74 @@
+#include "ce.h"
+#include "ce_vim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <locale.h>
+
+FILE* g_ce_log = NULL;
+CeBuffer_t* g_ce_log_buffer = NULL;
+
+#define BENCH_LINE_COUNT 200
+#define BENCH_REPLAYS 20000
+
+static uint64_t now_usec(){
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return (uint64_t)(now.tv_sec) * 1000000ULL + (uint64_t)(now.tv_nsec / 1000);
+}
+
+// replay a macro the way the app does, one key at a time through vim, and report the cost per key
+static void bench_replay(const char* name, const char* macro){
+     CeBuffer_t buffer = {};
+     if(!ce_buffer_alloc(&buffer, BENCH_LINE_COUNT, "bench.c")) return;
+     for(int64_t y = 0; y < BENCH_LINE_COUNT; y++){
+          free(buffer.lines[y]);
+          buffer.lines[y] = strdup("     int value = compute(first, second); // trailing words to move across");
+     }
+
+     CeView_t view = {};
+     view.buffer = &buffer;
+     view.rect = (CeRect_t){0, 120, 0, 40};
+
+     CeVim_t vim = {};
+     ce_vim_init(&vim);
+
+     CeConfigOptions_t config_options = {};
+     config_options.tab_width = 5;
+     config_options.insert_spaces_on_tab = true;
+
+     CeVimVisualData_t visual = {};
+     CeVimBufferData_t buffer_data = {};
+     int64_t macro_len = strlen(macro);
+
+     uint64_t start = now_usec();
+     for(int64_t r = 0; r < BENCH_REPLAYS; r++){
+          view.cursor = (CePoint_t){0, 0};
+          for(int64_t k = 0; k < macro_len; k++){
+               ce_vim_handle_key(&vim, &view, &view.cursor, &visual, macro[k], &buffer_data, &config_options, true);
+          }
+     }
+     uint64_t elapsed = now_usec() - start;
+
+     int64_t total_keys = macro_len * BENCH_REPLAYS;
+     printf("%-8s %8ld keys: %8lu us, %6.1f ns per key\n", name, total_keys, elapsed,
+            ((double)(elapsed) * 1000.0) / (double)(total_keys));
+
+     ce_vim_free(&vim);
+     ce_buffer_free(&buffer);
+}
+
+int main(){
+     setlocale(LC_ALL, "");
+
+     // keys near the end of the bind list cost the most to find with a linear search
+     bench_replay("motions", "wwwbbbeeejjjkkkllhhWWBBEE$0^GHML");
+     bench_replay("finds", "fctvFcTv;,;,");
+     bench_replay("edits", "xuddujjyypuuJu~~uu");
+     // counted motions should cost the same as a single one
+     bench_replay("counts", "150j150k40l40h3ddu5xu");
+
+     return 0;
+}
@@ -9,6 +9,8 @@
 #include <time.h>
 #include <assert.h>
 #include <ctype.h>
+#include <strings.h>
+#include <pthread.h>
 #include <ncurses.h>
 #include <sys/stat.h>
 
@@ -17,7 +19,12 @@ static void ce_buffer_change_node_free(CeBufferChangeNode_t** head){
      while(itr){
           CeBufferChangeNode_t* tmp = itr;
           itr = itr->next;
-          free(tmp->change.string);
+          if(tmp->change.shared_string){
+               ce_shared_string_release(tmp->change.string);
+          }else{
+               free(tmp->change.string);
+          }
+          free(tmp->change.points);
           free(tmp);
      }
 
@@ -96,6 +103,88 @@ static bool buffer_realloc_lines(CeBuffer_t* buffer, int64_t new_line_count){
      return true;
 }
 
+// the lexer state at the start of a line only depends on the lines above it
+static void buffer_invalidate_lexer_states_after(CeBuffer_t* buffer, int64_t line){
+     if(buffer->lexer_state_cache.valid_count > line + 1) buffer->lexer_state_cache.valid_count = line + 1;
+     if(buffer->unchanged_line_count > line) buffer->unchanged_line_count = line;
+}
+
+static void bracket_index_free(CeBracketIndex_t* index){
+     for(int64_t i = 0; i < index->line_count; i++){
+          free(index->lines[i].brackets);
+     }
+
+     free(index->lines);
+     free(index->depths);
+     memset(index, 0, sizeof(*index));
+}
+
+// editing a line means rescanning it, the lines after it only need rescanning if it changes whether they start in a comment
+static void buffer_bracket_line_changed(CeBuffer_t* buffer, int64_t line){
+     CeBracketIndex_t* index = &buffer->bracket_index;
+     if(!index->built) return;
+     if(line < 0 || line >= index->line_count) return;
+
+     CeBracketLine_t* bracket_line = index->lines + line;
+     if(bracket_line->scanned){
+          bracket_line->scanned = false;
+          index->unscanned_count++;
+     }
+
+     if(line < index->first_unchecked) index->first_unchecked = line;
+}
+
+static void buffer_bracket_lines_inserted(CeBuffer_t* buffer, int64_t line, int64_t count){
+     CeBracketIndex_t* index = &buffer->bracket_index;
+     if(!index->built) return;
+     if(line < 0 || line > index->line_count){
+          bracket_index_free(index);
+          return;
+     }
+
+     int64_t new_line_count = index->line_count + count;
+     if(new_line_count > index->line_capacity){
+          int64_t new_capacity = index->line_capacity ? index->line_capacity : 64;
+          while(new_capacity < new_line_count) new_capacity *= 2;
+          CeBracketLine_t* new_lines = realloc(index->lines, new_capacity * sizeof(*new_lines));
+          if(!new_lines){
+               // start over on the next lookup
+               bracket_index_free(index);
+               return;
+          }
+          index->lines = new_lines;
+          index->line_capacity = new_capacity;
+     }
+
+     memmove(index->lines + line + count, index->lines + line, (index->line_count - line) * sizeof(*index->lines));
+     memset(index->lines + line, 0, count * sizeof(*index->lines));
+     index->line_count = new_line_count;
+     index->unscanned_count += count;
+     if(line < index->first_unchecked) index->first_unchecked = line;
+     index->depths_valid = false;
+}
+
+static void buffer_bracket_lines_removed(CeBuffer_t* buffer, int64_t line, int64_t count){
+     CeBracketIndex_t* index = &buffer->bracket_index;
+     if(!index->built) return;
+     if(line < 0 || line + count > index->line_count){
+          bracket_index_free(index);
+          return;
+     }
+
+     for(int64_t i = line; i < line + count; i++){
+          free(index->lines[i].brackets);
+          if(!index->lines[i].scanned) index->unscanned_count--;
+     }
+
+     memmove(index->lines + line, index->lines + line + count, (index->line_count - (line + count)) * sizeof(*index->lines));
+     index->line_count -= count;
+     index->depths_valid = false;
+
+     // the line that moved up has a new line before it, so it may start in a different state
+     buffer_bracket_line_changed(buffer, line);
+}
+
 bool ce_buffer_alloc(CeBuffer_t* buffer, int64_t line_count, const char* name){
      if(buffer->lines) ce_buffer_free(buffer);
 
@@ -118,6 +207,10 @@ bool ce_buffer_alloc(CeBuffer_t* buffer, int64_t line_count, const char* name){
      }
 
      buffer->status = CE_BUFFER_STATUS_MODIFIED;
+     buffer->version++;
+     buffer->lexer_state_cache.valid_count = 0;
+     buffer->unchanged_line_count = 0;
+     bracket_index_free(&buffer->bracket_index);
      return true;
 }
 
@@ -128,6 +221,8 @@ void ce_buffer_free(CeBuffer_t* buffer){
 
      free(buffer->lines);
      free(buffer->name);
+     free(buffer->lexer_state_cache.states);
+     bracket_index_free(&buffer->bracket_index);
 
      if(buffer->change_node){
           CeBufferChangeNode_t* head = buffer->change_node;
@@ -135,7 +230,10 @@ void ce_buffer_free(CeBuffer_t* buffer){
           ce_buffer_change_node_free(&head);
      }
 
+     // keep the version moving forward so anything cached against the old contents is invalidated on reload
+     int64_t version = buffer->version;
      memset(buffer, 0, sizeof(*buffer));
+     buffer->version = version + 1;
 }
 
 bool ce_buffer_load_file(CeBuffer_t* buffer, const char* filename){
@@ -237,6 +335,10 @@ bool ce_buffer_load_string(CeBuffer_t* buffer, const char* string, const char* n
 
      buffer->line_count = line_count;
      buffer->name = strdup(name);
+     buffer->version++;
+     buffer->lexer_state_cache.valid_count = 0;
+     buffer->unchanged_line_count = 0;
+     bracket_index_free(&buffer->bracket_index);
 
      // loop over each line
      const char* newline = NULL;
@@ -310,6 +412,10 @@ bool ce_buffer_empty(CeBuffer_t* buffer){
      buffer->lines[0][0] = 0;
      buffer->line_count = 1;
      buffer->status = CE_BUFFER_STATUS_NONE;
+     buffer->version++;
+     buffer->lexer_state_cache.valid_count = 0;
+     buffer->unchanged_line_count = 0;
+     bracket_index_free(&buffer->bracket_index);
 
      return true;
 }
@@ -699,12 +805,15 @@ bool ce_buffer_insert_string(CeBuffer_t* buffer, const char* string, CePoint_t p
                // allow inserting a string after a buffer by resizing
                if(!buffer_realloc_lines(buffer, buffer->line_count + 1)) return false;
                buffer->lines[point.y] = calloc(1, 1); // allocate an empty string
+               buffer_bracket_lines_inserted(buffer, point.y, 1);
           }else{
                return false;
           }
      }
 
      int64_t string_lines = ce_util_count_string_lines(string);
+     buffer_invalidate_lexer_states_after(buffer, point.y);
+     buffer_bracket_line_changed(buffer, point.y);
      if(string_lines == 0){
           return true; // sure, yeah, we inserted that empty string
      }else if(string_lines == 1){
@@ -730,6 +839,7 @@ bool ce_buffer_insert_string(CeBuffer_t* buffer, const char* string, CePoint_t p
           line[total_len] = 0;
           buffer->lines[point.y] = line;
           buffer->status = CE_BUFFER_STATUS_MODIFIED;
+          buffer->version++;
           return true;
      }
 
@@ -747,6 +857,7 @@ bool ce_buffer_insert_string(CeBuffer_t* buffer, const char* string, CePoint_t p
      char** dst_line = src_line + shift_lines;
      size_t move_count = old_line_count - first_new_line;
      memmove(dst_line, src_line, move_count * sizeof(src_line));
+     buffer_bracket_lines_inserted(buffer, first_new_line, shift_lines);
 
      // save the last part of the first line to stick on the end of the multiline string
      char* end_string = NULL;
@@ -793,6 +904,7 @@ bool ce_buffer_insert_string(CeBuffer_t* buffer, const char* string, CePoint_t p
      buffer->lines[next_line][last_line_len] = 0;
 
      buffer->status = CE_BUFFER_STATUS_MODIFIED;
+     buffer->version++;
      return true;
 }
 
@@ -810,6 +922,8 @@ bool ce_buffer_remove_string(CeBuffer_t* buffer, CePoint_t point, int64_t length
 
      char* first_line_start = ce_utf8_iterate_to(buffer->lines[point.y], point.x);
      int64_t length_left_on_line = ce_utf8_strlen(first_line_start) + 1;
+     buffer_invalidate_lexer_states_after(buffer, point.y);
+     buffer_bracket_line_changed(buffer, point.y);
 
      if(length_left_on_line > length){
           // case: glue together left and right sides and cut out the middle
@@ -835,6 +949,7 @@ bool ce_buffer_remove_string(CeBuffer_t* buffer, CePoint_t point, int64_t length
           buffer->lines[point.y] = new_line;
 
           buffer->status = CE_BUFFER_STATUS_MODIFIED;
+          buffer->version++;
           return true;
      }else if(length_left_on_line == length){
           if(point.x == 0){
@@ -922,6 +1037,9 @@ bool ce_buffer_remove_lines(CeBuffer_t* buffer, int64_t line_start, int64_t line
      if(lines_to_remove <= 0) return false;
      if(line_start + lines_to_remove > buffer->line_count) return false;
 
+     buffer_invalidate_lexer_states_after(buffer, line_start);
+     buffer_bracket_lines_removed(buffer, line_start, lines_to_remove);
+
      // free lines we are going to remove and overwrite
      for(int64_t i = line_start; i < line_start + lines_to_remove; i++){
           free(buffer->lines[i]);
@@ -943,10 +1061,374 @@ bool ce_buffer_remove_lines(CeBuffer_t* buffer, int64_t line_start, int64_t line
      }
 
      buffer->status = CE_BUFFER_STATUS_MODIFIED;
+     buffer->version++;
      return buffer->lines != NULL;
 }
 
-char* ce_buffer_dupe_string(CeBuffer_t* buffer, CePoint_t point, int64_t length){
+static bool bracket_line_append(CeBracketLine_t* bracket_line, int64_t* capacity, int64_t x, CeRune_t rune){
+     if(bracket_line->bracket_count >= *capacity){
+          int64_t new_capacity = *capacity ? *capacity * 2 : 8;
+          CeBracket_t* new_brackets = realloc(bracket_line->brackets, new_capacity * sizeof(*new_brackets));
+          if(!new_brackets) return false;
+          bracket_line->brackets = new_brackets;
+          *capacity = new_capacity;
+     }
+
+     bracket_line->brackets[bracket_line->bracket_count] = (CeBracket_t){x, rune};
+     bracket_line->bracket_count++;
+     return true;
+}
+
+// strings end with the line, block comments carry on to the next one
+static void bracket_scan_line(const char* line, int64_t state, CeBracketLine_t* bracket_line){
+     bool block_comment = state;
+     char in_string = 0;
+     int64_t capacity = 0;
+     int64_t x = -1;
+
+     free(bracket_line->brackets);
+     bracket_line->brackets = NULL;
+     bracket_line->bracket_count = 0;
+     bracket_line->start_state = state;
+
+     const char* itr = line;
+     while(*itr){
+          char ch = *itr;
+          itr++;
+
+          // brackets, quotes and comment characters are all ascii, so we only need to count the other runes
+          if((ch & 0xC0) == 0x80) continue;
+          x++;
+
+          if(block_comment){
+               if(ch == '*' && *itr == '/'){
+                    block_comment = false;
+                    itr++;
+                    x++;
+               }
+               continue;
+          }
+
+          if(in_string){
+               if(ch == '\\' && *itr){
+                    itr++;
+                    while((*itr & 0xC0) == 0x80) itr++;
+                    x++;
+               }else if(ch == in_string){
+                    in_string = 0;
+               }
+               continue;
+          }
+
+          switch(ch){
+          default:
+               break;
+          case '"':
+          case '\'':
+               in_string = ch;
+               break;
+          case '/':
+               if(*itr == '/'){
+                    bracket_line->end_state = 0;
+                    bracket_line->scanned = true;
+                    return;
+               }else if(*itr == '*'){
+                    block_comment = true;
+                    itr++;
+                    x++;
+               }
+               break;
+          case '(':
+          case ')':
+          case '{':
+          case '}':
+          case '[':
+          case ']':
+          case '<':
+          case '>':
+               bracket_line_append(bracket_line, &capacity, x, ch);
+               break;
+          }
+     }
+
+     bracket_line->end_state = block_comment;
+     bracket_line->scanned = true;
+}
+
+static int bracket_kind(CeRune_t rune, int64_t* value){
+     switch(rune){
+     default:
+          return -1;
+     case '(':
+          *value = 1;
+          return 0;
+     case ')':
+          *value = -1;
+          return 0;
+     case '{':
+          *value = 1;
+          return 1;
+     case '}':
+          *value = -1;
+          return 1;
+     case '[':
+          *value = 1;
+          return 2;
+     case ']':
+          *value = -1;
+          return 2;
+     case '<':
+          *value = 1;
+          return 3;
+     case '>':
+          *value = -1;
+          return 3;
+     }
+}
+
+static void bracket_depths_set_leaf(CeBracketIndex_t* index, int64_t line){
+     CeBracketDepth_t* leaf = index->depths + ((index->leaf_count + line) * CE_BRACKET_KIND_COUNT);
+     memset(leaf, 0, CE_BRACKET_KIND_COUNT * sizeof(*leaf));
+     if(line >= index->line_count) return;
+
+     CeBracketLine_t* bracket_line = index->lines + line;
+     for(int64_t i = 0; i < bracket_line->bracket_count; i++){
+          int64_t value = 0;
+          int kind = bracket_kind(bracket_line->brackets[i].rune, &value);
+          if(kind < 0) continue;
+          leaf[kind].sum += value;
+          if(leaf[kind].sum < leaf[kind].min_prefix) leaf[kind].min_prefix = leaf[kind].sum;
+     }
+}
+
+static void bracket_depths_combine(CeBracketIndex_t* index, int64_t node){
+     CeBracketDepth_t* depth = index->depths + (node * CE_BRACKET_KIND_COUNT);
+     CeBracketDepth_t* left = index->depths + ((node * 2) * CE_BRACKET_KIND_COUNT);
+     CeBracketDepth_t* right = index->depths + ((node * 2 + 1) * CE_BRACKET_KIND_COUNT);
+     for(int64_t k = 0; k < CE_BRACKET_KIND_COUNT; k++){
+          depth[k].sum = left[k].sum + right[k].sum;
+          int64_t right_min_prefix = left[k].sum + right[k].min_prefix;
+          depth[k].min_prefix = (left[k].min_prefix < right_min_prefix) ? left[k].min_prefix : right_min_prefix;
+     }
+}
+
+static bool bracket_depths_build(CeBracketIndex_t* index){
+     int64_t leaf_count = 1;
+     while(leaf_count < index->line_count) leaf_count *= 2;
+
+     if(leaf_count != index->leaf_count || !index->depths){
+          CeBracketDepth_t* new_depths = realloc(index->depths, (leaf_count * 2) * CE_BRACKET_KIND_COUNT * sizeof(*new_depths));
+          if(!new_depths) return false;
+          index->depths = new_depths;
+          index->leaf_count = leaf_count;
+     }
+
+     for(int64_t i = 0; i < leaf_count; i++){
+          bracket_depths_set_leaf(index, i);
+     }
+
+     for(int64_t node = leaf_count - 1; node >= 1; node--){
+          bracket_depths_combine(index, node);
+     }
+
+     index->depths_valid = true;
+     return true;
+}
+
+static void bracket_depths_update(CeBracketIndex_t* index, int64_t line){
+     bracket_depths_set_leaf(index, line);
+     for(int64_t node = (index->leaf_count + line) / 2; node >= 1; node /= 2){
+          bracket_depths_combine(index, node);
+     }
+}
+
+// bring the index up to date with the buffer, only rescanning edited lines and the lines their comments spill into
+static bool bracket_index_update(CeBuffer_t* buffer){
+     CeBracketIndex_t* index = &buffer->bracket_index;
+     if(index->built && index->line_count != buffer->line_count) bracket_index_free(index);
+
+     if(!index->built){
+          if(buffer->line_count <= 0) return false;
+          index->lines = calloc(buffer->line_count, sizeof(*index->lines));
+          if(!index->lines){
+               ce_log("%s() failed to allocate %ld bracket lines\n", __FUNCTION__, buffer->line_count);
+               return false;
+          }
+          index->line_count = buffer->line_count;
+          index->line_capacity = buffer->line_count;
+          index->unscanned_count = buffer->line_count;
+          index->first_unchecked = 0;
+          index->built = true;
+     }
+
+     int64_t state = (index->first_unchecked > 0) ? index->lines[index->first_unchecked - 1].end_state : 0;
+     for(int64_t y = index->first_unchecked; y < index->line_count; y++){
+          CeBracketLine_t* bracket_line = index->lines + y;
+          if(bracket_line->scanned && bracket_line->start_state == state){
+               // the rest of the lines were scanned starting from the states they still have
+               if(index->unscanned_count == 0) break;
+               state = bracket_line->end_state;
+               continue;
+          }
+
+          if(!bracket_line->scanned) index->unscanned_count--;
+          bracket_scan_line(buffer->lines[y], state, bracket_line);
+          if(index->depths_valid) bracket_depths_update(index, y);
+          state = bracket_line->end_state;
+     }
+     index->first_unchecked = index->line_count;
+
+     if(!index->depths_valid && !bracket_depths_build(index)){
+          ce_log("%s() failed to allocate bracket depths for %ld lines\n", __FUNCTION__, index->line_count);
+          return false;
+     }
+
+     return true;
+}
+
+// walk up the tree from a line, checking the subtrees that start right after it and stopping at the first one where the
+// running depth reaches target, then walk back down it. the cost depends on how far away the match is, not on the
+// buffer size, so looking for an enclosing bracket a few lines up stays cheap in a big file
+static int64_t bracket_depths_find_forward(CeBracketIndex_t* index, int kind, int64_t line, int64_t target, int64_t* depth){
+     int64_t node = index->leaf_count + line;
+     while(node > 1){
+          if((node & 1) == 0){
+               CeBracketDepth_t* sibling = index->depths + ((node + 1) * CE_BRACKET_KIND_COUNT) + kind;
+               if((*depth + sibling->min_prefix) <= target){
+                    node++;
+                    break;
+               }
+               *depth += sibling->sum;
+          }
+          node /= 2;
+     }
+     if(node <= 1) return -1;
+
+     while(node < index->leaf_count){
+          CeBracketDepth_t* left = index->depths + ((node * 2) * CE_BRACKET_KIND_COUNT) + kind;
+          if((*depth + left->min_prefix) <= target){
+               node = node * 2;
+          }else{
+               *depth += left->sum;
+               node = node * 2 + 1;
+          }
+     }
+
+     return node - index->leaf_count;
+}
+
+static int64_t bracket_depths_find_backward(CeBracketIndex_t* index, int kind, int64_t line, int64_t target, int64_t* depth){
+     int64_t node = index->leaf_count + line;
+     while(node > 1){
+          if(node & 1){
+               CeBracketDepth_t* sibling = index->depths + ((node - 1) * CE_BRACKET_KIND_COUNT) + kind;
+               if((*depth + (sibling->sum - sibling->min_prefix)) >= target){
+                    node--;
+                    break;
+               }
+               *depth += sibling->sum;
+          }
+          node /= 2;
+     }
+     if(node <= 1) return -1;
+
+     while(node < index->leaf_count){
+          CeBracketDepth_t* right = index->depths + ((node * 2 + 1) * CE_BRACKET_KIND_COUNT) + kind;
+          if((*depth + (right->sum - right->min_prefix)) >= target){
+               node = node * 2 + 1;
+          }else{
+               *depth += right->sum;
+               node = node * 2;
+          }
+     }
+
+     return node - index->leaf_count;
+}
+
+static bool bracket_kinds_match(CeRune_t left, CeRune_t right, int* kind){
+     int64_t left_value = 0;
+     int64_t right_value = 0;
+     *kind = bracket_kind(left, &left_value);
+     return *kind >= 0 && bracket_kind(right, &right_value) == *kind && left_value > 0 && right_value < 0;
+}
+
+bool ce_buffer_find_bracket_backward(CeBuffer_t* buffer, CePoint_t point, bool inclusive, CeRune_t left, CeRune_t right,
+                                     int64_t level, CePoint_t* match){
+     int kind = 0;
+     if(!bracket_kinds_match(left, right, &kind)) return false;
+     if(point.y < 0 || point.y >= buffer->line_count) return false;
+     if(!bracket_index_update(buffer)) return false;
+
+     CeBracketIndex_t* index = &buffer->bracket_index;
+     int64_t target = level + 1;
+     int64_t depth = 0;
+     int64_t y = point.y;
+
+     while(y >= 0){
+          CeBracketLine_t* bracket_line = index->lines + y;
+          for(int64_t i = bracket_line->bracket_count - 1; i >= 0; i--){
+               CeBracket_t* bracket = bracket_line->brackets + i;
+               if(y == point.y && (bracket->x > point.x || (bracket->x == point.x && !inclusive))) continue;
+               if(bracket->rune == right){
+                    depth--;
+               }else if(bracket->rune == left){
+                    depth++;
+                    if(depth >= target){
+                         *match = (CePoint_t){bracket->x, y};
+                         return true;
+                    }
+               }
+          }
+
+          if(y != point.y) break;
+          y = bracket_depths_find_backward(index, kind, point.y, target, &depth);
+     }
+
+     return false;
+}
+
+bool ce_buffer_find_bracket_forward(CeBuffer_t* buffer, CePoint_t point, bool inclusive, CeRune_t left, CeRune_t right,
+                                    int64_t level, CePoint_t* match){
+     int kind = 0;
+     if(!bracket_kinds_match(left, right, &kind)) return false;
+     if(point.y < 0 || point.y >= buffer->line_count) return false;
+     if(!bracket_index_update(buffer)) return false;
+
+     CeBracketIndex_t* index = &buffer->bracket_index;
+     int64_t target = -(level + 1);
+     int64_t depth = 0;
+     int64_t y = point.y;
+
+     while(y >= 0){
+          CeBracketLine_t* bracket_line = index->lines + y;
+          for(int64_t i = 0; i < bracket_line->bracket_count; i++){
+               CeBracket_t* bracket = bracket_line->brackets + i;
+               if(y == point.y && (bracket->x < point.x || (bracket->x == point.x && !inclusive))) continue;
+               if(bracket->rune == left){
+                    depth++;
+               }else if(bracket->rune == right){
+                    depth--;
+                    if(depth <= target){
+                         *match = (CePoint_t){bracket->x, y};
+                         return true;
+                    }
+               }
+          }
+
+          if(y != point.y) break;
+          y = bracket_depths_find_forward(index, kind, point.y, target, &depth);
+     }
+
+     return false;
+}
+
+static char* dupe_alloc(int64_t length, bool shared){
+     if(shared) return ce_shared_string_alloc(length);
+     return malloc(length + 1);
+}
+
+static char* buffer_dupe_string(CeBuffer_t* buffer, CePoint_t point, int64_t length, bool shared){
+     if(length < 0) return NULL;
      if(!ce_buffer_point_is_valid(buffer, point)) return NULL;
 
      char* start = ce_utf8_iterate_to(buffer->lines[point.y], point.x);
@@ -957,9 +1439,14 @@ char* ce_buffer_dupe_string(CeBuffer_t* buffer, CePoint_t point, int64_t length)
      // exit early if the whole string is just on this line
      if(buffer_utf8_length > length){
           char* end = ce_utf8_iterate_to(start, length);
-          return strndup(start, end - start);
+          char* new_string = dupe_alloc(end - start, shared);
+          if(!new_string) return NULL;
+          memcpy(new_string, start, end - start);
+          new_string[end - start] = 0;
+          return new_string;
      }else if(buffer_utf8_length == length){
-          char* new_string = malloc(real_length + 1);
+          char* new_string = dupe_alloc(real_length, shared);
+          if(!new_string) return NULL;
           strncpy(new_string, start, real_length - 1);
           new_string[real_length - 1] = CE_NEWLINE;
           new_string[real_length] = 0;
@@ -970,7 +1457,11 @@ char* ce_buffer_dupe_string(CeBuffer_t* buffer, CePoint_t point, int64_t length)
      int64_t current_line = point.y + 1;
 
      // this means we asked for a string passed the length of the buffer, starting at the end, just return an empty string
-     if(current_line >= buffer->line_count) return strdup("");
+     if(current_line >= buffer->line_count){
+          char* empty = dupe_alloc(0, shared);
+          if(empty) empty[0] = 0;
+          return empty;
+     }
 
      while(true){
           int64_t line_utf8_length = ce_utf8_strlen(buffer->lines[current_line]) + 1;
@@ -989,7 +1480,8 @@ char* ce_buffer_dupe_string(CeBuffer_t* buffer, CePoint_t point, int64_t length)
      }
 
      // alloc
-     char* dupe = malloc(real_length + 1);
+     char* dupe = dupe_alloc(real_length, shared);
+     if(!dupe) return NULL;
      char* itr = dupe;
 
      // copy in the first line
@@ -1032,6 +1524,14 @@ char* ce_buffer_dupe_string(CeBuffer_t* buffer, CePoint_t point, int64_t length)
      return dupe;
 }
 
+char* ce_buffer_dupe_string(CeBuffer_t* buffer, CePoint_t point, int64_t length){
+     return buffer_dupe_string(buffer, point, length, false);
+}
+
+char* ce_buffer_dupe_shared_string(CeBuffer_t* buffer, CePoint_t point, int64_t length){
+     return buffer_dupe_string(buffer, point, length, true);
+}
+
 char* ce_buffer_dupe(CeBuffer_t* buffer){
      CePoint_t start = {0, 0};
      CePoint_t end = {buffer->line_count, 0};
@@ -1076,6 +1576,513 @@ bool ce_buffer_insert_string_change_at_cursor(CeBuffer_t* buffer, char* alloced_
      return true;
 }
 
+bool ce_buffer_insert_string_change_at_points(CeBuffer_t* buffer, const char* string, CePoint_t* points,
+                                              int64_t point_count, bool chain_undo){
+     if(buffer->status == CE_BUFFER_STATUS_READONLY) return false;
+     if(strchr(string, CE_NEWLINE)) return false;
+     if(point_count <= 0) return true;
+
+     // validate everything up front so we either apply all of the edits or none of them
+     for(int64_t i = 0; i < point_count; i++){
+          if(!ce_buffer_point_is_valid(buffer, points[i])) return false;
+          if(i > 0 && ce_point_after(points[i - 1], points[i])) return false;
+     }
+
+     size_t insert_len = strlen(string);
+     int64_t insert_runes = ce_utf8_strlen(string);
+     if(insert_len == 0) return true;
+
+     CePoint_t* change_points = malloc(point_count * sizeof(*change_points));
+     if(!change_points) return false;
+
+     bool success = true;
+     int64_t first = 0;
+     while(first < point_count){
+          int64_t y = points[first].y;
+          int64_t last = first;
+          while(last + 1 < point_count && points[last + 1].y == y) last++;
+          int64_t line_point_count = (last - first) + 1;
+
+          // rebuild the line once, copying the original segments between each insertion point
+          char* old_line = buffer->lines[y];
+          size_t old_len = strlen(old_line);
+          char* new_line = malloc(old_len + (insert_len * line_point_count) + 1);
+          if(!new_line){
+               success = false;
+               break;
+          }
+
+          char* src = old_line;
+          char* dst = new_line;
+          int64_t src_x = 0;
+          for(int64_t i = first; i <= last; i++){
+               char* next = ce_utf8_iterate_to(src, points[i].x - src_x);
+               size_t segment_len = next - src;
+               memcpy(dst, src, segment_len);
+               dst += segment_len;
+               memcpy(dst, string, insert_len);
+               dst += insert_len;
+               src = next;
+               src_x = points[i].x;
+          }
+          strcpy(dst, src);
+
+          free(old_line);
+          buffer->lines[y] = new_line;
+          buffer_invalidate_lexer_states_after(buffer, y);
+          buffer_bracket_line_changed(buffer, y);
+
+          // each insertion is recorded where it lands once the ones before it on the line have been applied
+          for(int64_t i = first; i <= last; i++){
+               change_points[i] = (CePoint_t){points[i].x + ((i - first) * insert_runes), y};
+               points[i] = (CePoint_t){change_points[i].x + insert_runes, y};
+          }
+
+          first = last + 1;
+     }
+
+     // lines we already rebuilt still need to be undoable if we ran out of memory part way through
+     if(first == 0){
+          free(change_points);
+          return false;
+     }
+
+     CeBufferChange_t change = {};
+     change.chain = chain_undo;
+     change.insertion = true;
+     change.string = strdup(string);
+     change.location = change_points[0];
+     change.cursor_before = change_points[0];
+     change.cursor_after = points[0];
+     change.points = change_points;
+     change.point_count = first;
+     ce_buffer_change(buffer, &change);
+
+     buffer->status = CE_BUFFER_STATUS_MODIFIED;
+     buffer->version++;
+     return success;
+}
+
+bool ce_buffer_remove_string_change_at_points(CeBuffer_t* buffer, CePoint_t* points, int64_t point_count, int64_t length,
+                                              bool chain_undo){
+     if(buffer->status == CE_BUFFER_STATUS_READONLY) return false;
+     if(point_count <= 0 || length <= 0) return true;
+
+     // validate everything up front so we either apply all of the edits or none of them
+     for(int64_t i = 0; i < point_count; i++){
+          if(!ce_buffer_point_is_valid(buffer, points[i])) return false;
+          if(points[i].x + length > ce_utf8_strlen(buffer->lines[points[i].y])) return false;
+          if(i > 0 && points[i - 1].y == points[i].y && points[i - 1].x + length > points[i].x) return false;
+          if(i > 0 && points[i - 1].y > points[i].y) return false;
+     }
+
+     CePoint_t* change_points = malloc(point_count * sizeof(*change_points));
+     if(!change_points) return false;
+
+     // every removal is the same number of runes, but not necessarily the same number of bytes, so make room for the
+     // longest utf8 encoding of each
+     size_t removed_len = 0;
+     char* removed = malloc((point_count * length * 4) + 1);
+     if(!removed){
+          free(change_points);
+          return false;
+     }
+
+     int64_t first = 0;
+     while(first < point_count){
+          int64_t y = points[first].y;
+          int64_t last = first;
+          while(last + 1 < point_count && points[last + 1].y == y) last++;
+
+          // rebuild the line once, skipping over each removed segment
+          char* line = buffer->lines[y];
+          char* dst = line;
+          char* src = line;
+          int64_t src_x = 0;
+          for(int64_t i = first; i <= last; i++){
+               char* remove_start = ce_utf8_iterate_to(src, points[i].x - src_x);
+               char* remove_end = ce_utf8_iterate_to(remove_start, length);
+               size_t keep_len = remove_start - src;
+               size_t remove_len = remove_end - remove_start;
+
+               memcpy(removed + removed_len, remove_start, remove_len);
+               removed_len += remove_len;
+
+               memmove(dst, src, keep_len);
+               dst += keep_len;
+               src = remove_end;
+               src_x = points[i].x + length;
+          }
+          memmove(dst, src, strlen(src) + 1);
+
+          buffer_invalidate_lexer_states_after(buffer, y);
+          buffer_bracket_line_changed(buffer, y);
+
+          // each removal is recorded where it lands once the ones before it on the line have been applied
+          for(int64_t i = first; i <= last; i++){
+               change_points[i] = (CePoint_t){points[i].x - ((i - first) * length), y};
+               points[i] = change_points[i];
+          }
+
+          first = last + 1;
+     }
+     removed[removed_len] = 0;
+
+     CeBufferChange_t change = {};
+     change.chain = chain_undo;
+     change.insertion = false;
+     change.string = removed;
+     change.location = change_points[0];
+     change.cursor_before = change_points[0];
+     change.cursor_after = change_points[0];
+     change.points = change_points;
+     change.point_count = point_count;
+     ce_buffer_change(buffer, &change);
+
+     buffer->status = CE_BUFFER_STATUS_MODIFIED;
+     buffer->version++;
+     return true;
+}
+
+static char* join_lines(char** lines, int64_t line_count){
+     if(line_count <= 0) return NULL;
+     size_t len = line_count - 1;
+     for(int64_t i = 0; i < line_count; i++) len += strlen(lines[i]);
+
+     char* joined = malloc(len + 1);
+     if(!joined) return NULL;
+     char* itr = joined;
+     for(int64_t i = 0; i < line_count; i++){
+          if(i > 0) *(itr++) = CE_NEWLINE;
+          size_t line_len = strlen(lines[i]);
+          memcpy(itr, lines[i], line_len);
+          itr += line_len;
+     }
+     *itr = 0;
+     return joined;
+}
+
+// undo sees a block of lines being rewritten as removing the old text and inserting the new text in its place
+static void buffer_record_lines_replaced(CeBuffer_t* buffer, int64_t first_line, char* removed_string, char* inserted_string,
+                                         CePoint_t* cursor_before, CePoint_t cursor_after, bool chain_undo){
+     CePoint_t location = {0, first_line};
+     CeBufferChange_t change = {};
+     change.chain = chain_undo;
+     change.insertion = false;
+     change.string = removed_string;
+     change.location = location;
+     change.cursor_before = *cursor_before;
+     change.cursor_after = location;
+     ce_buffer_change(buffer, &change);
+
+     change.chain = true;
+     change.insertion = true;
+     change.string = inserted_string;
+     change.cursor_before = location;
+     change.cursor_after = cursor_after;
+     ce_buffer_change(buffer, &change);
+
+     *cursor_before = cursor_after;
+     buffer->status = CE_BUFFER_STATUS_MODIFIED;
+     buffer->version++;
+}
+
+bool ce_buffer_replace_lines_change(CeBuffer_t* buffer, int64_t first_line, int64_t line_count, char** new_lines,
+                                    int64_t new_line_count, CePoint_t* cursor_before, CePoint_t cursor_after, bool chain_undo){
+     if(buffer->status == CE_BUFFER_STATUS_READONLY) return false;
+     if(line_count <= 0 || new_line_count <= 0 || first_line < 0 || first_line + line_count > buffer->line_count) return false;
+
+     char* removed_string = join_lines(buffer->lines + first_line, line_count);
+     char* inserted_string = join_lines(new_lines, new_line_count);
+     if(!removed_string || !inserted_string){
+          free(removed_string);
+          free(inserted_string);
+          return false;
+     }
+
+     int64_t after_line = first_line + line_count;
+     int64_t new_buffer_line_count = buffer->line_count + (new_line_count - line_count);
+     if(new_line_count > line_count){
+          char** lines = realloc(buffer->lines, new_buffer_line_count * sizeof(*lines));
+          if(!lines){
+               free(removed_string);
+               free(inserted_string);
+               return false;
+          }
+          buffer->lines = lines;
+     }
+
+     for(int64_t i = first_line; i < after_line; i++){
+          free(buffer->lines[i]);
+     }
+
+     // only the lines after the range move, and only when the line count changes
+     if(new_line_count != line_count){
+          memmove(buffer->lines + first_line + new_line_count, buffer->lines + after_line,
+                  (buffer->line_count - after_line) * sizeof(*buffer->lines));
+          if(new_line_count > line_count){
+               buffer_bracket_lines_inserted(buffer, after_line, new_line_count - line_count);
+          }else{
+               buffer_bracket_lines_removed(buffer, first_line + new_line_count, line_count - new_line_count);
+          }
+          buffer->line_count = new_buffer_line_count;
+     }
+
+     memcpy(buffer->lines + first_line, new_lines, new_line_count * sizeof(*new_lines));
+     for(int64_t i = 0; i < new_line_count; i++){
+          buffer_bracket_line_changed(buffer, first_line + i);
+     }
+     buffer_invalidate_lexer_states_after(buffer, first_line);
+
+     buffer_record_lines_replaced(buffer, first_line, removed_string, inserted_string, cursor_before, cursor_after, chain_undo);
+     return true;
+}
+
+#define SORT_PARALLEL_MIN_LINES 65536
+#define SORT_MAX_THREADS 8
+#define SORT_INSERTION_MAX_LINES 16
+
+typedef struct{
+     char* line;
+     const char* key; // NULL when the line has no key to sort on
+     int64_t number;
+}SortLine_t;
+
+typedef struct{
+     SortLine_t* lines;
+     SortLine_t* scratch;
+     int64_t count;
+     int64_t left_count; // when merging, the chunk is made of 2 sorted runs split here
+     const CeSortOptions_t* options;
+}SortChunk_t;
+
+static void sort_line_set_key(SortLine_t* sort_line, const CeSortOptions_t* options){
+     const char* key = sort_line->line;
+
+     for(int64_t i = 0; i < options->key_column && *key; i++){
+          key++;
+          while((*key & 0xC0) == 0x80) key++;
+     }
+
+     if(options->key_regex){
+          regmatch_t match;
+          if(regexec(options->key_regex, key, 1, &match, 0) == 0){
+               key += match.rm_eo;
+          }else{
+               key = NULL;
+          }
+     }
+
+     if(options->numeric && key){
+          const char* digit = key;
+          while(*digit && !isdigit((unsigned char)(*digit))) digit++;
+          if(*digit){
+               sort_line->number = strtoll(digit, NULL, 10);
+               if(digit > key && digit[-1] == '-') sort_line->number = -sort_line->number;
+          }else{
+               key = NULL;
+          }
+     }
+
+     sort_line->key = key;
+}
+
+static int sort_line_compare(const SortLine_t* a, const SortLine_t* b, const CeSortOptions_t* options){
+     int result = 0;
+     if(!a->key || !b->key){
+          result = (a->key != NULL) - (b->key != NULL);
+     }else if(options->numeric){
+          result = (a->number > b->number) - (a->number < b->number);
+     }else if(options->ignore_case){
+          result = strcasecmp(a->key, b->key);
+     }else{
+          result = strcmp(a->key, b->key);
+     }
+     return options->reverse ? -result : result;
+}
+
+// merge the sorted runs [0, left_count) and [left_count, count), only the left run needs to be copied out of the way
+static void sort_lines_merge(SortLine_t* lines, int64_t left_count, int64_t count, SortLine_t* scratch,
+                             const CeSortOptions_t* options){
+     if(sort_line_compare(lines + left_count, lines + left_count - 1, options) >= 0) return;
+
+     memcpy(scratch, lines, left_count * sizeof(*lines));
+     int64_t left = 0;
+     int64_t right = left_count;
+     int64_t dst = 0;
+     while(left < left_count && right < count){
+          if(sort_line_compare(lines + right, scratch + left, options) < 0){
+               lines[dst++] = lines[right++];
+          }else{
+               lines[dst++] = scratch[left++];
+          }
+     }
+     memcpy(lines + dst, scratch + left, (left_count - left) * sizeof(*lines));
+}
+
+static void sort_lines_merge_sort(SortLine_t* lines, int64_t count, SortLine_t* scratch, const CeSortOptions_t* options){
+     if(count <= SORT_INSERTION_MAX_LINES){
+          for(int64_t i = 1; i < count; i++){
+               SortLine_t sort_line = lines[i];
+               int64_t j = i;
+               for(; j > 0 && sort_line_compare(&sort_line, lines + j - 1, options) < 0; j--){
+                    lines[j] = lines[j - 1];
+               }
+               lines[j] = sort_line;
+          }
+          return;
+     }
+
+     int64_t half = count / 2;
+     sort_lines_merge_sort(lines, half, scratch, options);
+     sort_lines_merge_sort(lines + half, count - half, scratch, options);
+     sort_lines_merge(lines, half, count, scratch, options);
+}
+
+static void* sort_lines_chunk(void* data){
+     SortChunk_t* chunk = data;
+     for(int64_t i = 0; i < chunk->count; i++){
+          sort_line_set_key(chunk->lines + i, chunk->options);
+     }
+     sort_lines_merge_sort(chunk->lines, chunk->count, chunk->scratch, chunk->options);
+     return NULL;
+}
+
+static void* sort_lines_merge_chunk(void* data){
+     SortChunk_t* chunk = data;
+     if(chunk->left_count < chunk->count){
+          sort_lines_merge(chunk->lines, chunk->left_count, chunk->count, chunk->scratch, chunk->options);
+     }
+     return NULL;
+}
+
+// run func on each chunk, each in its own thread except the first, which runs on the calling thread
+static void sort_lines_run_chunks(SortChunk_t* chunks, int64_t chunk_count, void* (*func)(void*)){
+     pthread_t threads[SORT_MAX_THREADS];
+     bool started[SORT_MAX_THREADS] = {};
+     for(int64_t i = 1; i < chunk_count; i++){
+          started[i] = (pthread_create(threads + i, NULL, func, chunks + i) == 0);
+          if(!started[i]) func(chunks + i);
+     }
+
+     func(chunks);
+
+     for(int64_t i = 1; i < chunk_count; i++){
+          if(started[i]) pthread_join(threads[i], NULL);
+     }
+}
+
+// big ranges are split into chunks that are keyed and sorted in parallel, then neighbouring chunks are merged in
+// parallel until one is left
+static void sort_lines(SortLine_t* lines, int64_t count, SortLine_t* scratch, const CeSortOptions_t* options){
+     int64_t chunk_count = 1;
+     if(count >= SORT_PARALLEL_MIN_LINES){
+          long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+          if(cpu_count > 1) chunk_count = (cpu_count > SORT_MAX_THREADS) ? SORT_MAX_THREADS : cpu_count;
+     }
+
+     SortChunk_t chunks[SORT_MAX_THREADS];
+     int64_t offset = 0;
+     for(int64_t i = 0; i < chunk_count; i++){
+          SortChunk_t* chunk = chunks + i;
+          chunk->lines = lines + offset;
+          chunk->scratch = scratch + offset;
+          chunk->count = (count / chunk_count) + ((i < (count % chunk_count)) ? 1 : 0);
+          chunk->left_count = chunk->count;
+          chunk->options = options;
+          offset += chunk->count;
+     }
+
+     sort_lines_run_chunks(chunks, chunk_count, sort_lines_chunk);
+
+     while(chunk_count > 1){
+          int64_t merged_count = 0;
+          for(int64_t i = 0; i < chunk_count; i += 2){
+               SortChunk_t merged = chunks[i];
+               merged.left_count = merged.count;
+               if(i + 1 < chunk_count) merged.count += chunks[i + 1].count;
+               chunks[merged_count++] = merged;
+          }
+          chunk_count = merged_count;
+          sort_lines_run_chunks(chunks, chunk_count, sort_lines_merge_chunk);
+     }
+}
+
+bool ce_buffer_sort_lines_change(CeBuffer_t* buffer, int64_t first_line, int64_t line_count, const CeSortOptions_t* options,
+                                 CePoint_t* cursor_before, CePoint_t cursor_after, bool chain_undo){
+     if(buffer->status == CE_BUFFER_STATUS_READONLY) return false;
+     if(line_count <= 0 || first_line < 0 || first_line + line_count > buffer->line_count) return false;
+
+     char** lines = buffer->lines + first_line;
+     SortLine_t* sort_lines_buffer = malloc(line_count * 2 * sizeof(*sort_lines_buffer));
+     char** sorted = malloc(line_count * sizeof(*sorted));
+     if(!sort_lines_buffer || !sorted){
+          free(sort_lines_buffer);
+          free(sorted);
+          return false;
+     }
+
+     for(int64_t i = 0; i < line_count; i++){
+          sort_lines_buffer[i].line = lines[i];
+     }
+
+     sort_lines(sort_lines_buffer, line_count, sort_lines_buffer + line_count, options);
+
+     // kept lines fill the front of sorted in order, lines whose key matches the last kept line's fill the back
+     int64_t kept_count = 0;
+     int64_t dropped_count = 0;
+     int64_t last_kept = 0;
+     bool moved = false;
+     for(int64_t i = 0; i < line_count; i++){
+          char* line = sort_lines_buffer[i].line;
+          if(options->unique && kept_count > 0 &&
+             sort_line_compare(sort_lines_buffer + last_kept, sort_lines_buffer + i, options) == 0){
+               dropped_count++;
+               sorted[line_count - dropped_count] = line;
+               continue;
+          }
+          last_kept = i;
+          if(line != lines[kept_count]) moved = true;
+          sorted[kept_count++] = line;
+     }
+     free(sort_lines_buffer);
+
+     if(!moved && dropped_count == 0){
+          free(sorted);
+          return true;
+     }
+
+     char* removed_string = join_lines(lines, line_count);
+     char* inserted_string = join_lines(sorted, kept_count);
+     if(!removed_string || !inserted_string){
+          free(removed_string);
+          free(inserted_string);
+          free(sorted);
+          return false;
+     }
+
+     for(int64_t i = kept_count; i < line_count; i++){
+          free(sorted[i]);
+     }
+     memcpy(lines, sorted, kept_count * sizeof(*lines));
+     free(sorted);
+
+     if(dropped_count > 0){
+          buffer_bracket_lines_removed(buffer, first_line + kept_count, dropped_count);
+          int64_t after_line = first_line + line_count;
+          memmove(lines + kept_count, buffer->lines + after_line, (buffer->line_count - after_line) * sizeof(*lines));
+          buffer->line_count -= dropped_count;
+     }
+
+     for(int64_t i = 0; i < kept_count; i++){
+          buffer_bracket_line_changed(buffer, first_line + i);
+     }
+     buffer_invalidate_lexer_states_after(buffer, first_line);
+
+     buffer_record_lines_replaced(buffer, first_line, removed_string, inserted_string, cursor_before, cursor_after, chain_undo);
+     return true;
+}
+
 bool ce_buffer_remove_string_change(CeBuffer_t* buffer, CePoint_t point, int64_t remove_len, CePoint_t* cursor_before,
                                     CePoint_t cursor_after, bool chain_undo){
      char* remove_string = ce_buffer_dupe_string(buffer, point, remove_len);
@@ -1120,29 +2127,64 @@ bool ce_buffer_change(CeBuffer_t* buffer, CeBufferChange_t* change){
      return true;
 }
 
+// the text one point of a change inserted or removed, removals keep each point's text back to back in the string
+static char* change_point_string(CeBufferChange_t* change, int64_t index){
+     if(change->insertion) return strdup(change->string);
+     int64_t point_runes = ce_utf8_strlen(change->string) / change->point_count;
+     char* start = ce_utf8_iterate_to(change->string, index * point_runes);
+     char* end = ce_utf8_iterate_to(start, point_runes);
+     return strndup(start, end - start);
+}
+
+// undoing walks a change's points back to front so each one is still where it was recorded
+static void buffer_apply_change(CeBuffer_t* buffer, CeBufferChange_t* change, bool undo){
+     bool insert = (change->insertion != undo);
+     if(!change->points){
+          if(insert){
+               ce_buffer_insert_string(buffer, change->string, change->location);
+          }else{
+               ce_buffer_remove_string(buffer, change->location, ce_utf8_strlen(change->string));
+          }
+          return;
+     }
+
+     int64_t point_runes = ce_utf8_strlen(change->string);
+     if(!change->insertion) point_runes /= change->point_count;
+
+     for(int64_t i = 0; i < change->point_count; i++){
+          int64_t index = undo ? (change->point_count - 1) - i : i;
+          if(insert){
+               char* string = change_point_string(change, index);
+               if(!string) continue;
+               ce_buffer_insert_string(buffer, string, change->points[index]);
+               free(string);
+          }else{
+               ce_buffer_remove_string(buffer, change->points[index], point_runes);
+          }
+     }
+}
+
 bool ce_buffer_undo(CeBuffer_t* buffer, CePoint_t* cursor){
      // nothing to undo
      if(!buffer->change_node) return true;
      if(!buffer->change_node->prev) return true;
 
-     CeBufferChange_t* change = &buffer->change_node->change;
-     if(change->insertion){
-          ce_buffer_remove_string(buffer, change->location, ce_utf8_strlen(change->string));
-     }else{
-          ce_buffer_insert_string(buffer, change->string, change->location);
-     }
-
-     *cursor = change->cursor_before;
-     buffer->change_node = buffer->change_node->prev;
+     // loop rather than recurse through chained changes, a replayed macro can chain a lot of them together
+     bool chain = true;
+     while(chain && buffer->change_node->prev){
+          CeBufferChange_t* change = &buffer->change_node->change;
+          buffer_apply_change(buffer, change, true);
 
-     bool success = true;
-     if(change->chain) success = ce_buffer_undo(buffer, cursor);
+          *cursor = change->cursor_before;
+          buffer->change_node = buffer->change_node->prev;
+          chain = change->chain;
+     }
 
      if(buffer->status == CE_BUFFER_STATUS_MODIFIED && buffer->change_node == buffer->save_at_change_node){
           buffer->status = CE_BUFFER_STATUS_NONE;
      }
 
-     return success;
+     return true;
 }
 
 bool ce_buffer_redo(CeBuffer_t* buffer, CePoint_t* cursor){
@@ -1150,18 +2192,14 @@ bool ce_buffer_redo(CeBuffer_t* buffer, CePoint_t* cursor){
      if(!buffer->change_node) return false;
      if(!buffer->change_node->next) return false;
 
-     buffer->change_node = buffer->change_node->next;
-
-     CeBufferChange_t* change = &buffer->change_node->change;
-     if(change->insertion){
-          ce_buffer_insert_string(buffer, change->string, change->location);
-     }else{
-          ce_buffer_remove_string(buffer, change->location, ce_utf8_strlen(change->string));
-     }
+     do{
+          buffer->change_node = buffer->change_node->next;
 
-     *cursor = change->cursor_after;
+          CeBufferChange_t* change = &buffer->change_node->change;
+          buffer_apply_change(buffer, change, false);
 
-     if(buffer->change_node->next && buffer->change_node->next->change.chain) return ce_buffer_redo(buffer, cursor);
+          *cursor = change->cursor_after;
+     }while(buffer->change_node->next && buffer->change_node->next->change.chain);
 
      if(buffer->status == CE_BUFFER_STATUS_MODIFIED && buffer->change_node == buffer->save_at_change_node){
           buffer->status = CE_BUFFER_STATUS_NONE;
@@ -1170,8 +2208,30 @@ bool ce_buffer_redo(CeBuffer_t* buffer, CePoint_t* cursor){
      return true;
 }
 
+// every point of a change is on a single line, and is recorded after the edits at the points before it on that line
+static CePoint_t move_point_based_on_buffer_change_points(CeBufferChange_t* change, CePoint_t point){
+     int64_t point_runes = ce_utf8_strlen(change->string);
+     if(!change->insertion) point_runes /= change->point_count;
+
+     int64_t shift = 0;
+     int64_t line_index = 0;
+     for(int64_t i = 0; i < change->point_count; i++){
+          CePoint_t change_point = change->points[i];
+          line_index = (i > 0 && change->points[i - 1].y == change_point.y) ? line_index + 1 : 0;
+          if(change_point.y != point.y) continue;
+
+          // where the edit was in the line before any of them were made
+          int64_t original_x = change_point.x + (change->insertion ? -line_index : line_index) * point_runes;
+          if(point.x > original_x) shift += change->insertion ? point_runes : -point_runes;
+     }
+
+     point.x += shift;
+     return point;
+}
+
 static CePoint_t move_point_based_on_buffer_change(CeBuffer_t* buffer, CeBufferChangeNode_t* change, CePoint_t point){
      if(!change->change.string) return point;
+     if(change->change.points) return move_point_based_on_buffer_change_points(&change->change, point);
      if(!ce_point_after(point, change->change.location)) return point;
 
      int64_t change_line_count = ce_util_count_string_lines(change->change.string);
@@ -1586,52 +2646,85 @@ bool ce_point_in_rect(CePoint_t a, CeRect_t r){
              a.y >= r.top && a.y <= r.bottom);
 }
 
-bool ce_rune_node_insert(CeRuneNode_t** head, CeRune_t rune){
-     CeRuneNode_t* node = malloc(sizeof(*node));
-     if(!node) return false;
+bool ce_rune_array_append(CeRuneArray_t* array, CeRune_t rune){
+     // leave room for the null terminator
+     if(array->count + 1 >= array->capacity){
+          int64_t new_capacity = array->capacity ? array->capacity * 2 : 16;
+          CeRune_t* new_runes = realloc(array->runes, new_capacity * sizeof(*new_runes));
+          if(!new_runes) return false;
+          array->runes = new_runes;
+          array->capacity = new_capacity;
+     }
+
+     array->runes[array->count] = rune;
+     array->count++;
+     array->runes[array->count] = 0;
+     return true;
+}
+
+bool ce_rune_array_set(CeRuneArray_t* array, const CeRune_t* runes){
+     int64_t count = 0;
+     while(runes[count]) count++;
 
-     // always insert at head
-     node->rune = rune;
-     node->next = *head;
-     *head = node;
+     // copy before freeing the old runes, in case they are what we were handed
+     CeRune_t* new_runes = malloc((count + 1) * sizeof(*new_runes));
+     if(!new_runes) return false;
+     memcpy(new_runes, runes, (count + 1) * sizeof(*new_runes));
 
+     free(array->runes);
+     array->runes = new_runes;
+     array->count = count;
+     array->capacity = count + 1;
      return true;
 }
 
-CeRune_t* ce_rune_node_string(CeRuneNode_t* head){
-     // count nodes
-     CeRuneNode_t* itr = head;
-     int64_t len = 0;
-     while(itr){
-          itr = itr->next;
-          len++;
-     }
+void ce_rune_array_clear(CeRuneArray_t* array){
+     array->count = 0;
+     if(array->runes) array->runes[0] = 0;
+}
 
-     CeRune_t* runes = malloc((len + 1) * sizeof(*runes));
+void ce_rune_array_free(CeRuneArray_t* array){
+     free(array->runes);
+     array->runes = NULL;
+     array->count = 0;
+     array->capacity = 0;
+}
 
-     // copy into string
-     int64_t save_len = len;
-     itr = head;
-     while(itr){
-          runes[len - 1] = itr->rune;
-          itr = itr->next;
-          len--;
-     }
+// the count lives just in front of the text, so a shared string can be handed around as a plain char*
+typedef struct{
+     int64_t ref_count;
+}CeSharedStringHeader_t;
 
-     // null terminate
-     runes[save_len] = 0;
-     return runes;
+static CeSharedStringHeader_t* shared_string_header(char* string){
+     return (CeSharedStringHeader_t*)(string) - 1;
 }
 
-void ce_rune_node_free(CeRuneNode_t** head){
-     CeRuneNode_t* itr = *head;
-     while(itr){
-          CeRuneNode_t* tmp = itr;
-          itr = itr->next;
-          free(tmp);
-     }
+char* ce_shared_string_alloc(int64_t length){
+     CeSharedStringHeader_t* header = malloc(sizeof(*header) + length + 1);
+     if(!header) return NULL;
+     header->ref_count = 1;
+     char* string = (char*)(header + 1);
+     string[length] = 0;
+     return string;
+}
 
-     *head = NULL;
+char* ce_shared_string_dupe(const char* string){
+     int64_t length = strlen(string);
+     char* shared = ce_shared_string_alloc(length);
+     if(shared) memcpy(shared, string, length);
+     return shared;
+}
+
+char* ce_shared_string_acquire(char* string){
+     if(string) shared_string_header(string)->ref_count++;
+     return string;
+}
+
+void ce_shared_string_release(char* string){
+     if(!string) return;
+     CeSharedStringHeader_t* header = shared_string_header(string);
+     header->ref_count--;
+     if(header->ref_count <= 0) free(header);
 }
 
 char* ce_rune_string_to_char_string(const CeRune_t* int_str){
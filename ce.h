@@ -73,10 +73,16 @@ typedef struct{
      bool chain;
 
      bool insertion; // opposite is deletion
+     bool shared_string; // string is a ce_shared_string, so it is released rather than freed
      char* string;
      CePoint_t location;
      CePoint_t cursor_before;
      CePoint_t cursor_after;
+     // when set, the change was made at each of these points in one go, each recorded where it landed after the edits
+     // at the points before it. insertions put string at every point, removals hold what each point removed back to
+     // back, the same number of runes per point
+     CePoint_t* points;
+     int64_t point_count;
 }CeBufferChange_t;
 
 typedef struct CeBufferChangeNode_t{
@@ -85,6 +91,50 @@ typedef struct CeBufferChangeNode_t{
      struct CeBufferChangeNode_t* prev;
 }CeBufferChangeNode_t;
 
+typedef int64_t CeLexLineFunc_t(const char* line, int64_t state, void* data); // returns the lexer state at the end of the line
+
+// lexer state at the start of each line, filled in lazily by syntax highlighters
+typedef struct{
+     int64_t* states;
+     int64_t valid_count; // editing a line drops the states of every line after it
+     int64_t capacity;
+     CeLexLineFunc_t* lex_line; // which lexer the states came from
+     void* lex_data;
+}CeLexerStateCache_t;
+
+#define CE_BRACKET_KIND_COUNT 4 // (), {}, [] and <>
+
+typedef struct{
+     int64_t x;
+     CeRune_t rune;
+}CeBracket_t;
+
+typedef struct{
+     CeBracket_t* brackets; // only the ones outside of strings and comments
+     int64_t bracket_count;
+     int64_t start_state; // whether the line starts in a block comment
+     int64_t end_state;
+     bool scanned;
+}CeBracketLine_t;
+
+typedef struct{
+     int64_t sum; // opening brackets count 1, closing brackets count -1
+     int64_t min_prefix; // the largest suffix is sum - min_prefix
+}CeBracketDepth_t;
+
+// brackets on each line and a tree of their nesting depths over the lines, built on the first pair lookup
+typedef struct{
+     CeBracketLine_t* lines;
+     int64_t line_count;
+     int64_t line_capacity;
+     int64_t first_unchecked; // lines before this one are scanned with the right start state
+     int64_t unscanned_count;
+     CeBracketDepth_t* depths; // segment tree with CE_BRACKET_KIND_COUNT entries per node
+     int64_t leaf_count;
+     bool depths_valid;
+     bool built;
+}CeBracketIndex_t;
+
 typedef struct{
      char** lines;
      int64_t line_count;
@@ -107,6 +157,12 @@ typedef struct{
 
      time_t file_modified_time;
 
+     int64_t version; // incremented every time the buffer's contents change
+     int64_t unchanged_line_count; // lines at the top no edit has touched since a per line cache last caught up
+
+     CeLexerStateCache_t lexer_state_cache;
+     CeBracketIndex_t bracket_index;
+
      // NOTE: if we decide to do a buffer init hook, add config_data for user configs
 }CeBuffer_t;
 
@@ -144,18 +200,30 @@ typedef struct{
      int cycle_next_completion_key;
      int cycle_prev_completion_key;
      CeRune_t show_line_extends_passed_view_as;
+     int64_t shell_command_redraw_fps; // limit on redraws while shell command output streams in, 0 uses the default
 }CeConfigOptions_t;
 
-typedef struct CeRuneNode_t{
-     CeRune_t rune;
-     struct CeRuneNode_t* next;
-}CeRuneNode_t;
+// runes stored back to back and kept null terminated, so the recording can be read as a string without copying it
+typedef struct{
+     CeRune_t* runes;
+     int64_t count;
+     int64_t capacity;
+}CeRuneArray_t;
 
 typedef struct{
      CePoint_t point;
      int64_t length;
 }CeRegexSearchResult_t;
 
+typedef struct{
+     bool reverse;
+     bool numeric; // sort on the first decimal number in the key, lines without one go first
+     bool unique; // only keep the first of the lines whose keys compare equal
+     bool ignore_case;
+     int64_t key_column; // the key starts at this character column
+     const regex_t* key_regex; // if set, the key starts after the first match, lines without a match go first
+}CeSortOptions_t;
+
 typedef struct{
      CePoint_t point;
      char filepath[PATH_MAX];
@@ -192,19 +260,41 @@ CeRegexSearchResult_t ce_buffer_regex_search_forward(CeBuffer_t* buffer, CePoint
 CeRegexSearchResult_t ce_buffer_regex_search_backward(CeBuffer_t* buffer, CePoint_t start, const regex_t* regex);
 
 char* ce_buffer_dupe_string(CeBuffer_t* buffer, CePoint_t point, int64_t length);
+char* ce_buffer_dupe_shared_string(CeBuffer_t* buffer, CePoint_t point, int64_t length);
 char* ce_buffer_dupe(CeBuffer_t* buffer);
 
 bool ce_buffer_insert_string(CeBuffer_t* buffer, const char* string, CePoint_t point);
 bool ce_buffer_insert_rune(CeBuffer_t* buffer, CeRune_t rune, CePoint_t point); // TODO: unittest
 bool ce_buffer_remove_string(CeBuffer_t* buffer, CePoint_t point, int64_t length);
 bool ce_buffer_remove_lines(CeBuffer_t* buffer, int64_t line_start, int64_t lines_to_remove); // TODO: remove from view?
+// finds the unmatched left or right bracket nearest to point, skipping brackets in strings and comments, where level is
+// how many enclosing pairs to skip over. inclusive also considers a bracket at point
+bool ce_buffer_find_bracket_backward(CeBuffer_t* buffer, CePoint_t point, bool inclusive, CeRune_t left, CeRune_t right,
+                                     int64_t level, CePoint_t* match);
+bool ce_buffer_find_bracket_forward(CeBuffer_t* buffer, CePoint_t point, bool inclusive, CeRune_t left, CeRune_t right,
+                                    int64_t level, CePoint_t* match);
 
 // helper functions for common things I do
 bool ce_buffer_insert_string_change(CeBuffer_t* buffer, char* alloced_string, CePoint_t point, CePoint_t* cursor_before,
                                     CePoint_t cursor_after, bool chain_undo);
 bool ce_buffer_insert_string_change_at_cursor(CeBuffer_t* buffer, char* alloced_string, CePoint_t* cursor, bool chain_undo);
+// insert a single line string at each of the sorted points in one pass, recording a single change for all of them. the
+// points are updated to land just after their insertion
+bool ce_buffer_insert_string_change_at_points(CeBuffer_t* buffer, const char* string, CePoint_t* points,
+                                              int64_t point_count, bool chain_undo);
 bool ce_buffer_remove_string_change(CeBuffer_t* buffer, CePoint_t point, int64_t remove_len, CePoint_t* cursor_before,
                                     CePoint_t cursor_after, bool chain_undo);
+// remove length runes at each of the sorted points in one pass, recording a single change for all of them. removals
+// can't overlap or run off the end of their line. the points are updated to where they land once the text is gone
+bool ce_buffer_remove_string_change_at_points(CeBuffer_t* buffer, CePoint_t* points, int64_t point_count, int64_t length,
+                                              bool chain_undo);
+// replace line_count lines starting at first_line with new_line_count alloced new_lines, which the buffer takes
+// ownership of (but not the array holding them), as one undo step
+bool ce_buffer_replace_lines_change(CeBuffer_t* buffer, int64_t first_line, int64_t line_count, char** new_lines,
+                                    int64_t new_line_count, CePoint_t* cursor_before, CePoint_t cursor_after, bool chain_undo);
+// stable sort line_count lines starting at first_line by reordering the line pointers, as one undo step
+bool ce_buffer_sort_lines_change(CeBuffer_t* buffer, int64_t first_line, int64_t line_count, const CeSortOptions_t* options,
+                                 CePoint_t* cursor_before, CePoint_t cursor_after, bool chain_undo);
 
 bool ce_buffer_change(CeBuffer_t* buffer, CeBufferChange_t* change); // TODO: unittest
 bool ce_buffer_undo(CeBuffer_t* buffer, CePoint_t* cursor); // TODO: unittest
@@ -236,9 +326,17 @@ bool ce_point_after(CePoint_t a, CePoint_t b);
 bool ce_points_equal(CePoint_t a, CePoint_t b);
 bool ce_point_in_rect(CePoint_t a, CeRect_t r);
 
-bool ce_rune_node_insert(CeRuneNode_t** head, CeRune_t rune);
-CeRune_t* ce_rune_node_string(CeRuneNode_t* head);
-void ce_rune_node_free(CeRuneNode_t** head);
+bool ce_rune_array_append(CeRuneArray_t* array, CeRune_t rune);
+bool ce_rune_array_set(CeRuneArray_t* array, const CeRune_t* runes); // replaces the contents with a copy of runes
+void ce_rune_array_clear(CeRuneArray_t* array); // keeps the allocation around to record into again
+void ce_rune_array_free(CeRuneArray_t* array);
+
+// reference counted immutable strings, so yank registers and the undo history can hold the same text without copying it.
+// they read like any other nul terminated string, but are released instead of freed
+char* ce_shared_string_alloc(int64_t length); // the caller fills in the length bytes before handing it out
+char* ce_shared_string_dupe(const char* string);
+char* ce_shared_string_acquire(char* string);
+void ce_shared_string_release(char* string);
 
 char* ce_rune_string_to_char_string(const CeRune_t* int_str);
 CeRune_t* ce_char_string_to_rune_string(const char* char_str);
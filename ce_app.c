@@ -2,6 +2,7 @@
 #include "ce_commands.h"
 #include "ce_subprocess.h"
 #include "ce_syntax.h"
+#include "ce_syntax_worker.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -20,6 +21,8 @@
 
 int g_shell_command_ready_fds[2];
 bool g_shell_command_should_die = false;
+atomic_bool g_shell_command_wakeup_pending = false;
+volatile sig_atomic_t g_sigint_received = 0;
 
 bool ce_buffer_node_insert(CeBufferNode_t** head, CeBuffer_t* buffer){
      CeBufferNode_t* node = malloc(sizeof(*node));
@@ -32,7 +35,12 @@ bool ce_buffer_node_insert(CeBufferNode_t** head, CeBuffer_t* buffer){
 
 static void free_buffer_node(CeBufferNode_t* node){
      CeAppBufferData_t* buffer_data = node->buffer->app_data;
-     if(buffer_data) free(buffer_data->base_directory);
+     if(buffer_data){
+          free(buffer_data->base_directory);
+          ce_search_highlight_cache_free(&buffer_data->search_highlight_cache);
+          ce_syntax_worker_forget(&buffer_data->syntax_span_cache);
+          ce_syntax_span_cache_free(&buffer_data->syntax_span_cache);
+     }
      free(node->buffer->app_data);
      ce_buffer_free(node->buffer);
      free(node->buffer);
@@ -156,19 +164,82 @@ void ce_history_free(CeHistory_t* history){
      ce_string_node_free(&history->head);
 }
 
-void ce_convert_bind_defs(CeKeyBinds_t* binds, CeKeyBindDef_t* bind_defs, int64_t bind_def_count){
-     if(binds->count){
-          for(int64_t i = 0; i < binds->count; ++i){
-               free(binds->binds[i].keys);
+static void key_bind_node_free(CeKeyBindNode_t* node){
+     for(int64_t i = 0; i < node->child_count; i++){
+          key_bind_node_free(node->children + i);
+     }
+     free(node->children);
+     node->children = NULL;
+     node->child_count = 0;
+}
+
+// binary search since the children are sorted by key, returns where the key would be inserted if it isn't found
+static int64_t key_bind_node_child_index(CeKeyBindNode_t* node, int key, bool* found){
+     int64_t low = 0;
+     int64_t high = node->child_count;
+     while(low < high){
+          int64_t mid = (low + high) / 2;
+          if(node->children[mid].key < key){
+               low = mid + 1;
+          }else{
+               high = mid;
           }
-          free(binds->binds);
      }
+     *found = (low < node->child_count && node->children[low].key == key);
+     return low;
+}
+
+static bool key_bind_node_insert(CeKeyBindNode_t* root, CeKeyBind_t* bind, int64_t bind_index){
+     CeKeyBindNode_t* node = root;
+     for(int64_t k = 0; k < bind->key_count; k++){
+          bool found = false;
+          int64_t index = key_bind_node_child_index(node, bind->keys[k], &found);
+          if(!found){
+               CeKeyBindNode_t* new_children = realloc(node->children, (node->child_count + 1) * sizeof(*new_children));
+               if(!new_children) return false;
+               node->children = new_children;
+               memmove(node->children + index + 1, node->children + index, (node->child_count - index) * sizeof(*node->children));
+               node->child_count++;
+
+               CeKeyBindNode_t* child = node->children + index;
+               child->key = bind->keys[k];
+               child->bind_index = -1;
+               child->first_bind_index = bind_index;
+               child->children = NULL;
+               child->child_count = 0;
+          }
+
+          node = node->children + index;
+     }
+
+     // with duplicate key sequences, the first bind keeps the keys
+     if(node->bind_index < 0) node->bind_index = bind_index;
+     return true;
+}
+
+void ce_key_binds_free(CeKeyBinds_t* binds){
+     for(int64_t i = 0; i < binds->count; ++i){
+          ce_command_free(&binds->binds[i].command);
+          if(!binds->binds[i].key_count) continue;
+          free(binds->binds[i].keys);
+     }
+     free(binds->binds);
+     binds->binds = NULL;
+     binds->count = 0;
+     key_bind_node_free(&binds->root);
+}
+
+void ce_convert_bind_defs(CeKeyBinds_t* binds, CeKeyBindDef_t* bind_defs, int64_t bind_def_count){
+     ce_key_binds_free(binds);
 
      binds->count = bind_def_count;
      binds->binds = malloc(binds->count * sizeof(*binds->binds));
+     binds->root.bind_index = -1;
+     binds->root.first_bind_index = -1;
 
      for(int64_t i = 0; i < binds->count; ++i){
           ce_command_parse(&binds->binds[i].command, bind_defs[i].command);
+          binds->binds[i].command_entry_index = -1;
           binds->binds[i].key_count = 0;
 
           for(int k = 0; k < 4; ++k){
@@ -183,9 +254,25 @@ void ce_convert_bind_defs(CeKeyBinds_t* binds, CeKeyBindDef_t* bind_defs, int64_
           for(int k = 0; k < binds->binds[i].key_count; ++k){
                binds->binds[i].keys[k] = bind_defs[i].keys[k];
           }
+
+          if(!key_bind_node_insert(&binds->root, binds->binds + i, i)){
+               ce_log("%s() failed to add bind for '%s'\n", __FUNCTION__, binds->binds[i].command.name);
+          }
      }
 }
 
+CeKeyBindNode_t* ce_key_binds_find(CeKeyBinds_t* binds, const CeRune_t* keys, int64_t key_count){
+     CeKeyBindNode_t* node = &binds->root;
+     for(int64_t k = 0; k < key_count; k++){
+          bool found = false;
+          int64_t index = key_bind_node_child_index(node, keys[k], &found);
+          if(!found) return NULL;
+          node = node->children + index;
+     }
+
+     return node;
+}
+
 CeComplete_t* ce_app_is_completing(CeApp_t* app){
      if(app->input_complete_func && app->input_complete.count) return &app->input_complete;
      return NULL;
@@ -425,7 +512,7 @@ bool enable_input_mode(CeView_t* input_view, CeView_t* view, CeVim_t* vim, const
      input_view->buffer->no_line_numbers = true;
      input_view->cursor = (CePoint_t){0, 0};
      vim->mode = CE_VIM_MODE_INSERT;
-     ce_rune_node_free(&vim->insert_rune_head);
+     ce_rune_array_clear(&vim->insert_runes);
 
      return success;
 }
@@ -526,8 +613,14 @@ static bool string_ends_with(const char* str, const char* pattern){
 
 void determine_buffer_syntax(CeBuffer_t* buffer){
      CeAppBufferData_t* buffer_data = buffer->app_data;
-
-     if(string_ends_with(buffer->name, ".c") ||
+     buffer->syntax_data = NULL;
+
+     // syntax files the user has written take priority over the built in highlighters
+     CeSyntaxLanguage_t* language = ce_syntax_language_find(buffer->name);
+     if(language){
+          buffer_data->syntax_function = ce_syntax_highlight_language;
+          buffer->syntax_data = language;
+     }else if(string_ends_with(buffer->name, ".c") ||
         string_ends_with(buffer->name, ".h") ||
         string_ends_with(buffer->name, ".js")){
           buffer_data->syntax_function = ce_syntax_highlight_c;
@@ -811,16 +904,84 @@ void user_config_free(CeUserConfig_t* user_config){
 }
 
 void ce_multiple_cursors_add(CeMultipleCursors_t* multiple_cursors, CePoint_t point){
+     // keep the cursors sorted by position, so edits can be applied in one pass and overlaps found by neighbors
+     int64_t low = 0;
+     int64_t high = multiple_cursors->count;
+     while(low < high){
+          int64_t mid = low + (high - low) / 2;
+          if(ce_point_after(point, multiple_cursors->cursors[mid])) low = mid + 1;
+          else high = mid;
+     }
+     if(low < multiple_cursors->count && ce_points_equal(multiple_cursors->cursors[low], point)) return;
+
      int64_t new_count = multiple_cursors->count + 1;
      multiple_cursors->cursors = realloc(multiple_cursors->cursors, new_count * sizeof(multiple_cursors->cursors[0]));
      multiple_cursors->visuals = realloc(multiple_cursors->visuals, new_count * sizeof(multiple_cursors->visuals[0]));
      multiple_cursors->motion_columns = realloc(multiple_cursors->motion_columns, new_count * sizeof(multiple_cursors->motion_columns[0]));
-     multiple_cursors->cursors[multiple_cursors->count] = point;
-     multiple_cursors->visuals[multiple_cursors->count].point = point;
-     multiple_cursors->motion_columns[multiple_cursors->count] = point.x;
+     int64_t shift = multiple_cursors->count - low;
+     memmove(multiple_cursors->cursors + low + 1, multiple_cursors->cursors + low, shift * sizeof(multiple_cursors->cursors[0]));
+     memmove(multiple_cursors->visuals + low + 1, multiple_cursors->visuals + low, shift * sizeof(multiple_cursors->visuals[0]));
+     memmove(multiple_cursors->motion_columns + low + 1, multiple_cursors->motion_columns + low,
+             shift * sizeof(multiple_cursors->motion_columns[0]));
+     multiple_cursors->cursors[low] = point;
+     memset(multiple_cursors->visuals + low, 0, sizeof(multiple_cursors->visuals[0]));
+     multiple_cursors->visuals[low].point = point;
+     multiple_cursors->motion_columns[low] = point.x;
      multiple_cursors->count = new_count;
 }
 
+typedef struct{
+     CePoint_t cursor;
+     CeVimVisualData_t visual;
+     int64_t motion_column;
+}SortCursor_t;
+
+static int sort_cursor_compare(const void* a, const void* b){
+     CePoint_t left = ((const SortCursor_t*)(a))->cursor;
+     CePoint_t right = ((const SortCursor_t*)(b))->cursor;
+     if(left.y != right.y) return (left.y < right.y) ? -1 : 1;
+     if(left.x != right.x) return (left.x < right.x) ? -1 : 1;
+     return 0;
+}
+
+void ce_multiple_cursors_sort(CeMultipleCursors_t* multiple_cursors){
+     bool sorted = true;
+     for(int64_t i = 1; i < multiple_cursors->count && sorted; i++){
+          if(ce_point_after(multiple_cursors->cursors[i - 1], multiple_cursors->cursors[i])) sorted = false;
+     }
+
+     // the cursors live in separate arrays, so gather them up to sort them together
+     SortCursor_t* sort_cursors = sorted ? NULL : malloc(multiple_cursors->count * sizeof(*sort_cursors));
+     if(sort_cursors){
+          for(int64_t i = 0; i < multiple_cursors->count; i++){
+               sort_cursors[i].cursor = multiple_cursors->cursors[i];
+               sort_cursors[i].visual = multiple_cursors->visuals[i];
+               sort_cursors[i].motion_column = multiple_cursors->motion_columns[i];
+          }
+
+          qsort(sort_cursors, multiple_cursors->count, sizeof(*sort_cursors), sort_cursor_compare);
+
+          for(int64_t i = 0; i < multiple_cursors->count; i++){
+               multiple_cursors->cursors[i] = sort_cursors[i].cursor;
+               multiple_cursors->visuals[i] = sort_cursors[i].visual;
+               multiple_cursors->motion_columns[i] = sort_cursors[i].motion_column;
+          }
+
+          free(sort_cursors);
+     }
+
+     // merge cursors that have run into each other
+     int64_t kept = 0;
+     for(int64_t i = 0; i < multiple_cursors->count; i++){
+          if(kept > 0 && ce_points_equal(multiple_cursors->cursors[kept - 1], multiple_cursors->cursors[i])) continue;
+          multiple_cursors->cursors[kept] = multiple_cursors->cursors[i];
+          multiple_cursors->visuals[kept] = multiple_cursors->visuals[i];
+          multiple_cursors->motion_columns[kept] = multiple_cursors->motion_columns[i];
+          kept++;
+     }
+     multiple_cursors->count = kept;
+}
+
 void ce_multiple_cursors_clear(CeMultipleCursors_t* multiple_cursors){
      free(multiple_cursors->cursors);
      multiple_cursors->cursors = NULL;
@@ -874,6 +1035,129 @@ bool ce_destination_in_view(CeDestination_t* destination, CeView_t* view){
             ce_point_in_rect(destination->point, view_rect);
 }
 
+static uint64_t hash_line(const char* line){
+     // fnv-1a
+     uint64_t hash = 14695981039346656037ULL;
+     while(*line){
+          hash ^= (unsigned char)(*line);
+          hash *= 1099511628211ULL;
+          line++;
+     }
+     return hash;
+}
+
+static void search_highlight_line_add_match(CeSearchHighlightLine_t* line, int64_t start, int64_t end){
+     int64_t new_count = line->match_count + 1;
+     line->match_columns = realloc(line->match_columns, new_count * 2 * sizeof(line->match_columns[0]));
+     line->match_columns[line->match_count * 2] = start;
+     line->match_columns[line->match_count * 2 + 1] = end;
+     line->match_count = new_count;
+}
+
+static void search_highlight_line_find_matches(CeSearchHighlightCache_t* cache, CeSearchHighlightLine_t* line, char* text){
+     line->match_count = 0;
+
+     if(cache->search_mode == CE_VIM_SEARCH_MODE_FORWARD ||
+        cache->search_mode == CE_VIM_SEARCH_MODE_BACKWARD){
+          int64_t pattern_len = ce_utf8_strlen(cache->pattern);
+          char* match = NULL;
+          char* itr = text;
+          while((match = strstr(itr, cache->pattern))){
+               int64_t start = ce_utf8_strlen_between(text, match) - 1;
+               search_highlight_line_add_match(line, start, start + (pattern_len - 1));
+               itr = match + pattern_len;
+          }
+     }else if(cache->regex_compiled){
+          const size_t match_count = 1;
+          regmatch_t matches[match_count];
+          char* itr = text;
+          int64_t prev_end_x = 0;
+          while(itr){
+               int rc = regexec(&cache->regex, itr, match_count, matches, 0);
+               if(rc != 0) break;
+               int64_t match_len = matches[0].rm_eo - matches[0].rm_so;
+               if(match_len <= 0) break;
+               int64_t start = prev_end_x + matches[0].rm_so;
+               int64_t end = start + (match_len - 1);
+               search_highlight_line_add_match(line, start, end);
+               itr = ce_utf8_iterate_to(itr, matches[0].rm_so + match_len);
+               prev_end_x = end + 1;
+          }
+     }
+}
+
+static void search_highlight_cache_reset(CeSearchHighlightCache_t* cache, const char* pattern, CeVimSearchMode_t search_mode){
+     free(cache->pattern);
+     cache->pattern = strdup(pattern);
+     cache->search_mode = search_mode;
+
+     if(cache->regex_compiled){
+          regfree(&cache->regex);
+          cache->regex_compiled = false;
+     }
+
+     if(search_mode == CE_VIM_SEARCH_MODE_REGEX_FORWARD ||
+        search_mode == CE_VIM_SEARCH_MODE_REGEX_BACKWARD){
+          cache->regex_compiled = (regcomp(&cache->regex, pattern, REG_EXTENDED) == 0);
+     }
+
+     for(int64_t i = 0; i < cache->line_count; i++){
+          cache->lines[i].valid = false;
+     }
+}
+
+void ce_search_highlight_cache_apply(CeSearchHighlightCache_t* cache, CeBuffer_t* buffer, const char* pattern,
+                                     CeVimSearchMode_t search_mode, int64_t line_start, int64_t line_end,
+                                     CeRangeList_t* range_list){
+     if(!cache->pattern || cache->search_mode != search_mode || strcmp(cache->pattern, pattern) != 0){
+          search_highlight_cache_reset(cache, pattern, search_mode);
+     }
+
+     if(cache->line_count != buffer->line_count){
+          int64_t old_line_count = cache->line_count;
+          for(int64_t i = buffer->line_count; i < old_line_count; i++){
+               free(cache->lines[i].match_columns);
+          }
+          cache->lines = realloc(cache->lines, buffer->line_count * sizeof(cache->lines[0]));
+          if(buffer->line_count > old_line_count){
+               memset(cache->lines + old_line_count, 0, (buffer->line_count - old_line_count) * sizeof(cache->lines[0]));
+          }
+          cache->line_count = buffer->line_count;
+     }
+
+     // only lines whose contents changed since they were cached need to be searched again
+     bool buffer_changed = (cache->buffer_version != buffer->version);
+     cache->buffer_version = buffer->version;
+
+     for(int64_t i = line_start; i <= line_end && i < cache->line_count; i++){
+          CeSearchHighlightLine_t* line = cache->lines + i;
+          if(!line->valid || buffer_changed){
+               uint64_t hash = hash_line(buffer->lines[i]);
+               if(!line->valid || line->hash != hash){
+                    search_highlight_line_find_matches(cache, line, buffer->lines[i]);
+                    line->hash = hash;
+                    line->valid = true;
+               }
+          }
+
+          for(int64_t m = 0; m < line->match_count; m++){
+               CePoint_t start = {line->match_columns[m * 2], i};
+               CePoint_t end = {line->match_columns[m * 2 + 1], i};
+               ce_range_list_insert(range_list, start, end);
+          }
+     }
+}
+
+void ce_search_highlight_cache_free(CeSearchHighlightCache_t* cache){
+     for(int64_t i = 0; i < cache->line_count; i++){
+          free(cache->lines[i].match_columns);
+     }
+     free(cache->lines);
+     free(cache->pattern);
+     if(cache->regex_compiled) regfree(&cache->regex);
+     memset(cache, 0, sizeof(*cache));
+}
+
 void ce_app_init_default_commands(CeApp_t* app){
      CeCommandEntry_t command_entries[] = {
           {command_add_cursor, "add_cursor", "add cursor so you have multiple cursors to edit the buffer with"},
@@ -882,6 +1166,7 @@ void ce_app_init_default_commands(CeApp_t* app){
           {command_clear_cursors, "clear_cursors", "clear multiple cursors so you go back to having one cursor"},
           {command_command, "command", "interactively send a commmand"},
           {command_delete_layout, "delete_layout", "delete the current layout (unless it's the only one left)"},
+          {command_filter, "filter", "replace the lines in a visual range (or the whole buffer) with the output of the shell command given, which gets the lines on its stdin"},
           {command_goto_destination_in_line, "goto_destination_in_line", "scan current line for destination formats"},
           {command_goto_next_destination, "goto_next_destination", "find the next line in the buffer that contains a destination to goto"},
           {command_goto_prev_destination, "goto_prev_destination", "find the previous line in the buffer that contains a destination to goto"},
@@ -896,6 +1181,7 @@ void ce_app_init_default_commands(CeApp_t* app){
           {command_new_buffer, "new_buffer", "create a new buffer"},
           {command_new_tab, "new_tab", "create a new tab"},
           {command_noh, "noh", "turn off search highlighting"},
+          {command_perf_hud, "perf_hud", "toggle showing key latency and frame time percentiles in the status bar"},
           {command_quit, "quit", "quit ce"},
           {command_redraw, "redraw", "redraw the entire editor"},
           {command_regex_search, "regex_search", "interactive regex search 'forward' or 'backward'"},
@@ -916,6 +1202,7 @@ void ce_app_init_default_commands(CeApp_t* app){
           {command_show_jumps, "show_jumps", "show the state of your jumps"},
           {command_show_macros, "show_macros", "show the state of your macros"},
           {command_show_marks, "show_marks", "show the state of your vim marks"},
+          {command_show_perf, "show_perf", "show a per phase breakdown of frame timings"},
           {command_show_yanks, "show_yanks", "show the state of your vim yanks"},
           {command_split_layout, "split_layout", "split the current layout 'horizontal' or 'vertical' into 2 layouts"},
           {command_switch_buffer, "switch_buffer", "open dialogue to switch buffer by name"},
@@ -930,6 +1217,7 @@ void ce_app_init_default_commands(CeApp_t* app){
           {command_vim_find, "find", "vim's find command to search for files recursively"},
           {command_vim_make, "make", "vim's make command"},
           {command_vim_q, "q", "vim's q command to close the current window"},
+          {command_vim_sort, "sort", "vim's sort command to sort the lines in a visual range or the whole buffer. optionally pass flags 'r' (reverse), 'n' (numeric), 'u' (unique), 'i' (ignore case), a column to sort from and a '/regex/' to sort on what follows its match"},
           {command_vim_sp, "sp", "vim's sp command to split the window vertically. It optionally takes a file to open"},
           {command_vim_tabnew, "tabnew", "vim's tabnew command to create a new tab"},
           {command_vim_tabnext, "tabnext", "vim's tabnext command to select the next tab"},
@@ -951,6 +1239,33 @@ void ce_app_init_default_commands(CeApp_t* app){
      }
 }
 
+int64_t ce_app_find_command_entry(CeApp_t* app, const char* name){
+     for(int64_t i = 0; i < app->command_entry_count; i++){
+          if(strcmp(app->command_entries[i].name, name) == 0) return i;
+     }
+     return -1;
+}
+
+// binds remember which entry their command resolved to, so firing one doesn't search every command. the name is
+// checked in case the entries were replaced since, like after a config reload
+CeCommandEntry_t* ce_app_key_bind_command_entry(CeApp_t* app, CeKeyBind_t* bind){
+     int64_t index = bind->command_entry_index;
+     if(index < 0 || index >= app->command_entry_count ||
+        strcmp(app->command_entries[index].name, bind->command.name) != 0){
+          index = ce_app_find_command_entry(app, bind->command.name);
+          bind->command_entry_index = index;
+          if(index < 0) return NULL;
+     }
+     return app->command_entries + index;
+}
+
+void ce_app_resolve_key_binds(CeApp_t* app){
+     for(int64_t i = 0; i < app->key_binds.count; i++){
+          CeKeyBind_t* bind = app->key_binds.binds + i;
+          bind->command_entry_index = ce_app_find_command_entry(app, bind->command.name);
+     }
+}
+
 void ce_app_init_command_completion(CeApp_t* app, CeComplete_t* complete){
      const char** commands = malloc(app->command_entry_count * sizeof(*commands));
      const char** descriptions = malloc(app->command_entry_count * sizeof(*descriptions));
@@ -1021,7 +1336,7 @@ void ce_app_input(CeApp_t* app, const char* dialogue, CeInputCompleteFunc* input
      app->vim_visual_save.visual_point = app->visual.point;
 
      app->vim.mode = CE_VIM_MODE_INSERT;
-     ce_rune_node_free(&app->vim.insert_rune_head);
+     ce_rune_array_clear(&app->vim.insert_runes);
 
      app->input_complete_func = input_complete_func;
      ce_complete_free(&app->input_complete);
@@ -1115,18 +1430,10 @@ bool command_input_complete_func(CeApp_t* app, CeBuffer_t* input_buffer){
           if(!ce_command_parse(&command, app->input_view.buffer->lines[0])){
                ce_log("failed to parse command: '%s'\n", app->input_view.buffer->lines[0]);
           }else{
-               CeCommandFunc_t* command_func = NULL;
-               CeCommandEntry_t* entry = NULL;
-               for(int64_t i = 0; i < app->command_entry_count; i++){
-                    entry = app->command_entries + i;
-                    if(strcmp(entry->name, command.name) == 0){
-                         command_func = entry->func;
-                         break;
-                    }
-               }
-
-               if(command_func){
-                    CeCommandStatus_t cs = command_func(&command, app);
+               int64_t entry_index = ce_app_find_command_entry(app, command.name);
+               if(entry_index >= 0){
+                    CeCommandEntry_t* entry = app->command_entries + entry_index;
+                    CeCommandStatus_t cs = entry->func(&command, app);
                     switch(cs){
                     default:
                          break;
@@ -1200,8 +1507,8 @@ bool search_input_complete_func(CeApp_t* app, CeBuffer_t* input_buffer){
 
      // update yanks
      CeVimYank_t* yank = app->vim.yanks + ce_vim_register_index('/');
-     free(yank->text);
-     yank->text = strdup(app->input_view.buffer->lines[0]);
+     ce_vim_yank_free(yank);
+     yank->text = ce_shared_string_dupe(app->input_view.buffer->lines[0]);
      yank->type = CE_VIM_YANK_TYPE_STRING;
 
      // clear input buffer
@@ -1255,13 +1562,8 @@ bool replace_all_input_complete_func(CeApp_t* app, CeBuffer_t* input_buffer){
 bool edit_macro_input_complete_func(CeApp_t* app, CeBuffer_t* input_buffer){
      CeRune_t* rune_string = ce_char_string_to_rune_string(app->input_view.buffer->lines[0]);
      if(rune_string){
-          ce_rune_node_free(app->macros.rune_head + app->edit_register);
-          CeRune_t* itr = rune_string;
-          while(*itr){
-               ce_rune_node_insert(app->macros.rune_head + app->edit_register, *itr);
-               itr++;
-          }
-
+          // the edit gets its own copy, so a replay reading the old keys never sees them half changed
+          ce_rune_array_set(app->macros.registers + app->edit_register, rune_string);
           free(rune_string);
      }
      return true;
@@ -1283,7 +1585,11 @@ bool edit_yank_input_complete_func(CeApp_t* app, CeBuffer_t* input_buffer){
           }
           yank->type = yank_type;
      }else{
-          yank->text = ce_buffer_dupe(app->input_view.buffer);
+          char* text = ce_buffer_dupe(app->input_view.buffer);
+          if(text){
+               yank->text = ce_shared_string_dupe(text);
+               free(text);
+          }
           yank->type = yank_type;
      }
      return true;
@@ -1318,6 +1624,24 @@ void run_shell_command_cleanup(void* data){
      }
 }
 
+bool ce_app_wake_main_loop(){
+     // if the main loop hasn't consumed the last wakeup yet, it will see this output when it does
+     if(atomic_exchange(&g_shell_command_wakeup_pending, true)) return true;
+
+     int rc;
+     do{
+          rc = write(g_shell_command_ready_fds[1], "1", 2);
+     }while(rc == -1 && errno == EINTR);
+
+     if(rc < 0){
+          ce_log("%s() write() to terminal ready fd failed: %s", __FUNCTION__, strerror(errno));
+          atomic_store(&g_shell_command_wakeup_pending, false);
+          return false;
+     }
+
+     return true;
+}
+
 static void* run_shell_command_and_output_to_buffer(void* data){
      ShellCommandData_t* shell_command_data = (ShellCommandData_t*)(data);
 
@@ -1351,7 +1675,7 @@ static void* run_shell_command_and_output_to_buffer(void* data){
                return NULL;
           }
 
-          rc = read(stdout_fd, bytes, BUFSIZ);
+          rc = read(stdout_fd, bytes, BUFSIZ - 1);
           if(rc > 0){
                bytes[rc] = 0;
 
@@ -1361,12 +1685,7 @@ static void* run_shell_command_and_output_to_buffer(void* data){
                }
 
                ce_buffer_insert_string(shell_command_data->buffer, bytes, ce_buffer_end_point(shell_command_data->buffer));
-               do{
-                    rc = write(g_shell_command_ready_fds[1], "1", 2);
-               }while(rc == -1 && errno == EINTR);
-
-               if(rc < 0){
-                    ce_log("%s() write() to terminal ready fd failed: %s", __FUNCTION__, strerror(errno));
+               if(!ce_app_wake_main_loop()){
                     run_shell_command_cleanup(&cleanup);
                     return NULL;
                }
@@ -1401,12 +1720,7 @@ static void* run_shell_command_and_output_to_buffer(void* data){
 
      ce_buffer_insert_string(shell_command_data->buffer, bytes, ce_buffer_end_point(shell_command_data->buffer));
      shell_command_data->buffer->status = CE_BUFFER_STATUS_READONLY;
-     do{
-          rc = write(g_shell_command_ready_fds[1], "1", 2);
-     }while(rc == -1 && errno == EINTR);
-
-     if(rc < 0){
-          ce_log("%s() write() to terminal ready fd failed: %s", __FUNCTION__, strerror(errno));
+     if(!ce_app_wake_main_loop()){
           run_shell_command_cleanup(&cleanup);
           return NULL;
      }
@@ -7,11 +7,17 @@
 #include "ce_syntax.h"
 #include "ce_complete.h"
 #include "ce_macros.h"
+#include "ce_perf.h"
+
+#include <stdatomic.h>
+#include <signal.h>
 
 #define ENABLE_DEBUG_KEY_PRESS_INFO
 
 #define APP_MAX_KEY_COUNT 16
 #define JUMP_LIST_DESTINATION_COUNT 16
+#define APP_DEFAULT_SHELL_COMMAND_REDRAW_FPS 30
+#define APP_SYNTAX_WORKER_WAIT_USEC 4000 // how long a frame waits on the syntax worker before drawing plain text
 
 typedef struct CeBufferNode_t{
      CeBuffer_t* buffer;
@@ -33,12 +39,23 @@ typedef struct{
      int* keys;
      int64_t key_count;
      CeCommand_t command;
+     int64_t command_entry_index; // resolved from the command name, -1 if it hasn't been found
      CeVimMode_t vim_mode;
 }CeKeyBind_t;
 
+// prefix tree of the bound key sequences, so a key press only looks at binds that share the keys typed so far
+typedef struct CeKeyBindNode_t{
+     int key;
+     int64_t bind_index; // bind that ends on this key, -1 if none do
+     int64_t first_bind_index; // earliest bind going through this key, it wins when binds share a prefix
+     struct CeKeyBindNode_t* children; // sorted by key
+     int64_t child_count;
+}CeKeyBindNode_t;
+
 typedef struct{
      CeKeyBind_t* binds;
      int64_t count;
+     CeKeyBindNode_t root;
 }CeKeyBinds_t;
 
 typedef struct{
@@ -53,16 +70,47 @@ typedef struct{
      int64_t current;
 }CeJumpList_t;
 
+typedef struct{
+     uint64_t hash; // hash of the line contents the matches were found in
+     int64_t* match_columns; // pairs of start and end columns
+     int64_t match_count;
+     bool valid;
+}CeSearchHighlightLine_t;
+
+// search matches per line, reused across frames until the pattern or the line contents change
+typedef struct{
+     char* pattern;
+     CeVimSearchMode_t search_mode;
+     regex_t regex;
+     bool regex_compiled;
+     int64_t buffer_version;
+     CeSearchHighlightLine_t* lines;
+     int64_t line_count;
+}CeSearchHighlightCache_t;
+
 typedef struct{
      CeVimBufferData_t vim;
      int64_t last_goto_destination;
      CeSyntaxHighlightFunc_t* syntax_function;
      char* base_directory;
+     CeSearchHighlightCache_t search_highlight_cache;
+     CeSyntaxSpanCache_t syntax_span_cache;
 }CeAppBufferData_t;
 
+// what the view looked like the last time it was drawn, so unchanged views can be skipped
+typedef struct{
+     CeBuffer_t* buffer;
+     int64_t buffer_version;
+     CePoint_t cursor;
+     CePoint_t scroll;
+     CeRect_t rect;
+     int64_t syntax_generation;
+}CeViewDrawState_t;
+
 typedef struct{
      CeJumpList_t jump_list;
      CeBuffer_t* prev_buffer;
+     CeViewDrawState_t draw_state;
 }CeAppViewData_t;
 
 struct CeApp_t;
@@ -107,6 +155,7 @@ typedef struct CeApp_t{
      struct timeval message_time;
      CeLayout_t* tab_list_layout;
      CeSyntaxDef_t* syntax_defs;
+     CeColorDefs_t color_defs;
      CeBufferNode_t* buffer_node_head;
      CeCommandEntry_t* command_entries;
      int64_t command_entry_count;
@@ -118,6 +167,7 @@ typedef struct CeApp_t{
      CeBuffer_t* macro_list_buffer;
      CeBuffer_t* mark_list_buffer;
      CeBuffer_t* jump_list_buffer;
+     CeBuffer_t* perf_list_buffer;
      CeBuffer_t* shell_command_buffer;
      CeBuffer_t* last_goto_buffer;
      CeComplete_t input_complete;
@@ -151,6 +201,7 @@ typedef struct CeApp_t{
 
      // debug
      bool log_key_presses;
+     CePerf_t perf;
 }CeApp_t;
 
 bool ce_buffer_node_insert(CeBufferNode_t** head, CeBuffer_t* buffer);
@@ -168,6 +219,8 @@ void ce_history_reset_current(CeHistory_t* history);
 void ce_history_free(CeHistory_t* history);
 
 void ce_convert_bind_defs(CeKeyBinds_t* binds, CeKeyBindDef_t* bind_defs, int64_t bind_def_count);
+void ce_key_binds_free(CeKeyBinds_t* binds);
+CeKeyBindNode_t* ce_key_binds_find(CeKeyBinds_t* binds, const CeRune_t* keys, int64_t key_count);
 void ce_set_vim_key_bind(CeVimKeyBind_t* key_binds, int64_t* key_bind_count, CeRune_t key, CeVimParseFunc_t* parse_func);
 void ce_extend_commands(CeCommandEntry_t** command_entries, int64_t* command_entry_count, CeCommandEntry_t* new_command_entries,
                      int64_t new_command_entry_count);
@@ -206,6 +259,7 @@ bool user_config_init(CeUserConfig_t* user_config, const char* filepath);
 void user_config_free(CeUserConfig_t* user_config);
 
 void ce_multiple_cursors_add(CeMultipleCursors_t* multiple_cursors, CePoint_t point);
+void ce_multiple_cursors_sort(CeMultipleCursors_t* multiple_cursors); // sorts by position and merges overlapping cursors
 void ce_multiple_cursors_clear(CeMultipleCursors_t* multiple_cursors);
 void ce_multiple_cursors_toggle_active(CeMultipleCursors_t* multiple_cursors);
 
@@ -214,11 +268,19 @@ int64_t istrlen(const CeRune_t* istr);
 
 bool ce_destination_in_view(CeDestination_t* destination, CeView_t* view);
 
+void ce_search_highlight_cache_apply(CeSearchHighlightCache_t* cache, CeBuffer_t* buffer, const char* pattern,
+                                     CeVimSearchMode_t search_mode, int64_t line_start, int64_t line_end,
+                                     CeRangeList_t* range_list);
+void ce_search_highlight_cache_free(CeSearchHighlightCache_t* cache);
+
 void ce_app_clear_filepath_cache(CeApp_t* app);
 
 void ce_app_update_terminal_view(CeApp_t* app);
 
 void ce_app_init_default_commands(CeApp_t* app);
+int64_t ce_app_find_command_entry(CeApp_t* app, const char* name);
+CeCommandEntry_t* ce_app_key_bind_command_entry(CeApp_t* app, CeKeyBind_t* bind);
+void ce_app_resolve_key_binds(CeApp_t* app);
 void ce_app_init_command_completion(CeApp_t* app, CeComplete_t* complete);
 void ce_app_message(CeApp_t* app, const char* fmt, ...);
 void ce_app_input(CeApp_t* app, const char* dialogue, CeInputCompleteFunc* input_complete_func);
@@ -237,5 +299,9 @@ bool buffer_modified_outside_editor_complete_func(CeApp_t* app, CeBuffer_t* inpu
 
 bool ce_app_switch_to_prev_buffer_in_view(CeApp_t* app, CeView_t* view, bool switch_if_deleted);
 bool ce_app_run_shell_command(CeApp_t* app, const char* command, CeLayout_t* tab_layout, CeView_t* view, bool relative);
+// safe to call from any thread, makes the main loop wake up and redraw
+bool ce_app_wake_main_loop();
 
 extern int g_shell_command_ready_fds[2];
+extern atomic_bool g_shell_command_wakeup_pending; // set while a wakeup is in the pipe, the main loop clears it once consumed
+extern volatile sig_atomic_t g_sigint_received; // set by the SIGINT handler, clear it before waiting on something to interrupt
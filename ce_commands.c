@@ -1,4 +1,6 @@
 #include "ce_commands.h"
+#include "ce_draw.h"
+#include "ce_subprocess.h"
 
 #include <stdlib.h>
 #include <assert.h>
@@ -7,6 +9,7 @@
 #include <ncurses.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <poll.h>
 
 typedef struct{
      CeLayout_t* tab_layout;
@@ -255,6 +258,18 @@ CeCommandStatus_t command_show_jumps(CeCommand_t* command, void* user_data){
      return command_show_info_buffer(command, user_data, app->jump_list_buffer);
 }
 
+CeCommandStatus_t command_show_perf(CeCommand_t* command, void* user_data){
+     CeApp_t* app = user_data;
+     return command_show_info_buffer(command, user_data, app->perf_list_buffer);
+}
+
+CeCommandStatus_t command_perf_hud(CeCommand_t* command, void* user_data){
+     if(command->arg_count != 0) return CE_COMMAND_PRINT_HELP;
+     CeApp_t* app = user_data;
+     app->perf.show_hud = !app->perf.show_hud;
+     return CE_COMMAND_SUCCESS;
+}
+
 CeLayout_t* split_layout(CeApp_t* app, bool vertical){
      CeLayout_t* tab_layout = app->tab_list_layout->tab_list.current;
      CeLayout_t* new_layout = ce_layout_split(tab_layout, vertical);
@@ -890,7 +905,7 @@ CeCommandStatus_t command_switch_buffer(CeCommand_t* command, void* user_data){
 }
 
 CeCommandStatus_t command_redraw(CeCommand_t* command, void* user_data){
-     clear();
+     ce_draw_invalidate();
      return CE_COMMAND_SUCCESS;
 }
 
@@ -1119,6 +1134,7 @@ CeCommandStatus_t command_reload_config(CeCommand_t* command, void* user_data){
      user_config_free(&app->user_config);
      if(user_config_init(&app->user_config, config_path)){
           app->user_config.init_func(app);
+          ce_app_resolve_key_binds(app);
      }else{
           ce_app_message(app, "failed to reload config: '%s', see log for details", config_path);
           return CE_COMMAND_FAILURE;
@@ -1288,27 +1304,31 @@ CeCommandStatus_t command_man_page_on_word_under_cursor(CeCommand_t* command, vo
      return CE_COMMAND_SUCCESS;
 }
 
+// writes the arg followed by a space, returns -1 for an arg type we can't print
+static int command_arg_snprintf(char* buffer, int64_t buffer_size, CeCommandArg_t* arg){
+     switch(arg->type){
+     default:
+          break;
+     case CE_COMMAND_ARG_INTEGER:
+          return snprintf(buffer, buffer_size, "%ld ", arg->integer);
+     case CE_COMMAND_ARG_DECIMAL:
+          return snprintf(buffer, buffer_size, "%f ", arg->decimal);
+     case CE_COMMAND_ARG_STRING:
+          return snprintf(buffer, buffer_size, "%s ", arg->string);
+     }
+
+     return -1;
+}
+
 static char* build_string_from_command_args(CeCommand_t* command){
      char buffer[256];
      int64_t buffer_consumed = 0;
 
      char* result = NULL;
      for(int64_t i = 0; i < command->arg_count; i++){
-          int rc = 0;
+          if(command->args[i].type >= CE_COMMAND_ARG_COUNT) return result;
 
-          switch(command->args[i].type){
-          default:
-              return result;
-          case CE_COMMAND_ARG_INTEGER:
-               rc = snprintf(buffer + buffer_consumed, 256 - buffer_consumed, "%ld ", command->args[i].integer);
-               break;
-          case CE_COMMAND_ARG_DECIMAL:
-               rc = snprintf(buffer + buffer_consumed, 256 - buffer_consumed, "%f ", command->args[i].decimal);
-               break;
-          case CE_COMMAND_ARG_STRING:
-               rc = snprintf(buffer + buffer_consumed, 256 - buffer_consumed, "%s ", command->args[i].string);
-               break;
-          }
+          int rc = command_arg_snprintf(buffer + buffer_consumed, 256 - buffer_consumed, command->args + i);
 
           if(rc < 0){
                ce_log("snprintf() failed: %s\n", strerror(errno));
@@ -1365,6 +1385,109 @@ CeCommandStatus_t command_shell_command_relative(CeCommand_t* command, void* use
      return CE_COMMAND_SUCCESS;
 }
 
+// the lines in the visual range the command was entered from, or the whole buffer
+static void command_line_range(CeApp_t* app, CeView_t* view, int64_t* first_line, int64_t* last_line){
+     *first_line = 0;
+     *last_line = view->buffer->line_count - 1;
+     if(app->vim_visual_save.mode == CE_VIM_MODE_VISUAL ||
+        app->vim_visual_save.mode == CE_VIM_MODE_VISUAL_LINE ||
+        app->vim_visual_save.mode == CE_VIM_MODE_VISUAL_BLOCK){
+          *first_line = view->cursor.y;
+          *last_line = app->vim_visual_save.visual_point.y;
+          if(*first_line > *last_line){
+               int64_t tmp = *first_line;
+               *first_line = *last_line;
+               *last_line = tmp;
+          }
+     }
+}
+
+// the filter runs on the main thread, so give up on ctrl+c or a SIGINT. the terminal is raw, so ctrl+c shows up as a
+// key, and anything else typed while we wait is dropped
+static bool filter_should_stop(void* user_data){
+     bool* stopped = user_data;
+     if(g_sigint_received) *stopped = true;
+
+     struct pollfd stdin_poll = {STDIN_FILENO, POLLIN, 0};
+     while(!*stopped && poll(&stdin_poll, 1, 0) > 0 && (stdin_poll.revents & POLLIN)){
+          char keys[64];
+          ssize_t key_count = read(STDIN_FILENO, keys, sizeof(keys));
+          if(key_count <= 0) break;
+          if(memchr(keys, ce_ctrl_key('c'), key_count)) *stopped = true;
+     }
+
+     return *stopped;
+}
+
+CeCommandStatus_t command_filter(CeCommand_t* command, void* user_data){
+     if(command->arg_count < 1) return CE_COMMAND_PRINT_HELP;
+
+     CeApp_t* app = (CeApp_t*)(user_data);
+     CommandContext_t command_context = {};
+
+     if(!get_command_context(app, &command_context)) return CE_COMMAND_NO_ACTION;
+
+     CeView_t* view = command_context.view;
+     if(view->buffer->status == CE_BUFFER_STATUS_READONLY){
+          ce_app_message(app, "unable to filter readonly buffer '%s'", view->buffer->name);
+          return CE_COMMAND_NO_ACTION;
+     }
+
+     int64_t first_line = 0;
+     int64_t last_line = 0;
+     command_line_range(app, view, &first_line, &last_line);
+     int64_t line_count = last_line - first_line + 1;
+
+     char* command_args = build_string_from_command_args(command);
+     CeSubprocess_t subprocess;
+     if(!ce_subprocess_open(&subprocess, command_args)){
+          ce_app_message(app, "failed to run '%s': '%s'", command_args, strerror(errno));
+          free(command_args);
+          return CE_COMMAND_FAILURE;
+     }
+
+     // the lines are streamed straight out of the buffer, and the output comes back already split into lines
+     char** output_lines = NULL;
+     int64_t output_line_count = 0;
+     bool stopped = false;
+     g_sigint_received = 0;
+     bool success = ce_subprocess_filter_lines(&subprocess, view->buffer->lines + first_line, line_count,
+                                               &output_lines, &output_line_count, filter_should_stop, &stopped);
+     int status = ce_subprocess_close(&subprocess);
+
+     if(stopped){
+          ce_app_message(app, "'%s' interrupted, lines left unchanged", command_args);
+     }else if(success && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)){
+          if(WIFEXITED(status)){
+               ce_app_message(app, "'%s' exited with code %d, lines left unchanged", command_args, WEXITSTATUS(status));
+          }else{
+               ce_app_message(app, "'%s' did not exit cleanly, lines left unchanged", command_args);
+          }
+          success = false;
+     }
+     free(command_args);
+
+     // no output still leaves an empty line behind
+     if(success && output_line_count == 0){
+          free(output_lines);
+          output_lines = malloc(sizeof(*output_lines));
+          output_lines[0] = strdup("");
+          output_line_count = 1;
+     }
+
+     if(success){
+          success = ce_buffer_replace_lines_change(view->buffer, first_line, line_count, output_lines, output_line_count,
+                                                   &view->cursor, (CePoint_t){0, first_line}, false);
+     }
+
+     if(!success){
+          for(int64_t i = 0; i < output_line_count; i++) free(output_lines[i]);
+     }
+     free(output_lines);
+
+     return success ? CE_COMMAND_SUCCESS : CE_COMMAND_FAILURE;
+}
+
 void buffer_replace_all(CeBuffer_t* buffer, CePoint_t cursor, const char* match, const char* replacement, CePoint_t start, CePoint_t end,
                         bool regex_search){
      bool chain_undo = false;
@@ -1634,6 +1757,89 @@ CeCommandStatus_t command_vim_find(CeCommand_t* command, void* user_data){
      return CE_COMMAND_SUCCESS;
 }
 
+CeCommandStatus_t command_vim_sort(CeCommand_t* command, void* user_data){
+     CeApp_t* app = user_data;
+     CommandContext_t command_context = {};
+
+     if(!get_command_context(app, &command_context)) return CE_COMMAND_NO_ACTION;
+
+     CeSortOptions_t options = {};
+     char pattern[256];
+     int64_t pattern_len = 0;
+     bool has_pattern = false;
+     for(int64_t i = 0; i < command->arg_count; i++){
+          CeCommandArg_t* arg = command->args + i;
+          if(arg->type == CE_COMMAND_ARG_INTEGER){
+               if(arg->integer < 1) return CE_COMMAND_PRINT_HELP;
+               options.key_column = arg->integer - 1;
+          }else if(arg->type == CE_COMMAND_ARG_STRING && arg->string[0] == '/' && !has_pattern){
+               // the args were split on blanks, so join them back up to the one that closes the regex
+               has_pattern = true;
+               for(; i < command->arg_count; i++){
+                    arg = command->args + i;
+                    int rc = command_arg_snprintf(pattern + pattern_len, sizeof(pattern) - pattern_len, arg);
+                    if(rc < 0 || rc >= (int64_t)(sizeof(pattern)) - pattern_len){
+                         ce_app_message(app, "sort regex is longer than %ld characters", (int64_t)(sizeof(pattern)) - 1);
+                         return CE_COMMAND_FAILURE;
+                    }
+                    pattern_len += rc;
+
+                    if(arg->type == CE_COMMAND_ARG_STRING && pattern_len > 2 && pattern[pattern_len - 2] == '/') break;
+               }
+
+               // drop the trailing space
+               pattern[--pattern_len] = 0;
+          }else if(arg->type == CE_COMMAND_ARG_STRING){
+               for(const char* flag = arg->string; *flag; flag++){
+                    switch(*flag){
+                    default:
+                         return CE_COMMAND_PRINT_HELP;
+                    case 'r':
+                         options.reverse = true;
+                         break;
+                    case 'n':
+                         options.numeric = true;
+                         break;
+                    case 'u':
+                         options.unique = true;
+                         break;
+                    case 'i':
+                         options.ignore_case = true;
+                         break;
+                    }
+               }
+          }else{
+               return CE_COMMAND_PRINT_HELP;
+          }
+     }
+
+     CeView_t* view = command_context.view;
+     int64_t first_line = 0;
+     int64_t last_line = 0;
+     command_line_range(app, view, &first_line, &last_line);
+
+     regex_t regex;
+     if(has_pattern){
+          // drop the opening and closing slashes
+          if(pattern_len > 1 && pattern[pattern_len - 1] == '/') pattern[pattern_len - 1] = 0;
+          int rc = regcomp(&regex, pattern + 1, REG_EXTENDED);
+          if(rc != 0){
+               char error_buffer[BUFSIZ];
+               regerror(rc, &regex, error_buffer, BUFSIZ);
+               ce_app_message(app, "regcomp() failed: '%s'", error_buffer);
+               return CE_COMMAND_FAILURE;
+          }
+          options.key_regex = &regex;
+     }
+
+     bool success = ce_buffer_sort_lines_change(view->buffer, first_line, last_line - first_line + 1, &options,
+                                                &view->cursor, (CePoint_t){0, first_line}, false);
+     if(has_pattern) regfree(&regex);
+     if(!success) return CE_COMMAND_FAILURE;
+
+     return CE_COMMAND_SUCCESS;
+}
+
 CeCommandStatus_t command_vim_wqa(CeCommand_t* command, void* user_data){
      return command_save_all_and_quit(command, user_data);
 }
@@ -18,6 +18,8 @@ CeCommandStatus_t command_show_yanks(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_show_macros(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_show_marks(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_show_jumps(CeCommand_t* command, void* user_data);
+CeCommandStatus_t command_show_perf(CeCommand_t* command, void* user_data);
+CeCommandStatus_t command_perf_hud(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_balance_layout(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_split_layout(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_resize_layout(CeCommand_t* command, void* user_data);
@@ -37,6 +39,7 @@ CeCommandStatus_t command_regex_search(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_command(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_switch_buffer(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_redraw(CeCommand_t* command, void* user_data);
+CeCommandStatus_t command_filter(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_goto_destination_in_line(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_goto_next_destination(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_goto_prev_destination(CeCommand_t* command, void* user_data);
@@ -73,6 +76,7 @@ CeCommandStatus_t command_vim_cn(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_vim_cp(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_vim_make(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_vim_find(CeCommand_t* command, void* user_data);
+CeCommandStatus_t command_vim_sort(CeCommand_t* command, void* user_data);
 
 #ifdef ENABLE_DEBUG_KEY_PRESS_INFO
 CeCommandStatus_t command_toggle_log_keys_pressed(CeCommand_t* command, void* user_data);
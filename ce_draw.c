@@ -0,0 +1,304 @@
+#include "ce_draw.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <wchar.h>
+#include <ncurses.h>
+
+CeDraw_t g_draw = {};
+
+bool ce_draw_init(CeDrawBackend_t backend){
+     memset(&g_draw, 0, sizeof(g_draw));
+     g_draw.backend = backend;
+     g_draw.fg = COLOR_DEFAULT;
+     g_draw.bg = COLOR_DEFAULT;
+
+     // let curses do its initial screen clear now, so it doesn't wipe out our first frame later inside getch()
+     if(backend == CE_DRAW_BACKEND_VT100) refresh();
+     return true;
+}
+
+void ce_draw_free(){
+     free(g_draw.front);
+     free(g_draw.back);
+     free(g_draw.output);
+     memset(&g_draw, 0, sizeof(g_draw));
+}
+
+int ce_draw_rgb_to_256(int color){
+     if(!CE_COLOR_IS_RGB(color)) return color;
+     int r = (color >> 16) & 0xFF;
+     int g = (color >> 8) & 0xFF;
+     int b = color & 0xFF;
+
+     // grays get the finer grained gray ramp
+     if(r == g && g == b){
+          if(r < 8) return 16;
+          if(r > 248) return 231;
+          return 232 + ((r - 8) * 24) / 247;
+     }
+
+     // otherwise use the 6x6x6 color cube
+     return 16 + (36 * ((r * 5 + 127) / 255)) + (6 * ((g * 5 + 127) / 255)) + ((b * 5 + 127) / 255);
+}
+
+static void draw_clear_cells(CeDrawCell_t* cells, int64_t count){
+     for(int64_t i = 0; i < count; i++){
+          cells[i] = (CeDrawCell_t){' ', COLOR_DEFAULT, COLOR_DEFAULT};
+     }
+}
+
+void ce_draw_begin_frame(int64_t width, int64_t height){
+     if(g_draw.backend != CE_DRAW_BACKEND_VT100) return;
+     if(width == g_draw.width && height == g_draw.height && g_draw.back) return;
+
+     CeDrawCell_t* new_front = realloc(g_draw.front, width * height * sizeof(*new_front));
+     if(!new_front) return;
+     g_draw.front = new_front;
+     CeDrawCell_t* new_back = realloc(g_draw.back, width * height * sizeof(*new_back));
+     if(!new_back) return;
+     g_draw.back = new_back;
+     g_draw.width = width;
+     g_draw.height = height;
+     draw_clear_cells(g_draw.back, width * height);
+     g_draw.front_valid = false;
+
+     // curses repaints its own blank screen after a resize, get that out of the way before we draw
+     refresh();
+}
+
+void ce_draw_move(int64_t y, int64_t x){
+     if(g_draw.backend != CE_DRAW_BACKEND_VT100){
+          move(y, x);
+          return;
+     }
+
+     g_draw.y = y;
+     g_draw.x = x;
+}
+
+void ce_draw_color(CeColorDefs_t* color_defs, int fg, int bg){
+     if(g_draw.backend != CE_DRAW_BACKEND_VT100){
+          int color_pair = ce_color_def_get(color_defs, ce_draw_rgb_to_256(fg), ce_draw_rgb_to_256(bg));
+          attron(COLOR_PAIR(color_pair));
+          return;
+     }
+
+     g_draw.fg = fg;
+     g_draw.bg = bg;
+}
+
+void ce_draw_standend(){
+     if(g_draw.backend != CE_DRAW_BACKEND_VT100){
+          standend();
+          return;
+     }
+
+     g_draw.fg = COLOR_DEFAULT;
+     g_draw.bg = COLOR_DEFAULT;
+}
+
+static void draw_set_cell(int64_t y, int64_t x, CeRune_t rune){
+     if(y < 0 || y >= g_draw.height || x < 0 || x >= g_draw.width) return;
+     CeDrawCell_t* row = g_draw.back + y * g_draw.width;
+
+     // never leave half of a wide rune behind, blank out the other half when we draw over one
+     if(row[x].rune == CE_DRAW_CELL_CONTINUATION && rune != CE_DRAW_CELL_CONTINUATION && x > 0){
+          row[x - 1].rune = ' ';
+     }
+     if(x + 1 < g_draw.width && row[x + 1].rune == CE_DRAW_CELL_CONTINUATION){
+          row[x + 1].rune = ' ';
+     }
+
+     row[x] = (CeDrawCell_t){rune, g_draw.fg, g_draw.bg};
+}
+
+void ce_draw_rune(CeRune_t rune){
+     if(g_draw.backend != CE_DRAW_BACKEND_VT100){
+          if(rune < 0x80){
+               addch(rune);
+          }else{
+               char utf8_string[CE_UTF8_SIZE + 1];
+               int64_t bytes_written = 0;
+               ce_utf8_encode(rune, utf8_string, CE_UTF8_SIZE, &bytes_written);
+               utf8_string[bytes_written] = 0;
+               addstr(utf8_string);
+          }
+          return;
+     }
+
+     // wide runes take two columns, control characters are drawn as a single blank
+     int64_t rune_width = wcwidth(rune);
+     if(rune_width < 1) rune_width = 1;
+
+     // wrap like curses does when we run off the end of a line, a wide rune that doesn't fit goes on the next line
+     if(g_draw.x + rune_width > g_draw.width && g_draw.x < g_draw.width && rune_width > 1){
+          draw_set_cell(g_draw.y, g_draw.x, ' ');
+          g_draw.x = g_draw.width;
+     }
+     if(g_draw.x >= g_draw.width){
+          g_draw.x = 0;
+          g_draw.y++;
+     }
+
+     draw_set_cell(g_draw.y, g_draw.x, rune);
+     if(rune_width > 1) draw_set_cell(g_draw.y, g_draw.x + 1, CE_DRAW_CELL_CONTINUATION);
+     g_draw.x += rune_width;
+}
+
+void ce_draw_string(const char* string){
+     if(g_draw.backend != CE_DRAW_BACKEND_VT100){
+          addstr(string);
+          return;
+     }
+
+     int64_t rune_len = 0;
+     while(*string){
+          CeRune_t rune = ce_utf8_decode(string, &rune_len);
+          if(rune_len <= 0) break;
+          ce_draw_rune(rune);
+          string += rune_len;
+     }
+}
+
+void ce_draw_printf(const char* fmt, ...){
+     char string[BUFSIZ];
+     va_list args;
+     va_start(args, fmt);
+     vsnprintf(string, BUFSIZ, fmt, args);
+     va_end(args);
+     ce_draw_string(string);
+}
+
+void ce_draw_invalidate(){
+     if(g_draw.backend != CE_DRAW_BACKEND_VT100){
+          clear();
+          return;
+     }
+
+     g_draw.front_valid = false;
+}
+
+static bool draw_output_append(const char* string, int64_t len){
+     if(g_draw.output_len + len > g_draw.output_capacity){
+          int64_t new_capacity = g_draw.output_capacity ? g_draw.output_capacity * 2 : BUFSIZ;
+          while(new_capacity < g_draw.output_len + len) new_capacity *= 2;
+          char* new_output = realloc(g_draw.output, new_capacity);
+          if(!new_output) return false;
+          g_draw.output = new_output;
+          g_draw.output_capacity = new_capacity;
+     }
+
+     memcpy(g_draw.output + g_draw.output_len, string, len);
+     g_draw.output_len += len;
+     return true;
+}
+
+static void draw_output_printf(const char* fmt, ...){
+     char string[64];
+     va_list args;
+     va_start(args, fmt);
+     int len = vsnprintf(string, sizeof(string), fmt, args);
+     va_end(args);
+     if(len > 0) draw_output_append(string, len);
+}
+
+static void draw_output_color(int color, bool foreground){
+     if(color == COLOR_DEFAULT){
+          draw_output_printf(";%d", foreground ? 39 : 49);
+     }else if(CE_COLOR_IS_RGB(color)){
+          draw_output_printf(";%d;2;%d;%d;%d", foreground ? 38 : 48, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
+     }else if(color < 8){
+          draw_output_printf(";%d", (foreground ? 30 : 40) + color);
+     }else if(color < 16){
+          draw_output_printf(";%d", (foreground ? 90 : 100) + (color - 8));
+     }else{
+          draw_output_printf(";%d;5;%d", foreground ? 38 : 48, color);
+     }
+}
+
+void ce_draw_present(){
+     if(g_draw.backend != CE_DRAW_BACKEND_VT100){
+          refresh();
+          return;
+     }
+
+     if(!g_draw.back) return;
+
+     g_draw.output_len = 0;
+     draw_output_printf("\x1b[?25l");
+
+     if(!g_draw.front_valid){
+          // start from a cleared terminal and only send the cells that aren't blank
+          draw_output_printf("\x1b[0m\x1b[2J");
+          draw_clear_cells(g_draw.front, g_draw.width * g_draw.height);
+          g_draw.front_valid = true;
+     }
+
+     // where the terminal cursor is and what colors it is using, start out unknown so the first cell sets them
+     int64_t out_x = -1;
+     int64_t out_y = -1;
+     int out_fg = -2;
+     int out_bg = -2;
+
+     for(int64_t y = 0; y < g_draw.height; y++){
+          for(int64_t x = 0; x < g_draw.width; x++){
+               int64_t index = y * g_draw.width + x;
+               CeDrawCell_t* back = g_draw.back + index;
+               CeDrawCell_t* front = g_draw.front + index;
+               if(back->rune == front->rune && back->fg == front->fg && back->bg == front->bg) continue;
+
+               // the wide rune to the left changed with it and already drew this cell
+               if(back->rune == CE_DRAW_CELL_CONTINUATION){
+                    *front = *back;
+                    continue;
+               }
+
+               if(out_y != y || out_x != x){
+                    draw_output_printf("\x1b[%ld;%ldH", y + 1, x + 1);
+               }
+
+               if(out_fg != back->fg || out_bg != back->bg){
+                    draw_output_printf("\x1b[0");
+                    draw_output_color(back->fg, true);
+                    draw_output_color(back->bg, false);
+                    draw_output_printf("m");
+                    out_fg = back->fg;
+                    out_bg = back->bg;
+               }
+
+               CeRune_t rune = back->rune;
+               if(rune < 0x20 || rune == 0x7F) rune = ' ';
+               bool wide = (x + 1 < g_draw.width && back[1].rune == CE_DRAW_CELL_CONTINUATION);
+               char utf8_string[CE_UTF8_SIZE];
+               int64_t bytes_written = 0;
+               if(ce_utf8_encode(rune, utf8_string, CE_UTF8_SIZE, &bytes_written)){
+                    draw_output_append(utf8_string, bytes_written);
+               }
+
+               *front = *back;
+               out_y = y;
+               out_x = x + (wide ? 2 : 1);
+          }
+     }
+
+     draw_output_printf("\x1b[0m\x1b[%ld;%ldH\x1b[?25h", g_draw.y + 1, g_draw.x + 1);
+
+     // one write per frame, only looping if the terminal takes it in pieces
+     int64_t written = 0;
+     while(written < g_draw.output_len){
+          ssize_t rc = write(STDOUT_FILENO, g_draw.output + written, g_draw.output_len - written);
+          if(rc < 0){
+               if(errno == EINTR) continue;
+               ce_log("failed to write frame to terminal: '%s'\n", strerror(errno));
+               errno = 0;
+               g_draw.front_valid = false;
+               break;
+          }
+          written += rc;
+     }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ce.h"
+#include "ce_syntax.h"
+
+// 24 bit colors live above the 256 terminal colors, curses draws them with the closest 256 color match
+#define CE_COLOR_RGB_FLAG 0x1000000
+#define CE_COLOR_RGB(r, g, b) (CE_COLOR_RGB_FLAG | (((r) & 0xFF) << 16) | (((g) & 0xFF) << 8) | ((b) & 0xFF))
+#define CE_COLOR_IS_RGB(color) ((color) >= 0 && ((color) & CE_COLOR_RGB_FLAG))
+
+typedef enum{
+     CE_DRAW_BACKEND_NCURSES,
+     CE_DRAW_BACKEND_VT100, // draws into our own cell grid and writes the difference with escape sequences
+}CeDrawBackend_t;
+
+// the cell to the right of a wide rune, the terminal fills it in when it draws the rune
+#define CE_DRAW_CELL_CONTINUATION -1
+
+typedef struct{
+     CeRune_t rune;
+     int fg;
+     int bg;
+}CeDrawCell_t;
+
+typedef struct{
+     CeDrawBackend_t backend;
+     int64_t width;
+     int64_t height;
+     CeDrawCell_t* front; // what is on the terminal
+     CeDrawCell_t* back; // what we are drawing
+     bool front_valid;
+     int64_t x;
+     int64_t y;
+     int fg;
+     int bg;
+     char* output;
+     int64_t output_len;
+     int64_t output_capacity;
+}CeDraw_t;
+
+bool ce_draw_init(CeDrawBackend_t backend);
+void ce_draw_free();
+
+void ce_draw_begin_frame(int64_t width, int64_t height);
+void ce_draw_move(int64_t y, int64_t x);
+void ce_draw_color(CeColorDefs_t* color_defs, int fg, int bg);
+void ce_draw_standend();
+void ce_draw_rune(CeRune_t rune);
+void ce_draw_string(const char* string);
+void ce_draw_printf(const char* fmt, ...);
+void ce_draw_present(); // the terminal cursor is left at the last move
+void ce_draw_invalidate(); // repaint the whole terminal next frame
+
+int ce_draw_rgb_to_256(int color);
+
+extern CeDraw_t g_draw;
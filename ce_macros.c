@@ -2,20 +2,21 @@
 
 void ce_macros_free(CeMacros_t* macros){
      for(int64_t i = 0; i < CE_ASCII_PRINTABLE_CHARACTERS; i++){
-          ce_rune_node_free(macros->rune_head + i);
+          ce_rune_array_free(macros->registers + i);
      }
 }
 
 bool ce_macros_begin_recording(CeMacros_t* macros, unsigned char reg){
      if(reg < 33 || reg >= 177) return false; // ascii printable character range
+     if(macros->replaying[reg - '!']) return false;
      macros->recording = reg;
-     ce_rune_node_free(macros->rune_head + (reg - '!'));
+     ce_rune_array_clear(macros->registers + (reg - '!'));
      return true;
 }
 
 void ce_macros_record_key(CeMacros_t* macros, CeRune_t key){
      if(macros->recording < 33 || macros->recording >= 177) return;
-     ce_rune_node_insert(macros->rune_head + (macros->recording - '!'), key);
+     ce_rune_array_append(macros->registers + (macros->recording - '!'), key);
 }
 
 void ce_macros_end_recording(CeMacros_t* macros){
@@ -26,7 +27,13 @@ bool ce_macros_is_recording(CeMacros_t* macros){
      return (macros->recording >= 33 && macros->recording < 177);
 }
 
-CeRune_t* ce_macros_get_register_string(CeMacros_t* macros, unsigned char reg){
+CeRuneArray_t* ce_macros_get_register(CeMacros_t* macros, unsigned char reg){
      if(reg < 33 || reg >= 177) return 0; // NULL, why don't I have it defined here?
-     return ce_rune_node_string(macros->rune_head[reg - '!']);
+     return macros->registers + (reg - '!');
+}
+
+const CeRune_t* ce_macros_get_register_string(CeMacros_t* macros, unsigned char reg){
+     CeRuneArray_t* array = ce_macros_get_register(macros, reg);
+     if(!array || !array->count) return 0;
+     return array->runes;
 }
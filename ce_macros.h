@@ -1,8 +1,9 @@
 #include "ce.h"
 
 typedef struct{
-     CeRuneNode_t* rune_head[CE_ASCII_PRINTABLE_CHARACTERS];
+     CeRuneArray_t registers[CE_ASCII_PRINTABLE_CHARACTERS];
      unsigned char recording;
+     bool replaying[CE_ASCII_PRINTABLE_CHARACTERS]; // replays read the register in place, so it can't be recorded over
 }CeMacros_t;
 
 void ce_macros_free(CeMacros_t* macros);
@@ -10,4 +11,5 @@ bool ce_macros_begin_recording(CeMacros_t* macros, unsigned char reg);
 void ce_macros_record_key(CeMacros_t* macros, CeRune_t key);
 void ce_macros_end_recording(CeMacros_t* macros);
 bool ce_macros_is_recording(CeMacros_t* macros);
-CeRune_t* ce_macros_get_register_string(CeMacros_t* macros, unsigned char reg);
+CeRuneArray_t* ce_macros_get_register(CeMacros_t* macros, unsigned char reg);
+const CeRune_t* ce_macros_get_register_string(CeMacros_t* macros, unsigned char reg); // points into the register, don't free it
@@ -0,0 +1,79 @@
+#include "ce_perf.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+uint64_t ce_perf_now_usec(){
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return (uint64_t)(now.tv_sec) * 1000000ULL + (uint64_t)(now.tv_nsec / 1000);
+}
+
+void ce_perf_record(CePerf_t* perf, CePerfPhase_t phase, uint64_t usec){
+     CePerfHistogram_t* histogram = perf->phases + phase;
+     histogram->samples[histogram->next] = usec;
+     histogram->next = (histogram->next + 1) % CE_PERF_SAMPLE_COUNT;
+     if(histogram->sample_count < CE_PERF_SAMPLE_COUNT) histogram->sample_count++;
+     histogram->total_count++;
+     if(usec > histogram->max) histogram->max = usec;
+}
+
+void ce_perf_record_since(CePerf_t* perf, CePerfPhase_t phase, uint64_t start_usec){
+     ce_perf_record(perf, phase, ce_perf_now_usec() - start_usec);
+}
+
+static int compare_samples(const void* a, const void* b){
+     uint64_t sample_a = *(const uint64_t*)(a);
+     uint64_t sample_b = *(const uint64_t*)(b);
+     return (sample_a > sample_b) - (sample_a < sample_b);
+}
+
+CePerfPercentiles_t ce_perf_percentiles(CePerfHistogram_t* histogram){
+     CePerfPercentiles_t result = {};
+     if(histogram->sample_count == 0) return result;
+
+     uint64_t sorted[CE_PERF_SAMPLE_COUNT];
+     memcpy(sorted, histogram->samples, histogram->sample_count * sizeof(*sorted));
+     qsort(sorted, histogram->sample_count, sizeof(*sorted), compare_samples);
+
+     int64_t last = histogram->sample_count - 1;
+     result.p50 = sorted[(last * 50) / 100];
+     result.p95 = sorted[(last * 95) / 100];
+     result.p99 = sorted[(last * 99) / 100];
+     return result;
+}
+
+const char* ce_perf_phase_name(CePerfPhase_t phase){
+     switch(phase){
+     default:
+          break;
+     case CE_PERF_PHASE_HANDLE_KEY:
+          return "handle key";
+     case CE_PERF_PHASE_SEARCH_HIGHLIGHT:
+          return "search highlight";
+     case CE_PERF_PHASE_SYNTAX:
+          return "syntax";
+     case CE_PERF_PHASE_DRAW_LAYOUT:
+          return "draw layout";
+     case CE_PERF_PHASE_REFRESH:
+          return "refresh";
+     case CE_PERF_PHASE_FRAME:
+          return "frame";
+     case CE_PERF_PHASE_KEY_LATENCY:
+          return "key latency";
+     case CE_PERF_PHASE_MACRO_REPLAY:
+          return "macro replay";
+     }
+
+     return "unknown";
+}
+
+int64_t ce_perf_hud_string(CePerf_t* perf, char* string, int64_t string_len){
+     CePerfPercentiles_t latency = ce_perf_percentiles(perf->phases + CE_PERF_PHASE_KEY_LATENCY);
+     CePerfPercentiles_t frame = ce_perf_percentiles(perf->phases + CE_PERF_PHASE_FRAME);
+     return snprintf(string, string_len, "key %" PRIu64 "/%" PRIu64 "/%" PRIu64 "us frame %" PRIu64 "/%" PRIu64 "/%" PRIu64 "us",
+                     latency.p50, latency.p95, latency.p99, frame.p50, frame.p95, frame.p99);
+}
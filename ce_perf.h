@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CE_PERF_SAMPLE_COUNT 256
+
+typedef enum{
+     CE_PERF_PHASE_HANDLE_KEY,
+     CE_PERF_PHASE_SEARCH_HIGHLIGHT,
+     CE_PERF_PHASE_SYNTAX,
+     CE_PERF_PHASE_DRAW_LAYOUT,
+     CE_PERF_PHASE_REFRESH,
+     CE_PERF_PHASE_FRAME,
+     CE_PERF_PHASE_KEY_LATENCY, // from reading a key until the frame showing it is on the terminal
+     CE_PERF_PHASE_MACRO_REPLAY,
+     CE_PERF_PHASE_COUNT,
+}CePerfPhase_t;
+
+// rolling window of the most recent samples in microseconds
+typedef struct{
+     uint64_t samples[CE_PERF_SAMPLE_COUNT];
+     int64_t sample_count;
+     int64_t next;
+     uint64_t total_count;
+     uint64_t max;
+}CePerfHistogram_t;
+
+typedef struct{
+     uint64_t p50;
+     uint64_t p95;
+     uint64_t p99;
+}CePerfPercentiles_t;
+
+typedef struct{
+     CePerfHistogram_t phases[CE_PERF_PHASE_COUNT];
+     bool show_hud;
+}CePerf_t;
+
+uint64_t ce_perf_now_usec();
+void ce_perf_record(CePerf_t* perf, CePerfPhase_t phase, uint64_t usec);
+void ce_perf_record_since(CePerf_t* perf, CePerfPhase_t phase, uint64_t start_usec);
+CePerfPercentiles_t ce_perf_percentiles(CePerfHistogram_t* histogram);
+const char* ce_perf_phase_name(CePerfPhase_t phase);
+int64_t ce_perf_hud_string(CePerf_t* perf, char* string, int64_t string_len);
@@ -3,6 +3,22 @@
 #include <errno.h>
 #include <signal.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILTER_CHUNK_SIZE 65536
+#define FILTER_STOP_CHECK_MS 100
+
+typedef struct{
+     char** lines;
+     int64_t line_count;
+     int64_t line_capacity;
+     char* partial; // the start of a line we haven't seen the end of yet
+     int64_t partial_len;
+     int64_t partial_capacity;
+}FilterOutput_t;
 
 // NOTE: stderr is redirected to stdout
 static pid_t bidirectional_popen(const char* cmd, int* in_fd, int* out_fd){
@@ -23,6 +39,10 @@ static pid_t bidirectional_popen(const char* cmd, int* in_fd, int* out_fd){
           dup2(output_fds[1], STDOUT_FILENO);
           dup2(output_fds[1], STDERR_FILENO);
 
+          // don't hold on to the originals, or stdout never closes while the subprocess is still alive
+          close(input_fds[0]);
+          close(output_fds[1]);
+
           // TODO: run user's SHELL ?
           execl("/bin/sh", "/bin/sh", "-c", cmd, NULL);
      }else{
@@ -44,6 +64,171 @@ bool ce_subprocess_open(CeSubprocess_t* subprocess, const char* command){
      return true;
 }
 
+static bool filter_output_append_line(FilterOutput_t* output, const char* bytes, int64_t len){
+     if(output->line_count >= output->line_capacity){
+          int64_t new_capacity = output->line_capacity ? output->line_capacity * 2 : 1024;
+          char** new_lines = realloc(output->lines, new_capacity * sizeof(*new_lines));
+          if(!new_lines) return false;
+          output->lines = new_lines;
+          output->line_capacity = new_capacity;
+     }
+
+     char* line = malloc(output->partial_len + len + 1);
+     if(!line) return false;
+     memcpy(line, output->partial, output->partial_len);
+     memcpy(line + output->partial_len, bytes, len);
+     line[output->partial_len + len] = 0;
+     output->partial_len = 0;
+     output->lines[output->line_count++] = line;
+     return true;
+}
+
+static bool filter_output_append_partial(FilterOutput_t* output, const char* bytes, int64_t len){
+     if(output->partial_len + len > output->partial_capacity){
+          int64_t new_capacity = output->partial_capacity ? output->partial_capacity : 256;
+          while(new_capacity < output->partial_len + len) new_capacity *= 2;
+          char* new_partial = realloc(output->partial, new_capacity);
+          if(!new_partial) return false;
+          output->partial = new_partial;
+          output->partial_capacity = new_capacity;
+     }
+
+     memcpy(output->partial + output->partial_len, bytes, len);
+     output->partial_len += len;
+     return true;
+}
+
+static bool filter_output_consume(FilterOutput_t* output, const char* bytes, int64_t len){
+     const char* end = bytes + len;
+     while(bytes < end){
+          const char* newline = memchr(bytes, '\n', end - bytes);
+          if(!newline) return filter_output_append_partial(output, bytes, end - bytes);
+          if(!filter_output_append_line(output, bytes, newline - bytes)) return false;
+          bytes = newline + 1;
+     }
+     return true;
+}
+
+// copy as much of the input as fits into the chunk, picking up where the last chunk left off
+static int64_t filter_input_fill_chunk(char* chunk, char** lines, int64_t line_count, int64_t* line_index,
+                                       int64_t* line_offset){
+     int64_t len = 0;
+     while(len < FILTER_CHUNK_SIZE && *line_index < line_count){
+          const char* line = lines[*line_index];
+          int64_t copy_len = strnlen(line + *line_offset, FILTER_CHUNK_SIZE - len);
+          memcpy(chunk + len, line + *line_offset, copy_len);
+          len += copy_len;
+          *line_offset += copy_len;
+          if(len >= FILTER_CHUNK_SIZE) break;
+
+          chunk[len++] = '\n';
+          (*line_index)++;
+          *line_offset = 0;
+     }
+     return len;
+}
+
+bool ce_subprocess_filter_lines(CeSubprocess_t* subprocess, char** input_lines, int64_t input_line_count,
+                                char*** output_lines, int64_t* output_line_count,
+                                CeSubprocessStopFunc_t* should_stop, void* user_data){
+     int stdin_fd = subprocess->stdin_fd;
+     int stdout_fd = subprocess->stdout_fd;
+     fcntl(stdin_fd, F_SETFL, fcntl(stdin_fd, F_GETFL, 0) | O_NONBLOCK);
+     fcntl(stdout_fd, F_SETFL, fcntl(stdout_fd, F_GETFL, 0) | O_NONBLOCK);
+
+     char* input_chunk = malloc(FILTER_CHUNK_SIZE);
+     char* output_chunk = malloc(FILTER_CHUNK_SIZE);
+     if(!input_chunk || !output_chunk){
+          free(input_chunk);
+          free(output_chunk);
+          return false;
+     }
+
+     FilterOutput_t output = {};
+     int64_t line_index = 0;
+     int64_t line_offset = 0;
+     int64_t chunk_len = 0;
+     int64_t chunk_written = 0;
+     bool success = true;
+     bool stdout_open = true;
+
+     // a subprocess can close its stdout long before it has read all of its input, like 'cat > file', so keep going
+     // until both sides are done
+     while(stdout_open || subprocess->stdin){
+          // wake up every so often to ask whether to give up, a subprocess may never finish on its own
+          if(should_stop && should_stop(user_data)){
+               ce_subprocess_kill(subprocess, SIGKILL);
+               success = false;
+               break;
+          }
+
+          // poll skips negative fds, so a side we are done with just drops out
+          struct pollfd poll_fds[2] = {{stdout_open ? stdout_fd : -1, POLLIN, 0},
+                                       {subprocess->stdin ? stdin_fd : -1, POLLOUT, 0}};
+          int poll_rc = poll(poll_fds, 2, should_stop ? FILTER_STOP_CHECK_MS : -1);
+          if(poll_rc == 0) continue;
+          if(poll_rc < 0){
+               if(errno == EINTR) continue;
+               success = false;
+               break;
+          }
+
+          if(poll_fds[1].revents){
+               if(chunk_written >= chunk_len){
+                    chunk_len = filter_input_fill_chunk(input_chunk, input_lines, input_line_count, &line_index, &line_offset);
+                    chunk_written = 0;
+               }
+
+               if(chunk_len == 0){
+                    // let the subprocess know there is nothing left
+                    ce_subprocess_close_stdin(subprocess);
+               }else{
+                    ssize_t written = write(stdin_fd, input_chunk + chunk_written, chunk_len - chunk_written);
+                    if(written > 0){
+                         chunk_written += written;
+                    }else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+                         // the subprocess stopped reading, it still gets to finish writing its output
+                         ce_subprocess_close_stdin(subprocess);
+                    }
+               }
+          }
+
+          if(poll_fds[0].revents){
+               ssize_t bytes_read = read(stdout_fd, output_chunk, FILTER_CHUNK_SIZE);
+               if(bytes_read > 0){
+                    if(!filter_output_consume(&output, output_chunk, bytes_read)){
+                         success = false;
+                         break;
+                    }
+               }else if(bytes_read == 0){
+                    stdout_open = false;
+               }else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+                    success = false;
+                    break;
+               }
+          }
+     }
+
+     // output that doesn't end in a newline still ends in a line
+     if(success && output.partial_len > 0){
+          success = filter_output_append_line(&output, "", 0);
+     }
+
+     if(!success){
+          for(int64_t i = 0; i < output.line_count; i++) free(output.lines[i]);
+          free(output.lines);
+          output.lines = NULL;
+          output.line_count = 0;
+     }
+
+     free(output.partial);
+     free(input_chunk);
+     free(output_chunk);
+     *output_lines = output.lines;
+     *output_line_count = output.line_count;
+     return success;
+}
+
 void _close_file(FILE **file){
      FILE *to_close = *file;
      if(to_close == NULL) return;
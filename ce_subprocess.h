@@ -1,6 +1,7 @@
 #pragma once
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/wait.h>
 
 typedef struct{
@@ -17,6 +18,15 @@ typedef struct{
 bool ce_subprocess_open(CeSubprocess_t* subprocess, const char* command);
 // signal to the subprocess that you are done providing it input by closing stdin
 void ce_subprocess_close_stdin(CeSubprocess_t* subprocess);
+// checked while filtering, returning true kills the subprocess and gives up on its output
+typedef bool CeSubprocessStopFunc_t(void* user_data);
+
+// write each of the input lines followed by a newline to the subprocess's stdin while reading its stdout into alloced
+// output lines, polling both so neither side blocks the other. stdin is closed once all the input is written. uses the
+// file descriptors, so the FILE pointers should not be used alongside it. should_stop is optional
+bool ce_subprocess_filter_lines(CeSubprocess_t* subprocess, char** input_lines, int64_t input_line_count,
+                                char*** output_lines, int64_t* output_line_count,
+                                CeSubprocessStopFunc_t* should_stop, void* user_data);
 // send the specified signal to the subprocess
 void ce_subprocess_kill(CeSubprocess_t* subprocess, int signal);
 // close all subprocess fds and fps and wait for the subprocess to complete
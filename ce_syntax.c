@@ -4,8 +4,11 @@
 #include <ncurses.h>
 #include <string.h>
 #include <ctype.h>
-
-#define SEARCH_BACK_LINES 1024
+#include <pthread.h>
+#include <stdio.h>
+#include <errno.h>
+#include <dirent.h>
+#include <limits.h>
 
 int ce_syntax_def_get_fg(CeSyntaxDef_t* syntax_defs, CeSyntaxColor_t syntax_color, int current_fg){
      int new_color = syntax_defs[syntax_color].fg;
@@ -19,9 +22,45 @@ int ce_syntax_def_get_bg(CeSyntaxDef_t* syntax_defs, CeSyntaxColor_t syntax_colo
      return new_color;
 }
 
+#define ARENA_MIN_BLOCK_SIZE 4096
+
+void* ce_arena_alloc(CeArena_t* arena, int64_t size){
+     // keep every allocation aligned for any type
+     size = (size + sizeof(max_align_t) - 1) & ~(int64_t)(sizeof(max_align_t) - 1);
+
+     CeArenaBlock_t* block = arena->blocks;
+     if(!block || (block->used + size) > block->size){
+          // double the block size each time we run out, so a list needs very few mallocs
+          int64_t block_size = block ? block->size * 2 : ARENA_MIN_BLOCK_SIZE;
+          while(block_size < size) block_size *= 2;
+          CeArenaBlock_t* new_block = malloc(sizeof(*new_block) + block_size);
+          if(!new_block) return NULL;
+          new_block->next = block;
+          new_block->size = block_size;
+          new_block->used = 0;
+          arena->blocks = new_block;
+          block = new_block;
+     }
+
+     void* result = (char*)(block->data) + block->used;
+     block->used += size;
+     return result;
+}
+
+void ce_arena_free(CeArena_t* arena){
+     CeArenaBlock_t* itr = arena->blocks;
+     while(itr){
+          CeArenaBlock_t* tmp = itr;
+          itr = itr->next;
+          free(tmp);
+     }
+
+     arena->blocks = NULL;
+}
+
 bool ce_draw_color_list_insert(CeDrawColorList_t* list, int fg, int bg, CePoint_t point){
      if(list->tail && list->tail->fg == fg && list->tail->bg == bg && list->tail->point.y == point.y) return true;
-     CeDrawColorNode_t* node = malloc(sizeof(*node));
+     CeDrawColorNode_t* node = ce_arena_alloc(&list->arena, sizeof(*node));
      if(!node) return false;
      node->fg = fg;
      node->bg = bg;
@@ -34,20 +73,30 @@ bool ce_draw_color_list_insert(CeDrawColorList_t* list, int fg, int bg, CePoint_
 }
 
 void ce_draw_color_list_free(CeDrawColorList_t* list){
-     CeDrawColorNode_t* itr = list->head;
-     while(itr){
-          CeDrawColorNode_t* tmp = itr;
-          itr = itr->next;
-          free(tmp);
-     }
-
+     ce_arena_free(&list->arena);
      list->head = NULL;
      list->tail = NULL;
 }
 
+static bool range_list_index_insert(CeRangeList_t* list, int64_t index, CeRangeNode_t* node){
+     if(list->node_count >= list->node_capacity){
+          int64_t new_capacity = list->node_capacity ? list->node_capacity * 2 : 64;
+          CeRangeNode_t** new_nodes = realloc(list->nodes, new_capacity * sizeof(*new_nodes));
+          if(!new_nodes) return false;
+          list->nodes = new_nodes;
+          list->node_capacity = new_capacity;
+     }
+
+     memmove(list->nodes + index + 1, list->nodes + index, (list->node_count - index) * sizeof(*list->nodes));
+     list->nodes[index] = node;
+     list->node_count++;
+     return true;
+}
+
 bool ce_range_list_insert(CeRangeList_t* list, CePoint_t start, CePoint_t end){
-     CeRangeNode_t* node = malloc(sizeof(*node));
+     CeRangeNode_t* node = ce_arena_alloc(&list->arena, sizeof(*node));
      if(!node) return false;
+     if(!range_list_index_insert(list, list->node_count, node)) return false;
      node->range.start = start;
      node->range.end = end;
      node->next = NULL;
@@ -58,38 +107,31 @@ bool ce_range_list_insert(CeRangeList_t* list, CePoint_t start, CePoint_t end){
 }
 
 bool ce_range_list_insert_sorted(CeRangeList_t* list, CePoint_t start, CePoint_t end){
-     CeRangeNode_t* itr = list->head;
-     CeRangeNode_t* prev = NULL;
-     while(itr){
-          if(prev){
-               if(ce_point_after(itr->range.start, end) &&
-                  ce_point_after(end, prev->range.end)){
-                    break;
-               }
+     // binary search for the first range that starts after this one starts
+     int64_t low = 0;
+     int64_t high = list->node_count;
+     while(low < high){
+          int64_t mid = low + (high - low) / 2;
+          if(ce_point_after(list->nodes[mid]->range.start, start)){
+               high = mid;
           }else{
-               if(ce_point_after(itr->range.start, end)){
-                    break;
-               }
+               low = mid + 1;
           }
-
-          prev = itr;
-          itr = itr->next;
      }
 
-     if(itr){
-          if(!ce_point_after(end, itr->range.start)) return false;
-     }
+     CeRangeNode_t* prev = (low > 0) ? list->nodes[low - 1] : NULL;
+     CeRangeNode_t* itr = (low < list->node_count) ? list->nodes[low] : NULL;
 
-     CeRangeNode_t* node = malloc(sizeof(*node));
+     // ranges are inclusive and kept disjoint, so reject any that overlap a neighbor
+     if(prev && !ce_point_after(start, prev->range.end)) return false;
+     if(itr && !ce_point_after(itr->range.start, end)) return false;
+
+     CeRangeNode_t* node = ce_arena_alloc(&list->arena, sizeof(*node));
      if(!node) return false;
+     if(!range_list_index_insert(list, low, node)) return false;
      node->range.start = start;
      node->range.end = end;
-
-     if(!itr){
-          node->next = NULL;
-     }else{
-          node->next = itr;
-     }
+     node->next = itr;
 
      if(prev){
           prev->next = node;
@@ -97,17 +139,17 @@ bool ce_range_list_insert_sorted(CeRangeList_t* list, CePoint_t start, CePoint_t
           list->head = node;
      }
 
+     if(!itr) list->tail = node;
+
      return true;
 }
 
 void ce_range_list_free(CeRangeList_t* list){
-     CeRangeNode_t* itr = list->head;
-     while(itr){
-          CeRangeNode_t* tmp = itr;
-          itr = itr->next;
-          free(tmp);
-     }
-
+     ce_arena_free(&list->arena);
+     free(list->nodes);
+     list->nodes = NULL;
+     list->node_count = 0;
+     list->node_capacity = 0;
      list->head = NULL;
      list->tail = NULL;
 }
@@ -134,53 +176,146 @@ int ce_draw_color_list_next_to_last_fg_color(CeDrawColorList_t* draw_color_list)
      return fg;
 }
 
+static int64_t color_def_hash_slot(CeColorDefs_t* color_defs, int fg, int bg){
+     uint32_t hash = ((uint32_t)(fg + 1) * 2654435761u) ^ (uint32_t)(bg + 1);
+     int64_t slot = hash & (CE_COLOR_DEF_HASH_SIZE - 1);
+
+     // linear probe until we find the pair or an empty slot
+     while(color_defs->hash_table[slot]){
+          CeColorPair_t* pair = color_defs->pairs + color_defs->hash_table[slot];
+          if(pair->fg == fg && pair->bg == bg) break;
+          slot = (slot + 1) & (CE_COLOR_DEF_HASH_SIZE - 1);
+     }
+
+     return slot;
+}
+
+static void color_def_rebuild_hash_table(CeColorDefs_t* color_defs, int32_t skip_index){
+     memset(color_defs->hash_table, 0, sizeof(color_defs->hash_table));
+     for(int32_t i = 1; i < color_defs->count; i++){
+          if(i == skip_index) continue;
+          CeColorPair_t* pair = color_defs->pairs + i;
+          color_defs->hash_table[color_def_hash_slot(color_defs, pair->fg, pair->bg)] = i;
+     }
+}
+
+void ce_color_defs_begin_frame(CeColorDefs_t* color_defs, bool redraw_all){
+     color_defs->frame++;
+     color_defs->frame_redraws_all = redraw_all;
+     color_defs->evicted_pair_on_screen = false;
+}
+
 int ce_color_def_get(CeColorDefs_t* color_defs, int fg, int bg){
      // search for the already defined color
-     for(int32_t i = 0; i < color_defs->count; ++i){
-          if(color_defs->pairs[i].fg == fg && color_defs->pairs[i].bg == bg){
-               return i;
-          }
+     int64_t slot = color_def_hash_slot(color_defs, fg, bg);
+     int32_t index = color_defs->hash_table[slot];
+     if(index){
+          color_defs->pairs[index].last_used_frame = color_defs->frame;
+          return index;
      }
 
-     // increment the color pair we are going to define, but make sure it wraps around to 0 at the max
-     color_defs->current++;
-     color_defs->current %= 256;
-     if(color_defs->current <= 0) color_defs->current = 1; // when we wrap around, start at 1, because curses doesn't like 0 index color pairs
+     if(color_defs->count == 0) color_defs->count = 1; // start at 1, because curses doesn't like 0 index color pairs
 
-     // create the pair definition
-     init_pair(color_defs->current, fg, bg);
+     if(color_defs->count < CE_COLOR_PAIR_COUNT){
+          index = color_defs->count;
+          color_defs->count++;
+     }else{
+          // out of pairs, redefine the least recently used one
+          index = 1;
+          for(int32_t i = 2; i < color_defs->count; i++){
+               if(color_defs->pairs[i].last_used_frame < color_defs->pairs[index].last_used_frame) index = i;
+          }
 
-     // set our internal definition
-     color_defs->pairs[color_defs->current].fg = fg;
-     color_defs->pairs[color_defs->current].bg = bg;
+          // cells drawn in earlier frames with this pair change color unless everything is repainted
+          if(!color_defs->frame_redraws_all && color_defs->pairs[index].last_used_frame != color_defs->frame){
+               color_defs->evicted_pair_on_screen = true;
+          }
 
-     if(color_defs->current >= color_defs->count){
-          color_defs->count = color_defs->current + 1;
+          color_def_rebuild_hash_table(color_defs, index);
+          slot = color_def_hash_slot(color_defs, fg, bg);
      }
 
-     return color_defs->current;
+     // create the pair definition
+     init_pair(index, fg, bg);
+
+     // set our internal definition
+     color_defs->pairs[index].fg = fg;
+     color_defs->pairs[index].bg = bg;
+     color_defs->pairs[index].last_used_frame = color_defs->frame;
+     color_defs->hash_table[slot] = index;
+
+     return index;
 }
 
 static bool is_c_type_char(int ch){
      return isalnum(ch) || ch == '_';
 }
 
-static int64_t match_words(const char* str, const char* beginning_of_line, const char** words, int64_t word_count){
-     for(int64_t i = 0; i < word_count; ++i){
-          int64_t word_len = strlen(words[i]);
-          if(strncmp(words[i], str, word_len) == 0){
-               // make sure word isn't in the middle of an identifier
-               char post_char = str[word_len];
-               if(is_c_type_char(post_char)) return 0;
-               if(str > beginning_of_line){
-                    char pre_char = *(str - 1);
-                    if(is_c_type_char(pre_char)) return 0;
-               }
+#define KEYWORD_SET_MAX_SEEDS 4096
+
+static pthread_mutex_t keyword_set_build_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t keyword_hash(const char* str, int64_t len, uint32_t seed){
+     // fnv-1a
+     uint32_t hash = 2166136261u ^ seed;
+     for(int64_t i = 0; i < len; i++){
+          hash ^= (uint8_t)(str[i]);
+          hash *= 16777619u;
+     }
+     return hash;
+}
 
-               return word_len;
+static int64_t keyword_set_place(CeKeywordSet_t* set, uint32_t seed){
+     memset(set->slots, 0, sizeof(set->slots));
+     int64_t collisions = 0;
+     for(int64_t i = 0; i < set->word_count; i++){
+          uint32_t slot = keyword_hash(set->words[i], strlen(set->words[i]), seed) & (CE_KEYWORD_SET_SIZE - 1);
+          while(set->slots[slot]){
+               collisions++;
+               slot = (slot + 1) & (CE_KEYWORD_SET_SIZE - 1);
           }
+          set->slots[slot] = i + 1;
      }
+     return collisions;
+}
 
+static void keyword_set_build(CeKeywordSet_t* set){
+     pthread_mutex_lock(&keyword_set_build_lock);
+     if(!atomic_load(&set->built)){
+          // if no seed is collision free, we fall back to probing past the collisions on lookup
+          uint32_t seed = 0;
+          while(keyword_set_place(set, seed) > 0 && seed < (KEYWORD_SET_MAX_SEEDS - 1)) seed++;
+          set->seed = seed;
+          atomic_store(&set->built, true);
+     }
+     pthread_mutex_unlock(&keyword_set_build_lock);
+}
+
+// returns the index of the word or -1 if it isn't in the set
+static int64_t keyword_set_find(CeKeywordSet_t* set, const char* str, int64_t len){
+     if(!atomic_load(&set->built)) keyword_set_build(set);
+
+     uint32_t slot = keyword_hash(str, len, set->seed) & (CE_KEYWORD_SET_SIZE - 1);
+     while(set->slots[slot]){
+          int64_t index = set->slots[slot] - 1;
+          const char* word = set->words[index];
+          if(strncmp(word, str, len) == 0 && word[len] == 0) return index;
+          slot = (slot + 1) & (CE_KEYWORD_SET_SIZE - 1);
+     }
+
+     return -1;
+}
+
+static int64_t match_words(const char* str, const char* beginning_of_line, CeKeywordSet_t* keyword_set){
+     // keywords are whole identifiers, so don't bother looking in the middle of one
+     if(str > beginning_of_line && is_c_type_char(*(str - 1))) return 0;
+
+     const char* itr = str;
+     while(is_c_type_char(*itr)) itr++;
+     int64_t len = itr - str;
+     if(len == 0) return 0;
+
+     if(keyword_set_find(keyword_set, str, len) >= 0) return len;
      return 0;
 }
 
@@ -223,9 +358,9 @@ static int64_t match_c_type(const char* str, const char* beginning_of_line, bool
           "F64",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 static int64_t match_c_keyword(const char* str, const char* beginning_of_line){
@@ -255,9 +390,9 @@ static int64_t match_c_keyword(const char* str, const char* beginning_of_line){
           "while",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 static int64_t match_c_control(const char* str, const char* beginning_of_line){
@@ -269,9 +404,9 @@ static int64_t match_c_control(const char* str, const char* beginning_of_line){
           "return",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 static bool is_caps_var_char(int ch){
@@ -470,6 +605,87 @@ static int64_t match_trailing_whitespace(const char* str){
      return (itr - str);
 }
 
+// walks str forward from the rune at *str_index to the rune at index, so a whole line is decoded once
+static char* utf8_advance_to(char* str, int64_t* str_index, int64_t index){
+     while(*str_index < index && *str){
+          int64_t rune_len = 0;
+          ce_utf8_decode(str, &rune_len);
+          if(rune_len <= 0) break;
+          str += rune_len;
+          (*str_index)++;
+     }
+
+     return str;
+}
+
+// lexes from the last line we know the state of down to the requested line, remembering each line's starting state
+static int64_t lexer_state_at_line(CeBuffer_t* buffer, CeLexLineFunc_t* lex_line, void* lex_data, int64_t line){
+     CeLexerStateCache_t* cache = &buffer->lexer_state_cache;
+     if(cache->lex_line != lex_line || cache->lex_data != lex_data){
+          cache->lex_line = lex_line;
+          cache->lex_data = lex_data;
+          cache->valid_count = 0;
+     }
+     if(cache->valid_count > buffer->line_count) cache->valid_count = buffer->line_count;
+     if(line < cache->valid_count) return cache->states[line];
+
+     if(line >= cache->capacity){
+          int64_t new_capacity = cache->capacity ? cache->capacity : 64;
+          while(new_capacity <= line) new_capacity *= 2;
+          int64_t* new_states = realloc(cache->states, new_capacity * sizeof(*new_states));
+          if(!new_states){
+               ce_log("%s() failed to allocate %ld lexer states\n", __FUNCTION__, new_capacity);
+               return 0;
+          }
+          cache->states = new_states;
+          cache->capacity = new_capacity;
+     }
+
+     if(cache->valid_count == 0){
+          cache->states[0] = 0;
+          cache->valid_count = 1;
+     }
+
+     for(int64_t y = cache->valid_count; y <= line; y++){
+          cache->states[y] = lex_line(buffer->lines[y - 1], cache->states[y - 1], lex_data);
+     }
+
+     cache->valid_count = line + 1;
+     return cache->states[line];
+}
+
+// follows the c family highlighters through a line, only the tokens that can hide or open a multiline comment matter,
+// the rest are made up of characters that can't start one
+static int64_t lex_c_line(const char* line, int64_t state, void* data){
+     bool multiline_comment = state;
+     int64_t line_len = ce_utf8_strlen(line);
+     int64_t current_match_len = 1;
+     int64_t match_len = 0;
+     char* str = (char*)(line);
+     int64_t str_index = 0;
+     for(int64_t x = 0; x < line_len; ++x){
+          str = utf8_advance_to(str, &str_index, x);
+
+          if(current_match_len <= 1){
+               if(multiline_comment){
+                    if((match_len = match_c_multiline_comment_end(str))) multiline_comment = false;
+               }else if((match_len = match_c_comment(str)) ||
+                        (match_len = match_c_string(str)) ||
+                        (match_len = match_c_character_literal(str))){
+                    // skip over it
+               }else if((match_len = match_c_multiline_comment(str))){
+                    multiline_comment = true;
+               }
+
+               if(match_len) current_match_len = match_len;
+          }else{
+               current_match_len--;
+          }
+     }
+
+     return multiline_comment;
+}
+
 static void change_draw_color(CeDrawColorList_t* draw_color_list, CeSyntaxDef_t* syntax_defs, CeSyntaxColor_t syntax_color, CePoint_t point){
      int fg = ce_syntax_def_get_fg(syntax_defs, syntax_color, ce_draw_color_list_last_fg_color(draw_color_list));
      int bg = ce_syntax_def_get_bg(syntax_defs, syntax_color, ce_draw_color_list_last_bg_color(draw_color_list));
@@ -547,36 +763,12 @@ void ce_syntax_highlight_c(CeView_t* view, CeRangeList_t* highlight_range_list,
      CE_CLAMP(min, 0, clamp_max);
      CE_CLAMP(max, 0, clamp_max);
      int64_t match_len = 0;
-     bool multiline_comment = false;
+     bool multiline_comment = lexer_state_at_line(view->buffer, lex_c_line, NULL, min);
      bool in_visual = false;
      CeRangeNode_t* range_node = highlight_range_list->head;
 
      check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
 
-     int prepass_min = min - SEARCH_BACK_LINES;
-     if(prepass_min < 0) prepass_min = 0;
-
-     // pre-pass to check if we are in a multiline comment
-     for(int64_t y = prepass_min; y < min; y++){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
-
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
-
-               if(multiline_comment){
-                    if(match_c_multiline_comment_end(str)){
-                         multiline_comment = false;
-                    }
-               }else{
-                    if((match_len = match_c_multiline_comment(str))){
-                         multiline_comment = true;
-                         x += (match_len - 1);
-                    }
-               }
-          }
-     }
-
      for(int64_t y = min; y <= max; ++y){
           char* line = view->buffer->lines[y];
           int64_t line_len = ce_utf8_strlen(line);
@@ -591,8 +783,10 @@ void ce_syntax_highlight_c(CeView_t* view, CeRangeList_t* highlight_range_list,
 
           if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
 
+          char* str = line;
+          int64_t str_index = 0;
           for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
+               str = utf8_advance_to(str, &str_index, x);
                match_point.x = x;
 
                ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
@@ -711,9 +905,9 @@ static int64_t match_cpp_keyword(const char* str, const char* beginning_of_line)
           "while",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 static int64_t match_cpp_control(const char* str, const char* beginning_of_line){
@@ -729,9 +923,9 @@ static int64_t match_cpp_control(const char* str, const char* beginning_of_line)
           "try",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 
@@ -771,36 +965,12 @@ void ce_syntax_highlight_cpp(CeView_t* view, CeRangeList_t* highlight_range_list
      CE_CLAMP(min, 0, clamp_max);
      CE_CLAMP(max, 0, clamp_max);
      int64_t match_len = 0;
-     bool multiline_comment = false;
+     bool multiline_comment = lexer_state_at_line(view->buffer, lex_c_line, NULL, min);
      bool in_visual = false;
      CeRangeNode_t* range_node = highlight_range_list->head;
 
      check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
 
-     int prepass_min = min - SEARCH_BACK_LINES;
-     if(prepass_min < 0) prepass_min = 0;
-
-     // pre-pass to check if we are in a multiline comment
-     for(int64_t y = prepass_min; y < min; y++){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
-
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
-
-               if(multiline_comment){
-                    if(match_c_multiline_comment_end(str)){
-                         multiline_comment = false;
-                    }
-               }else{
-                    if((match_len = match_c_multiline_comment(str))){
-                         multiline_comment = true;
-                         x += (match_len - 1);
-                    }
-               }
-          }
-     }
-
      for(int64_t y = min; y <= max; ++y){
           char* line = view->buffer->lines[y];
           int64_t line_len = ce_utf8_strlen(line);
@@ -815,8 +985,10 @@ void ce_syntax_highlight_cpp(CeView_t* view, CeRangeList_t* highlight_range_list
 
           if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
 
+          char* str = line;
+          int64_t str_index = 0;
           for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
+               str = utf8_advance_to(str, &str_index, x);
                match_point.x = x;
 
                ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
@@ -888,9 +1060,9 @@ static int64_t match_java_type(const char* str, const char* beginning_of_line){
           "void",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 static int64_t match_java_keyword(const char* str, const char* beginning_of_line){
@@ -930,9 +1102,9 @@ static int64_t match_java_keyword(const char* str, const char* beginning_of_line
           "while",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 static int64_t match_java_control(const char* str, const char* beginning_of_line){
@@ -959,9 +1131,9 @@ static int64_t match_java_control(const char* str, const char* beginning_of_line
           "try",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 void ce_syntax_highlight_java(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
@@ -975,7 +1147,7 @@ void ce_syntax_highlight_java(CeView_t* view, CeRangeList_t* highlight_range_lis
      CE_CLAMP(min, 0, clamp_max);
      CE_CLAMP(max, 0, clamp_max);
      int64_t match_len = 0;
-     bool multiline_comment = false;
+     bool multiline_comment = lexer_state_at_line(view->buffer, lex_c_line, NULL, min);
      bool in_visual = false;
      CeRangeNode_t* range_node = highlight_range_list->head;
 
@@ -995,8 +1167,10 @@ void ce_syntax_highlight_java(CeView_t* view, CeRangeList_t* highlight_range_lis
 
           if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
 
+          char* str = line;
+          int64_t str_index = 0;
           for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
+               str = utf8_advance_to(str, &str_index, x);
                match_point.x = x;
 
                ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
@@ -1076,9 +1250,9 @@ static int64_t match_python_keyword(const char* str, const char* beginning_of_li
           "self",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 static int64_t match_python_control(const char* str, const char* beginning_of_line){
@@ -1093,9 +1267,9 @@ static int64_t match_python_control(const char* str, const char* beginning_of_li
           "try",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 static int64_t match_python_comment(const char* str){
@@ -1142,6 +1316,40 @@ static int64_t match_python_docstring(const char* str, PythonDocstring_t* python
      return 0;
 }
 
+// follows the python highlighter through a line, tracking whether we end inside a docstring
+static int64_t lex_python_line(const char* line, int64_t state, void* data){
+     PythonDocstring_t docstring = state;
+     int64_t line_len = ce_utf8_strlen(line);
+     int64_t current_match_len = 1;
+     int64_t match_len = 0;
+     char* str = (char*)(line);
+     int64_t str_index = 0;
+     for(int64_t x = 0; x < line_len; ++x){
+          str = utf8_advance_to(str, &str_index, x);
+
+          if(current_match_len <= 1){
+               match_len = 0;
+               if(docstring){
+                    if((docstring == PYTHON_DOCSTRING_DOUBLE_QUOTE && strncmp(str, "\"\"\"", 3) == 0) ||
+                       (docstring == PYTHON_DOCSTRING_SINGLE_QUOTE && strncmp(str, "'''", 3) == 0)){
+                         docstring = PYTHON_DOCSTRING_NONE;
+                         match_len = 3;
+                    }
+               }else if((match_len = match_python_comment(str)) ||
+                        (match_len = match_python_docstring(str, &docstring)) ||
+                        (match_len = match_python_string(str))){
+                    // skip over it
+               }
+
+               if(match_len) current_match_len = match_len;
+          }else{
+               current_match_len--;
+          }
+     }
+
+     return docstring;
+}
+
 void ce_syntax_highlight_python(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
                                 CeSyntaxDef_t* syntax_defs, void* user_data){
      if(!view->buffer) return;
@@ -1154,48 +1362,11 @@ void ce_syntax_highlight_python(CeView_t* view, CeRangeList_t* highlight_range_l
      CE_CLAMP(max, 0, clamp_max);
      int64_t match_len = 0;
      bool in_visual = false;
-     PythonDocstring_t docstring = PYTHON_DOCSTRING_NONE;
+     PythonDocstring_t docstring = lexer_state_at_line(view->buffer, lex_python_line, NULL, min);
      CeRangeNode_t* range_node = highlight_range_list->head;
 
      check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
 
-     int prepass_min = min - SEARCH_BACK_LINES;
-     if(prepass_min < 0) prepass_min = 0;
-
-     // pre-pass to check if we are in a multiline comment
-     for(int64_t y = prepass_min; y < min; y++){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
-
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
-
-               switch(docstring){
-               default:
-                    if((match_len = match_python_docstring(str, &docstring))){
-                         x += match_len;
-                    }
-                    break;
-               case PYTHON_DOCSTRING_DOUBLE_QUOTE:
-                    if(strncmp(str, "\"\"\"", 3) == 0){
-                         docstring = PYTHON_DOCSTRING_NONE;
-                         x += 3;
-                    }else if(match_len == 0){
-                         docstring = PYTHON_DOCSTRING_NONE;
-                    }
-                    break;
-               case PYTHON_DOCSTRING_SINGLE_QUOTE:
-                    if(strncmp(str, "'''", 3) == 0){
-                         docstring = PYTHON_DOCSTRING_NONE;
-                         x += 3;
-                    }else if(match_len == 0){
-                         docstring = PYTHON_DOCSTRING_NONE;
-                    }
-                    break;
-               }
-          }
-     }
-
      for(int64_t y = min; y <= max; ++y){
           char* line = view->buffer->lines[y];
           int64_t line_len = ce_utf8_strlen(line);
@@ -1210,8 +1381,10 @@ void ce_syntax_highlight_python(CeView_t* view, CeRangeList_t* highlight_range_l
 
           if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
 
+          char* str = line;
+          int64_t str_index = 0;
           for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
+               str = utf8_advance_to(str, &str_index, x);
                match_point.x = x;
 
                ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
@@ -1224,6 +1397,11 @@ void ce_syntax_highlight_python(CeView_t* view, CeRangeList_t* highlight_range_l
                          }else if(docstring == PYTHON_DOCSTRING_SINGLE_QUOTE && strncmp(str, "'''", 3) == 0){
                               docstring = PYTHON_DOCSTRING_NONE;
                               match_len = 3;
+                         }else if(((view->cursor.y != y) || (x > view->cursor.x)) && (match_len = match_trailing_whitespace(str))){
+                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
+                              ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
+                                                        ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
+                                                        (CePoint_t){0, match_point.y + 1});
                          }
                     }else{
                          if((match_len = match_c_type(str, line, false))){
@@ -1285,9 +1463,9 @@ static int64_t match_bash_keyword(const char* str, const char* beginning_of_line
           "coproc",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 void ce_syntax_highlight_bash(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
@@ -1316,8 +1494,10 @@ void ce_syntax_highlight_bash(CeView_t* view, CeRangeList_t* highlight_range_lis
 
           if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
 
+          char* str = line;
+          int64_t str_index = 0;
           for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
+               str = utf8_advance_to(str, &str_index, x);
                match_point.x = x;
 
                ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
@@ -1360,9 +1540,9 @@ static int64_t match_config_keyword(const char* str, const char* beginning_of_li
           "false",
      };
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     static CeKeywordSet_t keyword_set = {.words = keywords, .word_count = sizeof(keywords) / sizeof(keywords[0])};
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return match_words(str, beginning_of_line, &keyword_set);
 }
 
 void ce_syntax_highlight_config(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
@@ -1391,8 +1571,10 @@ void ce_syntax_highlight_config(CeView_t* view, CeRangeList_t* highlight_range_l
 
           if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
 
+          char* str = line;
+          int64_t str_index = 0;
           for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x); // TODO: decode rather than iterating to each time
+               str = utf8_advance_to(str, &str_index, x);
                match_point.x = x;
 
                ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
@@ -1527,3 +1709,658 @@ void ce_syntax_highlight_plain(CeView_t* view, CeRangeList_t* highlight_range_li
           check_visual_mode_end(range_node, &in_visual, match_point.y, line_len, draw_color_list);
      }
 }
+
+CeSyntaxLanguageList_t g_syntax_languages = {};
+
+#define LANGUAGE_BYTE_DELIMITER 0x1
+#define LANGUAGE_BYTE_IDENTIFIER 0x2
+#define LANGUAGE_BYTE_NUMBER 0x4
+
+typedef struct{
+     const char* name;
+     CeSyntaxColor_t color;
+}LanguageColorName_t;
+
+static LanguageColorName_t language_color_names[] = {
+     {"normal", CE_SYNTAX_COLOR_NORMAL},
+     {"type", CE_SYNTAX_COLOR_TYPE},
+     {"keyword", CE_SYNTAX_COLOR_KEYWORD},
+     {"control", CE_SYNTAX_COLOR_CONTROL},
+     {"caps_var", CE_SYNTAX_COLOR_CAPS_VAR},
+     {"comment", CE_SYNTAX_COLOR_COMMENT},
+     {"string", CE_SYNTAX_COLOR_STRING},
+     {"char_literal", CE_SYNTAX_COLOR_CHAR_LITERAL},
+     {"number_literal", CE_SYNTAX_COLOR_NUMBER_LITERAL},
+     {"literal", CE_SYNTAX_COLOR_LITERAL},
+     {"preprocessor", CE_SYNTAX_COLOR_PREPROCESSOR},
+};
+
+static bool language_color_from_name(const char* name, CeSyntaxColor_t* color){
+     int64_t name_count = sizeof(language_color_names) / sizeof(language_color_names[0]);
+     for(int64_t i = 0; i < name_count; i++){
+          if(strcmp(language_color_names[i].name, name) == 0){
+               *color = language_color_names[i].color;
+               return true;
+          }
+     }
+
+     return false;
+}
+
+static bool language_add_delimiter(CeSyntaxLanguage_t* language, const char* start, const char* end, char escape,
+                                   bool multiline, CeSyntaxColor_t color){
+     CeSyntaxDelimiter_t* new_delimiters = realloc(language->delimiters, (language->delimiter_count + 1) * sizeof(*new_delimiters));
+     if(!new_delimiters) return false;
+     language->delimiters = new_delimiters;
+
+     CeSyntaxDelimiter_t* delimiter = language->delimiters + language->delimiter_count;
+     delimiter->start = strdup(start);
+     delimiter->end = end ? strdup(end) : NULL;
+     delimiter->escape = escape;
+     delimiter->multiline = multiline;
+     delimiter->color = color;
+     language->delimiter_count++;
+     return true;
+}
+
+static bool language_add_word(CeSyntaxLanguage_t* language, const char* word, CeSyntaxColor_t color){
+     if(language->word_count >= CE_KEYWORD_SET_SIZE / 2) return false;
+
+     char** new_words = realloc(language->words, (language->word_count + 1) * sizeof(*new_words));
+     if(!new_words) return false;
+     language->words = new_words;
+     CeSyntaxColor_t* new_word_colors = realloc(language->word_colors, (language->word_count + 1) * sizeof(*new_word_colors));
+     if(!new_word_colors) return false;
+     language->word_colors = new_word_colors;
+
+     language->words[language->word_count] = strdup(word);
+     language->word_colors[language->word_count] = color;
+     language->word_count++;
+     return true;
+}
+
+static bool language_add_extension(CeSyntaxLanguage_t* language, const char* extension){
+     char** new_extensions = realloc(language->extensions, (language->extension_count + 1) * sizeof(*new_extensions));
+     if(!new_extensions) return false;
+     language->extensions = new_extensions;
+     language->extensions[language->extension_count] = strdup(extension);
+     language->extension_count++;
+     return true;
+}
+
+// parses one directive, returns false with a message if it doesn't make sense
+static bool language_parse_directive(CeSyntaxLanguage_t* language, char** args, int64_t arg_count, const char** error){
+     const char* directive = args[0];
+     CeSyntaxColor_t color = CE_SYNTAX_COLOR_NORMAL;
+
+     if(strcmp(directive, "name") == 0){
+          if(arg_count != 2){
+               *error = "expected 'name <name>'";
+               return false;
+          }
+          free(language->name);
+          language->name = strdup(args[1]);
+     }else if(strcmp(directive, "extensions") == 0){
+          for(int64_t i = 1; i < arg_count; i++){
+               if(!language_add_extension(language, args[i])) return false;
+          }
+     }else if(strcmp(directive, "line_comment") == 0){
+          if(arg_count != 2){
+               *error = "expected 'line_comment <start>'";
+               return false;
+          }
+          return language_add_delimiter(language, args[1], NULL, 0, false, CE_SYNTAX_COLOR_COMMENT);
+     }else if(strcmp(directive, "block_comment") == 0){
+          if(arg_count != 3){
+               *error = "expected 'block_comment <start> <end>'";
+               return false;
+          }
+          return language_add_delimiter(language, args[1], args[2], 0, true, CE_SYNTAX_COLOR_COMMENT);
+     }else if(strcmp(directive, "string") == 0 || strcmp(directive, "char") == 0){
+          if(arg_count < 2 || arg_count > 3 || (arg_count == 3 && strlen(args[2]) != 1)){
+               *error = "expected 'string <delimiter> [escape character]'";
+               return false;
+          }
+          color = (directive[0] == 's') ? CE_SYNTAX_COLOR_STRING : CE_SYNTAX_COLOR_CHAR_LITERAL;
+          return language_add_delimiter(language, args[1], args[1], (arg_count == 3) ? args[2][0] : 0, false, color);
+     }else if(strcmp(directive, "multiline_string") == 0){
+          if(arg_count != 3){
+               *error = "expected 'multiline_string <start> <end>'";
+               return false;
+          }
+          return language_add_delimiter(language, args[1], args[2], 0, true, CE_SYNTAX_COLOR_STRING);
+     }else if(strcmp(directive, "keywords") == 0){
+          if(arg_count < 2 || !language_color_from_name(args[1], &color)){
+               *error = "expected 'keywords <color> <word>...'";
+               return false;
+          }
+          for(int64_t i = 2; i < arg_count; i++){
+               if(!language_add_word(language, args[i], color)){
+                    *error = "too many keywords";
+                    return false;
+               }
+          }
+     }else if(strcmp(directive, "numbers") == 0){
+          language->numbers = true;
+     }else if(strcmp(directive, "caps_vars") == 0){
+          language->caps_vars = true;
+     }else{
+          *error = "unknown directive";
+          return false;
+     }
+
+     return true;
+}
+
+static void language_compile(CeSyntaxLanguage_t* language){
+     memset(language->byte_classes, 0, sizeof(language->byte_classes));
+
+     for(int64_t i = 0; i < language->delimiter_count; i++){
+          language->byte_classes[(uint8_t)(language->delimiters[i].start[0])] |= LANGUAGE_BYTE_DELIMITER;
+     }
+
+     for(int ch = 0; ch < 256; ch++){
+          if(isalpha(ch) || ch == '_') language->byte_classes[ch] |= LANGUAGE_BYTE_IDENTIFIER;
+          if(language->numbers && (isdigit(ch) || ch == '-' || ch == '.')) language->byte_classes[ch] |= LANGUAGE_BYTE_NUMBER;
+     }
+
+     memset(&language->keyword_set, 0, sizeof(language->keyword_set));
+     language->keyword_set.words = (const char**)(language->words);
+     language->keyword_set.word_count = language->word_count;
+     keyword_set_build(&language->keyword_set);
+}
+
+bool ce_syntax_language_load_string(CeSyntaxLanguage_t* language, const char* string, const char* name){
+     memset(language, 0, sizeof(*language));
+     language->name = strdup(name);
+
+     char* contents = strdup(string);
+     if(!contents) return false;
+
+     char* line_save = NULL;
+     int64_t line_number = 0;
+     bool success = true;
+     for(char* line = strtok_r(contents, "\n", &line_save); line; line = strtok_r(NULL, "\n", &line_save)){
+          line_number++;
+
+          char* args[CE_KEYWORD_SET_SIZE];
+          int64_t arg_count = 0;
+          char* arg_save = NULL;
+          for(char* arg = strtok_r(line, " \t\r", &arg_save); arg && arg_count < CE_KEYWORD_SET_SIZE; arg = strtok_r(NULL, " \t\r", &arg_save)){
+               args[arg_count] = arg;
+               arg_count++;
+          }
+
+          // skip blank lines and comments
+          if(arg_count == 0 || args[0][0] == '#') continue;
+
+          const char* error = "out of memory";
+          if(!language_parse_directive(language, args, arg_count, &error)){
+               ce_log("%s:%ld: %s\n", name, line_number, error);
+               success = false;
+               break;
+          }
+     }
+
+     free(contents);
+
+     if(!success){
+          ce_syntax_language_free(language);
+          return false;
+     }
+
+     language_compile(language);
+     return true;
+}
+
+bool ce_syntax_language_load_file(CeSyntaxLanguage_t* language, const char* filepath){
+     FILE* file = fopen(filepath, "r");
+     if(!file){
+          ce_log("failed to open syntax file '%s': '%s'\n", filepath, strerror(errno));
+          return false;
+     }
+
+     fseek(file, 0, SEEK_END);
+     long size = ftell(file);
+     fseek(file, 0, SEEK_SET);
+     if(size < 0){
+          fclose(file);
+          return false;
+     }
+
+     char* contents = malloc(size + 1);
+     if(!contents){
+          fclose(file);
+          return false;
+     }
+
+     size_t bytes_read = fread(contents, 1, size, file);
+     contents[bytes_read] = 0;
+     fclose(file);
+
+     // name the language after the file, unless it names itself
+     const char* name = strrchr(filepath, '/');
+     name = name ? name + 1 : filepath;
+     char* language_name = strdup(name);
+     char* extension = strrchr(language_name, '.');
+     if(extension && extension != language_name) *extension = 0;
+
+     bool success = ce_syntax_language_load_string(language, contents, language_name);
+     free(language_name);
+     free(contents);
+     return success;
+}
+
+void ce_syntax_language_free(CeSyntaxLanguage_t* language){
+     free(language->name);
+     for(int64_t i = 0; i < language->extension_count; i++) free(language->extensions[i]);
+     free(language->extensions);
+     for(int64_t i = 0; i < language->delimiter_count; i++){
+          free(language->delimiters[i].start);
+          free(language->delimiters[i].end);
+     }
+     free(language->delimiters);
+     for(int64_t i = 0; i < language->word_count; i++) free(language->words[i]);
+     free(language->words);
+     free(language->word_colors);
+     memset(language, 0, sizeof(*language));
+}
+
+int64_t ce_syntax_languages_load_directory(const char* directory){
+     DIR* dir = opendir(directory);
+     if(!dir) return 0;
+
+     int64_t loaded = 0;
+     struct dirent* entry;
+     while((entry = readdir(dir))){
+          int64_t name_len = strlen(entry->d_name);
+          if(name_len <= 7 || strcmp(entry->d_name + (name_len - 7), ".syntax") != 0) continue;
+
+          char filepath[PATH_MAX];
+          snprintf(filepath, PATH_MAX, "%s/%s", directory, entry->d_name);
+
+          CeSyntaxLanguage_t* language = malloc(sizeof(*language));
+          if(!language) break;
+          if(!ce_syntax_language_load_file(language, filepath)){
+               free(language);
+               continue;
+          }
+
+          CeSyntaxLanguage_t** new_languages = realloc(g_syntax_languages.languages,
+                                                       (g_syntax_languages.count + 1) * sizeof(*new_languages));
+          if(!new_languages){
+               ce_syntax_language_free(language);
+               free(language);
+               break;
+          }
+
+          g_syntax_languages.languages = new_languages;
+          g_syntax_languages.languages[g_syntax_languages.count] = language;
+          g_syntax_languages.count++;
+          loaded++;
+     }
+
+     closedir(dir);
+     return loaded;
+}
+
+CeSyntaxLanguage_t* ce_syntax_language_find(const char* filename){
+     int64_t filename_len = strlen(filename);
+     for(int64_t i = 0; i < g_syntax_languages.count; i++){
+          CeSyntaxLanguage_t* language = g_syntax_languages.languages[i];
+          for(int64_t e = 0; e < language->extension_count; e++){
+               int64_t extension_len = strlen(language->extensions[e]);
+               if(filename_len < extension_len) continue;
+               if(strcmp(filename + (filename_len - extension_len), language->extensions[e]) == 0) return language;
+          }
+     }
+
+     return NULL;
+}
+
+void ce_syntax_languages_free(){
+     for(int64_t i = 0; i < g_syntax_languages.count; i++){
+          ce_syntax_language_free(g_syntax_languages.languages[i]);
+          free(g_syntax_languages.languages[i]);
+     }
+
+     free(g_syntax_languages.languages);
+     memset(&g_syntax_languages, 0, sizeof(g_syntax_languages));
+}
+
+// the lexer state is 0 outside of a multiline delimiter, otherwise the delimiter's index + 1
+static int64_t language_match(CeSyntaxLanguage_t* language, const char* str, const char* line, int64_t* state,
+                              CeSyntaxColor_t* color){
+     if(*state){
+          CeSyntaxDelimiter_t* delimiter = language->delimiters + (*state - 1);
+          *color = delimiter->color;
+          if(delimiter->escape && *str == delimiter->escape && str[1]) return 2;
+          int64_t end_len = strlen(delimiter->end);
+          if(strncmp(str, delimiter->end, end_len) == 0){
+               *state = 0;
+               return ce_utf8_strlen_between(str, str + (end_len - 1));
+          }
+          return 0;
+     }
+
+     uint8_t byte_class = language->byte_classes[(uint8_t)(*str)];
+     if(!byte_class) return 0;
+
+     if(byte_class & LANGUAGE_BYTE_DELIMITER){
+          for(int64_t i = 0; i < language->delimiter_count; i++){
+               CeSyntaxDelimiter_t* delimiter = language->delimiters + i;
+               int64_t start_len = strlen(delimiter->start);
+               if(strncmp(str, delimiter->start, start_len) != 0) continue;
+
+               *color = delimiter->color;
+               if(!delimiter->end) return utf8_strlen_until_trailing_whitespace(str);
+
+               int64_t end_len = strlen(delimiter->end);
+               for(const char* itr = str + start_len; *itr; itr++){
+                    if(delimiter->escape && *itr == delimiter->escape && itr[1]){
+                         itr++;
+                         continue;
+                    }
+                    if(strncmp(itr, delimiter->end, end_len) == 0) return ce_utf8_strlen_between(str, itr + (end_len - 1));
+               }
+
+               // unterminated single line delimiters aren't highlighted, just like the c strings
+               if(!delimiter->multiline) continue;
+               *state = i + 1;
+               return utf8_strlen_until_trailing_whitespace(str);
+          }
+     }
+
+     // keywords are whole identifiers, so don't bother looking in the middle of one
+     if((byte_class & LANGUAGE_BYTE_IDENTIFIER) && (str == line || !is_c_type_char(*(str - 1)))){
+          const char* itr = str;
+          while(is_c_type_char(*itr)) itr++;
+          int64_t len = itr - str;
+
+          int64_t index = keyword_set_find(&language->keyword_set, str, len);
+          if(index >= 0){
+               *color = language->word_colors[index];
+          }else if(language->caps_vars && match_caps_var(str, line) == len){
+               *color = CE_SYNTAX_COLOR_CAPS_VAR;
+          }else{
+               *color = CE_SYNTAX_COLOR_NORMAL;
+          }
+          return len;
+     }
+
+     if(byte_class & LANGUAGE_BYTE_NUMBER){
+          int64_t len = match_c_literal(str, line);
+          if(len){
+               *color = CE_SYNTAX_COLOR_NUMBER_LITERAL;
+               return len;
+          }
+     }
+
+     return 0;
+}
+
+static int64_t lex_language_line(const char* line, int64_t state, void* data){
+     CeSyntaxLanguage_t* language = data;
+     int64_t line_len = ce_utf8_strlen(line);
+     int64_t current_match_len = 1;
+     CeSyntaxColor_t color;
+     char* str = (char*)(line);
+     int64_t str_index = 0;
+     for(int64_t x = 0; x < line_len; ++x){
+          str = utf8_advance_to(str, &str_index, x);
+
+          if(current_match_len <= 1){
+               int64_t match_len = language_match(language, str, line, &state, &color);
+               if(match_len) current_match_len = match_len;
+          }else{
+               current_match_len--;
+          }
+     }
+
+     return state;
+}
+
+void ce_syntax_highlight_language(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                                  CeSyntaxDef_t* syntax_defs, void* user_data){
+     CeSyntaxLanguage_t* language = user_data;
+     if(!language) return;
+     if(!view->buffer) return;
+     if(view->buffer->line_count <= 0) return;
+     int64_t min = view->scroll.y;
+     int64_t max = min + (view->rect.bottom - view->rect.top);
+     int64_t clamp_max = (view->buffer->line_count - 1);
+     if(clamp_max < 0) clamp_max = 0;
+     CE_CLAMP(min, 0, clamp_max);
+     CE_CLAMP(max, 0, clamp_max);
+     int64_t match_len = 0;
+     int64_t state = lexer_state_at_line(view->buffer, lex_language_line, language, min);
+     bool in_visual = false;
+     CeRangeNode_t* range_node = highlight_range_list->head;
+
+     check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
+
+     for(int64_t y = min; y <= max; ++y){
+          char* line = view->buffer->lines[y];
+          int64_t line_len = ce_utf8_strlen(line);
+          int64_t current_match_len = 1;
+          CePoint_t match_point = {0, y};
+
+          if(state){
+               change_draw_color(draw_color_list, syntax_defs, language->delimiters[state - 1].color, match_point);
+          }
+
+          ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
+
+          if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
+
+          char* str = line;
+          int64_t str_index = 0;
+          for(int64_t x = 0; x < line_len; ++x){
+               str = utf8_advance_to(str, &str_index, x);
+               match_point.x = x;
+
+               ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
+
+               if(current_match_len <= 1){
+                    bool in_delimiter = state;
+                    CeSyntaxColor_t color = CE_SYNTAX_COLOR_NORMAL;
+                    if((match_len = language_match(language, str, line, &state, &color))){
+                         if(color != CE_SYNTAX_COLOR_NORMAL || !draw_color_list->tail ||
+                            draw_color_list->tail->fg != COLOR_DEFAULT || draw_color_list->tail->bg != COLOR_DEFAULT){
+                              change_draw_color(draw_color_list, syntax_defs, color, match_point);
+                         }
+                    }else if(((view->cursor.y != y) || (x > view->cursor.x)) && (match_len = match_trailing_whitespace(str))){
+                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
+                         ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
+                                                   ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
+                                                   (CePoint_t){0, match_point.y + 1});
+                    }else if(!in_delimiter && (!draw_color_list->tail || (draw_color_list->tail->fg != COLOR_DEFAULT || draw_color_list->tail->bg != COLOR_DEFAULT))){
+                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NORMAL, match_point);
+                    }
+
+                    if(match_len) current_match_len = match_len;
+               }else{
+                    current_match_len--;
+               }
+
+               if(in_visual) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
+          }
+
+          check_visual_mode_end(range_node, &in_visual, match_point.y, line_len, draw_color_list);
+     }
+}
+
+bool ce_syntax_get_lexer(CeSyntaxHighlightFunc_t* syntax_function, void* syntax_data, CeLexLineFunc_t** lex_line, void** lex_data){
+     if(syntax_function == ce_syntax_highlight_c ||
+        syntax_function == ce_syntax_highlight_cpp ||
+        syntax_function == ce_syntax_highlight_java){
+          *lex_line = lex_c_line;
+          *lex_data = NULL;
+          return true;
+     }
+
+     if(syntax_function == ce_syntax_highlight_python){
+          *lex_line = lex_python_line;
+          *lex_data = NULL;
+          return true;
+     }
+
+     if(syntax_function == ce_syntax_highlight_language){
+          *lex_line = lex_language_line;
+          *lex_data = syntax_data;
+          return true;
+     }
+
+     return false;
+}
+
+void ce_lexer_state_cache_install(CeLexerStateCache_t* cache, CeLexLineFunc_t* lex_line, void* lex_data, int64_t first_line,
+                                  const int64_t* states, int64_t state_count){
+     if(cache->lex_line != lex_line || cache->lex_data != lex_data){
+          // the first line always starts out with no state, so we can start over from there
+          if(first_line != 0) return;
+          cache->lex_line = lex_line;
+          cache->lex_data = lex_data;
+          cache->valid_count = 0;
+     }
+
+     if(first_line > 0 && cache->valid_count <= first_line) return;
+     int64_t new_valid_count = first_line + state_count;
+     if(new_valid_count <= cache->valid_count) return;
+
+     if(new_valid_count > cache->capacity){
+          int64_t new_capacity = cache->capacity ? cache->capacity : 64;
+          while(new_capacity < new_valid_count) new_capacity *= 2;
+          int64_t* new_states = realloc(cache->states, new_capacity * sizeof(*new_states));
+          if(!new_states) return;
+          cache->states = new_states;
+          cache->capacity = new_capacity;
+     }
+
+     memcpy(cache->states + first_line, states, state_count * sizeof(*states));
+     cache->valid_count = new_valid_count;
+}
+
+void ce_syntax_span_cache_reset(CeSyntaxSpanCache_t* cache, int64_t buffer_version, CeSyntaxHighlightFunc_t* syntax_function,
+                                void* syntax_data, int64_t line_count){
+     cache->syntax_function = syntax_function;
+     cache->syntax_data = syntax_data;
+     ce_syntax_span_cache_invalidate_after(cache, buffer_version, 0, line_count);
+}
+
+void ce_syntax_span_cache_invalidate_after(CeSyntaxSpanCache_t* cache, int64_t buffer_version, int64_t first_line,
+                                           int64_t line_count){
+     // a line's highlighting only depends on the lines above it, so an edit can't change the lines before it
+     if(first_line < 0) first_line = 0;
+     if(first_line > cache->line_count) first_line = cache->line_count;
+     if(first_line > line_count) first_line = line_count;
+
+     for(int64_t i = first_line; i < cache->line_count; i++){
+          free(cache->lines[i].spans);
+     }
+
+     if(line_count != cache->line_count){
+          CeSyntaxSpanLine_t* new_lines = realloc(cache->lines, line_count * sizeof(*new_lines));
+          if(!new_lines && line_count > 0){
+               for(int64_t i = 0; i < first_line; i++){
+                    free(cache->lines[i].spans);
+               }
+               free(cache->lines);
+               cache->lines = NULL;
+               cache->line_count = 0;
+               return;
+          }
+          cache->lines = new_lines;
+          cache->line_count = line_count;
+     }
+
+     memset(cache->lines + first_line, 0, (cache->line_count - first_line) * sizeof(*cache->lines));
+     cache->requested_version = -1;
+     cache->buffer_version = buffer_version;
+     cache->generation++;
+}
+
+void ce_syntax_span_cache_free(CeSyntaxSpanCache_t* cache){
+     for(int64_t i = 0; i < cache->line_count; i++){
+          free(cache->lines[i].spans);
+     }
+
+     free(cache->lines);
+     memset(cache, 0, sizeof(*cache));
+}
+
+void ce_syntax_highlight_spans(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                               CeSyntaxDef_t* syntax_defs, void* user_data){
+     CeSyntaxSpanCache_t* cache = user_data;
+     if(!cache) return;
+     if(!view->buffer) return;
+     if(view->buffer->line_count <= 0) return;
+     int64_t min = view->scroll.y;
+     int64_t max = min + (view->rect.bottom - view->rect.top);
+     int64_t clamp_max = (view->buffer->line_count - 1);
+     if(clamp_max < 0) clamp_max = 0;
+     CE_CLAMP(min, 0, clamp_max);
+     CE_CLAMP(max, 0, clamp_max);
+     bool in_visual = false;
+     CeRangeNode_t* range_node = highlight_range_list->head;
+
+     check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
+
+     for(int64_t y = min; y <= max; ++y){
+          int64_t line_len = ce_utf8_strlen(view->buffer->lines[y]);
+          CePoint_t match_point = {0, y};
+          CeSyntaxSpan_t* spans = NULL;
+          int64_t span_count = 0;
+          int64_t span_index = 0;
+          bool trailing_whitespace_pending = false;
+
+          // lines the worker hasn't gotten to yet are drawn as plain text
+          if(y < cache->line_count && cache->lines[y].highlighted){
+               spans = cache->lines[y].spans;
+               span_count = cache->lines[y].span_count;
+          }else{
+               change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NORMAL, match_point);
+          }
+
+          // colors that start the line apply even if it is empty
+          while(span_index < span_count && spans[span_index].x == 0 && line_len == 0){
+               change_draw_color(draw_color_list, syntax_defs, spans[span_index].color, match_point);
+               span_index++;
+          }
+
+          ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
+
+          if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
+
+          for(int64_t x = 0; x < line_len; ++x){
+               match_point.x = x;
+
+               ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
+
+               bool changed = false;
+               while(span_index < span_count && spans[span_index].x <= x){
+                    CeSyntaxColor_t color = spans[span_index].color;
+                    span_index++;
+
+                    // the worker doesn't know where the cursor is, don't show trailing whitespace we may still be typing
+                    if(color == CE_SYNTAX_COLOR_TRAILING_WHITESPACE && view->cursor.y == y && x <= view->cursor.x){
+                         trailing_whitespace_pending = true;
+                         continue;
+                    }
+
+                    change_draw_color(draw_color_list, syntax_defs, color, match_point);
+                    changed = true;
+               }
+
+               if(trailing_whitespace_pending && x > view->cursor.x){
+                    change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
+                    trailing_whitespace_pending = false;
+                    changed = true;
+               }
+
+               if(in_visual && changed) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
+          }
+
+          check_visual_mode_end(range_node, &in_visual, match_point.y, line_len, draw_color_list);
+     }
+}
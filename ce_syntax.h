@@ -2,6 +2,9 @@
 
 #include "ce.h"
 
+#include <stddef.h>
+#include <stdatomic.h>
+
 #define CE_SYNTAX_USE_CURRENT_COLOR -2
 
 typedef enum{
@@ -37,6 +40,18 @@ typedef struct{
      int bg;
 }CeSyntaxDef_t;
 
+typedef struct CeArenaBlock_t{
+     struct CeArenaBlock_t* next;
+     int64_t size;
+     int64_t used;
+     max_align_t data[];
+}CeArenaBlock_t;
+
+// bump allocator, everything allocated from it is released at once by ce_arena_free()
+typedef struct{
+     CeArenaBlock_t* blocks;
+}CeArena_t;
+
 typedef struct CeDrawColorNode_t{
      int fg;
      int bg;
@@ -47,6 +62,7 @@ typedef struct CeDrawColorNode_t{
 typedef struct{
      CeDrawColorNode_t* head;
      CeDrawColorNode_t* tail;
+     CeArena_t arena; // nodes are allocated from here
 }CeDrawColorList_t;
 
 typedef struct CeRangeNode_t{
@@ -57,31 +73,114 @@ typedef struct CeRangeNode_t{
 typedef struct{
      CeRangeNode_t* head;
      CeRangeNode_t* tail;
+     CeArena_t arena; // nodes are allocated from here
+     CeRangeNode_t** nodes; // every node in list order, so sorted inserts can binary search
+     int64_t node_count;
+     int64_t node_capacity;
 }CeRangeList_t;
 
+#define CE_COLOR_PAIR_COUNT 256 // NOTE: this is what COLOR_PAIRS was for me (which is for some reason not const?)
+#define CE_COLOR_DEF_HASH_SIZE 512 // must be a power of 2 larger than CE_COLOR_PAIR_COUNT
+
 typedef struct{
      int fg;
      int bg;
+     int64_t last_used_frame;
 }CeColorPair_t;
 
+// long lived map from fg/bg to curses color pair, when we run out of pairs the least recently used one is redefined
 typedef struct{
      int32_t count;
-     int32_t current;
-     CeColorPair_t pairs[256]; // NOTE: this is what COLOR_PAIRS was for me (which is for some reason not const?)
+     int16_t hash_table[CE_COLOR_DEF_HASH_SIZE]; // index into pairs, 0 means empty, curses doesn't like 0 index color pairs
+     CeColorPair_t pairs[CE_COLOR_PAIR_COUNT];
+     int64_t frame;
+     bool frame_redraws_all;
+     bool evicted_pair_on_screen; // a redefined pair may still be drawn somewhere that wasn't repainted this frame
 }CeColorDefs_t;
 
+#define CE_KEYWORD_SET_SIZE 512 // must be a power of 2 larger than twice the number of keywords in a set
+
+// whole identifier lookup for a keyword table, built the first time it is used with a hash seed that gives every
+// keyword its own slot when we can find one, so a lookup is one hash and one compare
+typedef struct{
+     const char** words;
+     int64_t word_count;
+     uint32_t seed;
+     int16_t slots[CE_KEYWORD_SET_SIZE]; // index + 1 into words, 0 means empty
+     atomic_bool built;
+}CeKeywordSet_t;
+
+typedef struct{
+     char* start;
+     char* end; // NULL if it runs to the end of the line
+     char escape; // 0 if nothing escapes the end
+     bool multiline;
+     CeSyntaxColor_t color;
+}CeSyntaxDelimiter_t;
+
+// a syntax described by a file in ~/.ce/syntax, compiled into tables that ce_syntax_highlight_language() walks
+typedef struct{
+     char* name;
+     char** extensions; // matched against the end of the buffer name
+     int64_t extension_count;
+     CeSyntaxDelimiter_t* delimiters;
+     int64_t delimiter_count;
+     char** words;
+     CeSyntaxColor_t* word_colors;
+     int64_t word_count;
+     bool numbers;
+     bool caps_vars;
+     uint8_t byte_classes[256]; // which kinds of tokens can start with each byte
+     CeKeywordSet_t keyword_set;
+}CeSyntaxLanguage_t;
+
+typedef struct{
+     CeSyntaxLanguage_t** languages;
+     int64_t count;
+}CeSyntaxLanguageList_t;
+
 typedef void CeSyntaxHighlightFunc_t(CeView_t*, CeRangeList_t*, CeDrawColorList_t*, CeSyntaxDef_t*, void*);
 
+typedef struct{
+     int64_t x;
+     CeSyntaxColor_t color;
+}CeSyntaxSpan_t;
+
+typedef struct{
+     CeSyntaxSpan_t* spans; // where each syntax color starts on the line
+     int64_t span_count;
+     bool highlighted;
+}CeSyntaxSpanLine_t;
+
+// syntax colors for each line of a buffer, filled in by the syntax worker and only valid for buffer_version
+typedef struct{
+     int64_t buffer_version;
+     CeSyntaxHighlightFunc_t* syntax_function;
+     void* syntax_data;
+     CeSyntaxSpanLine_t* lines;
+     int64_t line_count;
+     int64_t generation; // bumped whenever lines are filled in or the lexer catches up, so views showing them redraw
+     int64_t requested_version;
+     int64_t requested_first_line;
+     int64_t requested_last_line;
+     int64_t requested_lex_last_line; // how far the last catch up request lexes
+}CeSyntaxSpanCache_t;
+
 int ce_syntax_def_get_fg(CeSyntaxDef_t* syntax_defs, CeSyntaxColor_t syntax_color, int current_fg);
 int ce_syntax_def_get_bg(CeSyntaxDef_t* syntax_defs, CeSyntaxColor_t syntax_color, int current_bg);
 
+void* ce_arena_alloc(CeArena_t* arena, int64_t size);
+void ce_arena_free(CeArena_t* arena);
+
 bool ce_draw_color_list_insert(CeDrawColorList_t* list, int fg, int bg, CePoint_t point);
 void ce_draw_color_list_free(CeDrawColorList_t* list);
 bool ce_range_list_insert(CeRangeList_t* list, CePoint_t start, CePoint_t end);
+// fails if the range overlaps one already in the list, the insert is still linear since it shifts the index
 bool ce_range_list_insert_sorted(CeRangeList_t* list, CePoint_t start, CePoint_t end);
 void ce_range_list_free(CeRangeList_t* list);
 int ce_draw_color_list_last_fg_color(CeDrawColorList_t* draw_color_list);
 int ce_draw_color_list_last_bg_color(CeDrawColorList_t* draw_color_list);
+void ce_color_defs_begin_frame(CeColorDefs_t* color_defs, bool redraw_all);
 int ce_color_def_get(CeColorDefs_t* color_defs, int fg, int bg);
 
 void ce_syntax_highlight_c(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
@@ -101,5 +200,33 @@ void ce_syntax_highlight_diff(CeView_t* view, CeRangeList_t* highlight_range_lis
 void ce_syntax_highlight_plain(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
                                CeSyntaxDef_t* syntax_defs, void* user_data);
 
+void ce_syntax_highlight_language(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                                  CeSyntaxDef_t* syntax_defs, void* user_data);
+
+// like the other highlighters, but replays syntax colors from a CeSyntaxSpanCache_t passed as user_data
+void ce_syntax_highlight_spans(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                               CeSyntaxDef_t* syntax_defs, void* user_data);
+void ce_syntax_span_cache_reset(CeSyntaxSpanCache_t* cache, int64_t buffer_version, CeSyntaxHighlightFunc_t* syntax_function,
+                                void* syntax_data, int64_t line_count);
+// catch the cache up to a buffer edited from first_line down, keeping the spans of the lines above it
+void ce_syntax_span_cache_invalidate_after(CeSyntaxSpanCache_t* cache, int64_t buffer_version, int64_t first_line,
+                                           int64_t line_count);
+void ce_syntax_span_cache_free(CeSyntaxSpanCache_t* cache);
+
+// which lexer a highlighter keeps line states with, returns false if it doesn't carry state between lines
+bool ce_syntax_get_lexer(CeSyntaxHighlightFunc_t* syntax_function, void* syntax_data, CeLexLineFunc_t** lex_line, void** lex_data);
+// adds states computed elsewhere starting at first_line, as long as they continue from a state the cache already has
+void ce_lexer_state_cache_install(CeLexerStateCache_t* cache, CeLexLineFunc_t* lex_line, void* lex_data, int64_t first_line,
+                                  const int64_t* states, int64_t state_count);
+
+bool ce_syntax_language_load_string(CeSyntaxLanguage_t* language, const char* string, const char* name);
+bool ce_syntax_language_load_file(CeSyntaxLanguage_t* language, const char* filepath);
+void ce_syntax_language_free(CeSyntaxLanguage_t* language);
+int64_t ce_syntax_languages_load_directory(const char* directory); // loads every *.syntax file into g_syntax_languages
+CeSyntaxLanguage_t* ce_syntax_language_find(const char* filename);
+void ce_syntax_languages_free();
+
 void ce_syntax_highlight_visual(CeRangeNode_t** range_node, bool* in_visual, CePoint_t point, CeDrawColorList_t* draw_color_list,
                                 CeSyntaxDef_t* syntax_defs);
+
+extern CeSyntaxLanguageList_t g_syntax_languages;
@@ -0,0 +1,484 @@
+#include "ce_syntax_worker.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define MAX_SNAPSHOT_LINES 16384 // lines a single request copies, the lexer catches up over frames when it's further behind
+
+CeSyntaxWorker_t g_syntax_worker = {};
+
+static void syntax_job_free(CeSyntaxJob_t* job){
+     for(int64_t i = 0; i < job->snapshot.line_count; i++){
+          free(job->snapshot.lines[i]);
+     }
+     free(job->snapshot.lines);
+     free(job->snapshot.lexer_state_cache.states);
+
+     if(job->lines){
+          for(int64_t i = 0; i <= job->last_line - job->first_line; i++){
+               free(job->lines[i].spans);
+          }
+          free(job->lines);
+     }
+
+     free(job->lexer_states);
+     free(job);
+}
+
+static void syntax_job_list_free(CeSyntaxJob_t* job){
+     while(job){
+          CeSyntaxJob_t* tmp = job;
+          job = job->next;
+          syntax_job_free(tmp);
+     }
+}
+
+static CeSyntaxColor_t span_color(int fg){
+     if(fg < 0 || fg >= CE_SYNTAX_COLOR_COUNT) return CE_SYNTAX_COLOR_NORMAL;
+     return fg;
+}
+
+// turn the draw colors the syntax function produced with our identity syntax defs back into spans per line
+static bool syntax_job_build_spans(CeSyntaxJob_t* job, CeDrawColorList_t* draw_color_list){
+     int64_t line_count = (job->last_line - job->first_line) + 1;
+     job->lines = calloc(line_count, sizeof(*job->lines));
+     if(!job->lines) return false;
+
+     CeDrawColorNode_t* node = draw_color_list->head;
+     CeSyntaxColor_t current_color = CE_SYNTAX_COLOR_NORMAL;
+
+     for(int64_t i = 0; i < line_count; i++){
+          int64_t y = (job->first_line - job->snapshot_first) + i;
+
+          int64_t node_count = 0;
+          for(CeDrawColorNode_t* itr = node; itr && itr->point.y <= y; itr = itr->next) node_count++;
+
+          // start each line with the color carried over from the line before, so lines can be drawn on their own
+          CeSyntaxSpanLine_t* line = job->lines + i;
+          line->spans = malloc((node_count + 1) * sizeof(*line->spans));
+          if(!line->spans) return false;
+          line->spans[0] = (CeSyntaxSpan_t){0, current_color};
+          line->span_count = 1;
+
+          for(; node && node->point.y <= y; node = node->next){
+               CeSyntaxColor_t color = span_color(node->fg);
+               int64_t x = (node->point.y < y) ? 0 : node->point.x;
+               CeSyntaxSpan_t* last = line->spans + (line->span_count - 1);
+
+               // keep what trailing whitespace replaced, the cursor may be sitting on it when the line is drawn
+               if(last->x == x && color != CE_SYNTAX_COLOR_TRAILING_WHITESPACE){
+                    last->color = color;
+               }else if(last->color != color){
+                    line->spans[line->span_count] = (CeSyntaxSpan_t){x, color};
+                    line->span_count++;
+               }
+               current_color = color;
+          }
+
+          line->highlighted = true;
+     }
+
+     return true;
+}
+
+static void syntax_job_run(CeSyntaxJob_t* job){
+     CeView_t view = {};
+     view.buffer = &job->snapshot;
+     view.scroll.y = job->first_line - job->snapshot_first;
+     view.rect.bottom = job->last_line - job->first_line;
+     view.cursor = (CePoint_t){-1, -1};
+
+     CeRangeList_t range_list = {};
+     CeDrawColorList_t draw_color_list = {};
+     job->syntax_function(&view, &range_list, &draw_color_list, g_syntax_worker.span_defs, job->syntax_data);
+
+     // ce_log() isn't safe off the main thread, lines we couldn't build are left plain
+     syntax_job_build_spans(job, &draw_color_list);
+
+     ce_draw_color_list_free(&draw_color_list);
+
+     // hand back the line states we lexed on the way, so the next job can start from them
+     CeLexerStateCache_t* lexer_state_cache = &job->snapshot.lexer_state_cache;
+     if(job->lex_line && lexer_state_cache->lex_line == job->lex_line && lexer_state_cache->lex_data == job->lex_data){
+          job->lexer_states = lexer_state_cache->states;
+          job->lexer_state_count = lexer_state_cache->valid_count;
+          memset(lexer_state_cache, 0, sizeof(*lexer_state_cache));
+     }
+}
+
+static void syntax_job_lex(CeSyntaxJob_t* job){
+     CeLexerStateCache_t* lexer_state_cache = &job->snapshot.lexer_state_cache;
+     if(!lexer_state_cache->states) return;
+
+     // one state for the start of each snapshot line, plus the line after it
+     int64_t state_count = job->snapshot.line_count + 1;
+     int64_t* states = realloc(lexer_state_cache->states, state_count * sizeof(*states));
+     if(!states) return;
+
+     for(int64_t i = 1; i < state_count; i++){
+          states[i] = job->lex_line(job->snapshot.lines[i - 1], states[i - 1], job->lex_data);
+     }
+
+     job->lexer_states = states;
+     job->lexer_state_count = state_count;
+     memset(lexer_state_cache, 0, sizeof(*lexer_state_cache));
+}
+
+static void* syntax_worker_thread(void* data){
+     (void)(data);
+
+     pthread_mutex_lock(&g_syntax_worker.mutex);
+     while(!g_syntax_worker.should_die){
+          CeSyntaxJob_t* job = g_syntax_worker.jobs;
+          if(!job){
+               pthread_cond_wait(&g_syntax_worker.job_ready, &g_syntax_worker.mutex);
+               continue;
+          }
+
+          g_syntax_worker.jobs = job->next;
+          job->next = NULL;
+          g_syntax_worker.current_job = job;
+          g_syntax_worker.current_job_canceled = false;
+          pthread_mutex_unlock(&g_syntax_worker.mutex);
+
+          if(job->lex_only){
+               syntax_job_lex(job);
+          }else{
+               syntax_job_run(job);
+          }
+
+          pthread_mutex_lock(&g_syntax_worker.mutex);
+          g_syntax_worker.current_job = NULL;
+          if(g_syntax_worker.current_job_canceled || g_syntax_worker.should_die){
+               syntax_job_free(job);
+               continue;
+          }
+
+          job->next = g_syntax_worker.results;
+          g_syntax_worker.results = job;
+          pthread_cond_signal(&g_syntax_worker.result_ready);
+
+          pthread_mutex_unlock(&g_syntax_worker.mutex);
+          if(g_syntax_worker.wake) g_syntax_worker.wake();
+          pthread_mutex_lock(&g_syntax_worker.mutex);
+     }
+     pthread_mutex_unlock(&g_syntax_worker.mutex);
+
+     return NULL;
+}
+
+bool ce_syntax_worker_init(CeSyntaxWorkerWakeFunc_t* wake){
+     memset(&g_syntax_worker, 0, sizeof(g_syntax_worker));
+     g_syntax_worker.wake = wake;
+
+     g_syntax_worker.span_defs[CE_SYNTAX_COLOR_NORMAL] = (CeSyntaxDef_t){COLOR_DEFAULT, COLOR_DEFAULT};
+     for(int i = CE_SYNTAX_COLOR_NORMAL + 1; i < CE_SYNTAX_COLOR_COUNT; i++){
+          g_syntax_worker.span_defs[i] = (CeSyntaxDef_t){i, i};
+     }
+
+     pthread_mutex_init(&g_syntax_worker.mutex, NULL);
+     pthread_cond_init(&g_syntax_worker.job_ready, NULL);
+     pthread_cond_init(&g_syntax_worker.result_ready, NULL);
+
+     int rc = pthread_create(&g_syntax_worker.thread, NULL, syntax_worker_thread, NULL);
+     if(rc != 0){
+          ce_log("%s() pthread_create() failed: '%s'\n", __FUNCTION__, strerror(rc));
+          pthread_cond_destroy(&g_syntax_worker.result_ready);
+          pthread_cond_destroy(&g_syntax_worker.job_ready);
+          pthread_mutex_destroy(&g_syntax_worker.mutex);
+          return false;
+     }
+
+     g_syntax_worker.running = true;
+     return true;
+}
+
+void ce_syntax_worker_free(){
+     if(!g_syntax_worker.running) return;
+
+     pthread_mutex_lock(&g_syntax_worker.mutex);
+     g_syntax_worker.should_die = true;
+     pthread_cond_signal(&g_syntax_worker.job_ready);
+     pthread_mutex_unlock(&g_syntax_worker.mutex);
+     pthread_join(g_syntax_worker.thread, NULL);
+
+     syntax_job_list_free(g_syntax_worker.jobs);
+     syntax_job_list_free(g_syntax_worker.results);
+     pthread_cond_destroy(&g_syntax_worker.result_ready);
+     pthread_cond_destroy(&g_syntax_worker.job_ready);
+     pthread_mutex_destroy(&g_syntax_worker.mutex);
+     memset(&g_syntax_worker, 0, sizeof(g_syntax_worker));
+}
+
+bool ce_syntax_worker_can_highlight(CeSyntaxHighlightFunc_t* syntax_function){
+     if(!g_syntax_worker.running) return false;
+
+     return syntax_function == ce_syntax_highlight_c ||
+            syntax_function == ce_syntax_highlight_cpp ||
+            syntax_function == ce_syntax_highlight_java ||
+            syntax_function == ce_syntax_highlight_python ||
+            syntax_function == ce_syntax_highlight_bash ||
+            syntax_function == ce_syntax_highlight_config ||
+            syntax_function == ce_syntax_highlight_diff ||
+            syntax_function == ce_syntax_highlight_language;
+}
+
+static bool install_jobs(CeSyntaxJob_t* job){
+     bool changed = false;
+
+     while(job){
+          CeSyntaxSpanCache_t* cache = job->cache;
+
+          if(job->lexer_states && job->buffer->version == job->buffer_version){
+               ce_lexer_state_cache_install(&job->buffer->lexer_state_cache, job->lex_line, job->lex_data, job->snapshot_first,
+                                            job->lexer_states, job->lexer_state_count);
+
+               // redraw so the view asks for its lines again, now starting closer to them
+               if(job->lex_only){
+                    cache->generation++;
+                    changed = true;
+               }
+          }
+
+          // the buffer may have changed while the worker was busy, those results are thrown away
+          if(job->lines && cache->buffer_version == job->buffer_version && cache->syntax_function == job->syntax_function &&
+             cache->syntax_data == job->syntax_data){
+               for(int64_t y = job->first_line; y <= job->last_line && y < cache->line_count; y++){
+                    CeSyntaxSpanLine_t* line = job->lines + (y - job->first_line);
+                    free(cache->lines[y].spans);
+                    cache->lines[y] = *line;
+                    memset(line, 0, sizeof(*line));
+               }
+
+               cache->generation++;
+               changed = true;
+          }
+
+          CeSyntaxJob_t* tmp = job;
+          job = job->next;
+          syntax_job_free(tmp);
+     }
+
+     return changed;
+}
+
+bool ce_syntax_worker_install_results(){
+     if(!g_syntax_worker.running) return false;
+
+     pthread_mutex_lock(&g_syntax_worker.mutex);
+     CeSyntaxJob_t* results = g_syntax_worker.results;
+     g_syntax_worker.results = NULL;
+     pthread_mutex_unlock(&g_syntax_worker.mutex);
+
+     return install_jobs(results);
+}
+
+static bool lines_highlighted(CeSyntaxSpanCache_t* cache, int64_t first_line, int64_t last_line){
+     for(int64_t y = first_line; y <= last_line; y++){
+          if(!cache->lines[y].highlighted) return false;
+     }
+     return true;
+}
+
+// returns whether the job asked for will highlight the lines, or only get the lexer closer to them
+static bool request_lines(CeSyntaxSpanCache_t* cache, CeBuffer_t* buffer, CeSyntaxHighlightFunc_t* syntax_function,
+                          void* syntax_data, int64_t first_line, int64_t last_line){
+     if(cache->requested_version == buffer->version && cache->requested_first_line <= first_line &&
+        cache->requested_last_line >= last_line){
+          return true;
+     }
+
+     // start the snapshot at the last line we know the lexer state for, so the worker can lex its way to the first line
+     CeLexLineFunc_t* lex_line = NULL;
+     void* lex_data = NULL;
+     int64_t snapshot_first = first_line;
+     int64_t start_state = 0;
+     if(ce_syntax_get_lexer(syntax_function, syntax_data, &lex_line, &lex_data)){
+          CeLexerStateCache_t* lexer_state_cache = &buffer->lexer_state_cache;
+          int64_t valid_count = 0;
+          if(lexer_state_cache->lex_line == lex_line && lexer_state_cache->lex_data == lex_data){
+               valid_count = lexer_state_cache->valid_count;
+               if(valid_count > buffer->line_count) valid_count = buffer->line_count;
+          }
+
+          if(valid_count <= 0){
+               snapshot_first = 0;
+          }else if(valid_count - 1 < first_line){
+               snapshot_first = valid_count - 1;
+          }
+
+          if(valid_count > 0) start_state = lexer_state_cache->states[snapshot_first];
+     }
+
+     // too far from a known state to copy everything in one frame, have the worker lex the next chunk and ask again
+     // once its states are installed
+     int64_t snapshot_last = last_line;
+     bool lex_only = false;
+     if((last_line - snapshot_first) + 1 > MAX_SNAPSHOT_LINES){
+          snapshot_last = snapshot_first + MAX_SNAPSHOT_LINES - 1;
+          lex_only = true;
+          if(cache->requested_version == buffer->version && cache->requested_lex_last_line >= snapshot_last) return false;
+     }
+
+     CeSyntaxJob_t* job = calloc(1, sizeof(*job));
+     if(!job) return false;
+     job->cache = cache;
+     job->buffer = buffer;
+     job->buffer_version = buffer->version;
+     job->syntax_function = syntax_function;
+     job->syntax_data = syntax_data;
+     job->first_line = first_line;
+     job->last_line = last_line;
+     job->snapshot_first = snapshot_first;
+     job->lex_line = lex_line;
+     job->lex_data = lex_data;
+     job->lex_only = lex_only;
+
+     int64_t snapshot_line_count = (snapshot_last - job->snapshot_first) + 1;
+     job->snapshot.lines = malloc(snapshot_line_count * sizeof(*job->snapshot.lines));
+     if(!job->snapshot.lines){
+          syntax_job_free(job);
+          return false;
+     }
+
+     for(int64_t i = 0; i < snapshot_line_count; i++){
+          job->snapshot.lines[i] = strdup(buffer->lines[job->snapshot_first + i]);
+          if(!job->snapshot.lines[i]){
+               syntax_job_free(job);
+               return false;
+          }
+          job->snapshot.line_count++;
+     }
+
+     if(job->lex_line){
+          CeLexerStateCache_t* lexer_state_cache = &job->snapshot.lexer_state_cache;
+          lexer_state_cache->states = malloc(sizeof(*lexer_state_cache->states));
+          if(lexer_state_cache->states){
+               lexer_state_cache->states[0] = start_state;
+               lexer_state_cache->valid_count = 1;
+               lexer_state_cache->capacity = 1;
+               lexer_state_cache->lex_line = job->lex_line;
+               lexer_state_cache->lex_data = job->lex_data;
+          }
+     }
+
+     pthread_mutex_lock(&g_syntax_worker.mutex);
+
+     // a newer request for the same buffer replaces any the worker hasn't started on
+     CeSyntaxJob_t** itr = &g_syntax_worker.jobs;
+     while(*itr){
+          if((*itr)->cache == cache){
+               CeSyntaxJob_t* tmp = *itr;
+               *itr = tmp->next;
+               syntax_job_free(tmp);
+          }else{
+               itr = &(*itr)->next;
+          }
+     }
+     *itr = job;
+
+     pthread_cond_signal(&g_syntax_worker.job_ready);
+     pthread_mutex_unlock(&g_syntax_worker.mutex);
+
+     cache->requested_version = buffer->version;
+     if(lex_only){
+          cache->requested_first_line = -1;
+          cache->requested_last_line = -1;
+          cache->requested_lex_last_line = snapshot_last;
+     }else{
+          cache->requested_first_line = first_line;
+          cache->requested_last_line = last_line;
+          cache->requested_lex_last_line = -1;
+     }
+     return !lex_only;
+}
+
+void ce_syntax_worker_begin_frame(int64_t wait_usec){
+     struct timespec* deadline = &g_syntax_worker.frame_deadline;
+     clock_gettime(CLOCK_REALTIME, deadline);
+     deadline->tv_nsec += wait_usec * 1000;
+     deadline->tv_sec += deadline->tv_nsec / 1000000000;
+     deadline->tv_nsec %= 1000000000;
+}
+
+void ce_syntax_worker_prepare(CeSyntaxSpanCache_t* cache, CeView_t* view, CeSyntaxHighlightFunc_t* syntax_function,
+                              void* syntax_data){
+     if(!g_syntax_worker.running) return;
+     CeBuffer_t* buffer = view->buffer;
+
+     if(cache->syntax_function != syntax_function || cache->syntax_data != syntax_data){
+          ce_syntax_span_cache_reset(cache, buffer->version, syntax_function, syntax_data, buffer->line_count);
+     }else if(cache->buffer_version != buffer->version || cache->line_count != buffer->line_count){
+          ce_syntax_span_cache_invalidate_after(cache, buffer->version, buffer->unchanged_line_count, buffer->line_count);
+     }
+     buffer->unchanged_line_count = buffer->line_count;
+
+     if(cache->line_count <= 0) return;
+
+     int64_t view_height = view->rect.bottom - view->rect.top;
+     int64_t clamp_max = cache->line_count - 1;
+     int64_t first_line = view->scroll.y;
+     int64_t last_line = first_line + view_height;
+     CE_CLAMP(first_line, 0, clamp_max);
+     CE_CLAMP(last_line, 0, clamp_max);
+
+     if(lines_highlighted(cache, first_line, last_line)){
+          // get a screen ahead in both directions so scrolling finds its lines ready
+          int64_t prefetch_first = first_line - view_height;
+          int64_t prefetch_last = last_line + view_height;
+          CE_CLAMP(prefetch_first, 0, clamp_max);
+          CE_CLAMP(prefetch_last, 0, clamp_max);
+          if(!lines_highlighted(cache, prefetch_first, prefetch_last)){
+               request_lines(cache, buffer, syntax_function, syntax_data, prefetch_first, prefetch_last);
+          }
+          return;
+     }
+
+     if(!request_lines(cache, buffer, syntax_function, syntax_data, first_line, last_line)) return;
+
+     // give the worker what's left of the frame so small edits don't flash plain text, after that the lines show up
+     // when it wakes us
+     while(true){
+          int rc = 0;
+          pthread_mutex_lock(&g_syntax_worker.mutex);
+          if(!g_syntax_worker.results){
+               rc = pthread_cond_timedwait(&g_syntax_worker.result_ready, &g_syntax_worker.mutex,
+                                           &g_syntax_worker.frame_deadline);
+          }
+          CeSyntaxJob_t* results = g_syntax_worker.results;
+          g_syntax_worker.results = NULL;
+          pthread_mutex_unlock(&g_syntax_worker.mutex);
+
+          install_jobs(results);
+          if(lines_highlighted(cache, first_line, last_line)) break;
+          if(rc == ETIMEDOUT) break;
+     }
+}
+
+void ce_syntax_worker_forget(CeSyntaxSpanCache_t* cache){
+     if(!g_syntax_worker.running) return;
+
+     pthread_mutex_lock(&g_syntax_worker.mutex);
+
+     CeSyntaxJob_t** lists[] = {&g_syntax_worker.jobs, &g_syntax_worker.results};
+     for(size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); i++){
+          CeSyntaxJob_t** itr = lists[i];
+          while(*itr){
+               if((*itr)->cache == cache){
+                    CeSyntaxJob_t* tmp = *itr;
+                    *itr = tmp->next;
+                    syntax_job_free(tmp);
+               }else{
+                    itr = &(*itr)->next;
+               }
+          }
+     }
+
+     if(g_syntax_worker.current_job && g_syntax_worker.current_job->cache == cache){
+          g_syntax_worker.current_job_canceled = true;
+     }
+
+     pthread_mutex_unlock(&g_syntax_worker.mutex);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ce.h"
+#include "ce_syntax.h"
+
+#include <pthread.h>
+#include <time.h>
+
+// called from the worker thread when it has results for the main thread to install
+typedef bool CeSyntaxWorkerWakeFunc_t();
+
+// highlight a range of lines from a copy of the buffer, so the worker never touches the live one. lex only jobs just
+// carry the lexer states forward through their snapshot
+typedef struct CeSyntaxJob_t{
+     CeSyntaxSpanCache_t* cache;
+     CeBuffer_t* buffer;
+     int64_t buffer_version;
+     CeSyntaxHighlightFunc_t* syntax_function;
+     void* syntax_data;
+     CeBuffer_t snapshot; // lines snapshot_first through last_line
+     int64_t snapshot_first;
+     int64_t first_line;
+     int64_t last_line;
+     CeSyntaxSpanLine_t* lines; // results for first_line through last_line
+     int64_t* lexer_states; // results starting at snapshot_first
+     int64_t lexer_state_count;
+     CeLexLineFunc_t* lex_line;
+     void* lex_data;
+     bool lex_only;
+     struct CeSyntaxJob_t* next;
+}CeSyntaxJob_t;
+
+typedef struct{
+     pthread_t thread;
+     pthread_mutex_t mutex;
+     pthread_cond_t job_ready;
+     pthread_cond_t result_ready;
+     bool running;
+     bool should_die;
+     CeSyntaxJob_t* jobs;
+     CeSyntaxJob_t* current_job;
+     bool current_job_canceled;
+     CeSyntaxJob_t* results;
+     CeSyntaxWorkerWakeFunc_t* wake;
+     struct timespec frame_deadline; // views drawn in the same frame share one wait
+     CeSyntaxDef_t span_defs[CE_SYNTAX_COLOR_COUNT]; // maps each syntax color to itself, so draw colors turn back into spans
+}CeSyntaxWorker_t;
+
+bool ce_syntax_worker_init(CeSyntaxWorkerWakeFunc_t* wake);
+void ce_syntax_worker_free();
+
+// whether the syntax function only looks at the buffer lines, so it can run on a snapshot
+bool ce_syntax_worker_can_highlight(CeSyntaxHighlightFunc_t* syntax_function);
+
+// start a frame, ce_syntax_worker_prepare() waits on the worker until wait_usec from now at most
+void ce_syntax_worker_begin_frame(int64_t wait_usec);
+
+// make sure the cache matches the view's buffer and ask for the lines in view, waiting for them until the frame's deadline
+void ce_syntax_worker_prepare(CeSyntaxSpanCache_t* cache, CeView_t* view, CeSyntaxHighlightFunc_t* syntax_function,
+                              void* syntax_data);
+
+// copy finished jobs into their caches, returns whether anything changed
+bool ce_syntax_worker_install_results();
+
+// drop any work for a cache that is about to be freed
+void ce_syntax_worker_forget(CeSyntaxSpanCache_t* cache);
+
+extern CeSyntaxWorker_t g_syntax_worker;
@@ -29,9 +29,52 @@ void ce_vim_add_key_bind(CeVimKeyBind_t* key_binds, int64_t* key_bind_count, CeR
      (*key_bind_count)++;
 }
 
+static int16_t* key_bind_head(CeVim_t* vim, CeRune_t key){
+     if(key >= 0 && key < CE_VIM_KEY_BIND_TABLE_SIZE) return vim->key_bind_table + key;
+     return vim->key_bind_hash + ((uint32_t)(key) % CE_VIM_KEY_BIND_HASH_SIZE);
+}
+
+static void update_key_bind_table(CeVim_t* vim){
+     if(vim->key_bind_indexed_count == vim->key_bind_count) return;
+
+     memset(vim->key_bind_table, 0, sizeof(vim->key_bind_table));
+     memset(vim->key_bind_hash, 0, sizeof(vim->key_bind_hash));
+
+     // push the binds on backwards so each chain ends up in the order they were added
+     for(int64_t i = vim->key_bind_count - 1; i >= 0; i--){
+          int16_t* head = key_bind_head(vim, vim->key_binds[i].key);
+          vim->key_bind_next[i] = *head;
+          *head = i + 1;
+     }
+
+     vim->key_bind_indexed_count = vim->key_bind_count;
+}
+
+// the next bind for key after the bind at index after, pass -1 for the first. hashed chains can hold other keys, and
+// if the binds were added since the table was built, fall back to looking at all of them
+static int64_t next_key_bind(const CeVim_t* vim, int64_t after, CeRune_t key){
+     if(vim->key_bind_indexed_count != vim->key_bind_count){
+          for(int64_t i = after + 1; i < vim->key_bind_count; i++){
+               if(vim->key_binds[i].key == key) return i;
+          }
+          return -1;
+     }
+
+     int64_t i = 0;
+     if(after < 0){
+          i = (key >= 0 && key < CE_VIM_KEY_BIND_TABLE_SIZE) ? vim->key_bind_table[key] :
+              vim->key_bind_hash[(uint32_t)(key) % CE_VIM_KEY_BIND_HASH_SIZE];
+     }else{
+          i = vim->key_bind_next[after];
+     }
+
+     while(i > 0 && vim->key_binds[i - 1].key != key) i = vim->key_bind_next[i - 1];
+     return i - 1;
+}
+
 static void insert_mode(CeVim_t* vim){
      vim->mode = CE_VIM_MODE_INSERT;
-     if(!vim->verb_last_action) ce_rune_node_free(&vim->insert_rune_head);
+     if(!vim->verb_last_action) ce_rune_array_clear(&vim->insert_runes);
 }
 
 bool vim_mode_is_visual(CeVimMode_t vim_mode){
@@ -120,10 +163,12 @@ bool ce_vim_init(CeVim_t* vim){
      ce_vim_add_key_bind(vim->key_binds, &vim->key_bind_count, '>', &ce_vim_parse_verb_indent);
      ce_vim_add_key_bind(vim->key_binds, &vim->key_bind_count, '<', &ce_vim_parse_verb_unindent);
      ce_vim_add_key_bind(vim->key_binds, &vim->key_bind_count, 'J', &ce_vim_parse_verb_join);
+     ce_vim_add_key_bind(vim->key_binds, &vim->key_bind_count, '!', &ce_vim_parse_verb_filter);
      ce_vim_add_key_bind(vim->key_binds, &vim->key_bind_count, '~', &ce_vim_parse_verb_flip_case);
      ce_vim_add_key_bind(vim->key_binds, &vim->key_bind_count, 'm', &ce_vim_parse_verb_set_mark);
      ce_vim_add_key_bind(vim->key_binds, &vim->key_bind_count, ce_ctrl_key('a'), &ce_vim_parse_verb_increment_number);
      ce_vim_add_key_bind(vim->key_binds, &vim->key_bind_count, ce_ctrl_key('x'), &ce_vim_parse_verb_decrement_number);
+     update_key_bind_table(vim);
 
      return true;
 }
@@ -132,8 +177,8 @@ bool ce_vim_free(CeVim_t* vim){
      for(int64_t i = 0; i < CE_ASCII_PRINTABLE_CHARACTERS; i++){
           ce_vim_yank_free(vim->yanks + i);
      }
-     ce_rune_node_free(&vim->insert_rune_head);
-     ce_rune_node_free(&vim->last_insert_rune_head);
+     ce_rune_array_free(&vim->insert_runes);
+     ce_rune_array_free(&vim->last_insert_runes);
      return true;
 }
 
@@ -150,6 +195,7 @@ bool ce_vim_bind_key(CeVim_t* vim, CeRune_t key, CeVimParseFunc_t function){
      vim->key_binds[vim->key_bind_count].key = key;
      vim->key_binds[vim->key_bind_count].function = function;
      vim->key_bind_count++;
+     update_key_bind_table(vim);
      return true;
 }
 
@@ -164,6 +210,48 @@ bool ce_vim_append_key(CeVim_t* vim, CeRune_t key){
      return false;
 }
 
+// when the insert was only plain characters, put the same text on each of the block's lines other than the cursor's
+// in a single change, otherwise return false so the keys are replayed on each line
+static bool insert_block_text(CeView_t* view, const CeRune_t* runes, int64_t rune_count, CePoint_t top_left,
+                              CePoint_t bottom_right, CePoint_t cursor_end){
+     if(rune_count == 0) return true;
+     for(int64_t r = 0; r < rune_count; r++){
+          if(runes[r] < ' ' || runes[r] > '~' || runes[r] == '}') return false;
+     }
+
+     int64_t line_count = (bottom_right.y - top_left.y) + 1;
+     char** new_lines = malloc(line_count * sizeof(*new_lines));
+     if(!new_lines) return false;
+
+     size_t insert_len = rune_count;
+     for(int64_t i = 0; i < line_count; i++){
+          char* line = view->buffer->lines[top_left.y + i];
+          size_t line_len = strlen(line);
+          char* split = ce_utf8_iterate_to(line, top_left.x);
+          if(!split || top_left.y + i == cursor_end.y){
+               // the line is too short to reach the block, or already has the text
+               new_lines[i] = strdup(line);
+               continue;
+          }
+
+          size_t prefix_len = split - line;
+          char* new_line = malloc(line_len + insert_len + 1);
+          memcpy(new_line, line, prefix_len);
+          for(size_t r = 0; r < insert_len; r++) new_line[prefix_len + r] = (char)(runes[r]);
+          memcpy(new_line + prefix_len + insert_len, split, (line_len - prefix_len) + 1);
+          new_lines[i] = new_line;
+     }
+
+     CePoint_t cursor_before = cursor_end;
+     bool success = ce_buffer_replace_lines_change(view->buffer, top_left.y, line_count, new_lines, line_count,
+                                                   &cursor_before, cursor_end, true);
+     if(!success){
+          for(int64_t i = 0; i < line_count; i++) free(new_lines[i]);
+     }
+     free(new_lines);
+     return success;
+}
+
 CeVimParseResult_t insert_mode_handle_key(CeVim_t* vim, CeView_t* view, CePoint_t* cursor, CeVimVisualData_t* visual,
                                           CeRune_t key, const CeConfigOptions_t* config_options, bool track){
      switch(key){
@@ -335,16 +423,18 @@ CeVimParseResult_t insert_mode_handle_key(CeVim_t* vim, CeView_t* view, CePoint_
      case 27: // escape
      {
           if(track){
-               if(!vim->insert_rune_head &&
+               if(!vim->insert_runes.count &&
                   (vim->current_action.verb.function == ce_vim_verb_insert_mode ||
                    vim->current_action.verb.function == ce_vim_verb_append ||
                    vim->current_action.verb.function == ce_vim_verb_append_at_end_of_line)){
                     // pass
                }else if(!vim->verb_last_action){
                     vim->last_action = vim->current_action;
-                    if(vim->last_insert_rune_head) free(vim->last_insert_rune_head);
-                    vim->last_insert_rune_head = vim->insert_rune_head;
-                    vim->insert_rune_head = NULL;
+                    // swap so the insert we just finished becomes the one to repeat, and its allocation is reused
+                    CeRuneArray_t last_insert_runes = vim->last_insert_runes;
+                    vim->last_insert_runes = vim->insert_runes;
+                    vim->insert_runes = last_insert_runes;
+                    ce_rune_array_clear(&vim->insert_runes);
                }
 
                // check if previous line was all whitespace, if so, remove it
@@ -358,32 +448,31 @@ CeVimParseResult_t insert_mode_handle_key(CeVim_t* vim, CeView_t* view, CePoint_
                     CePoint_t visual_top_left = visual->block_top_left;
                     CePoint_t visual_bottom_right = visual->block_bottom_right;
 
-                    // adjust range because we've already inserted text the line the cursor is on
+                    // the text has already been inserted on the line the cursor is on, so that one is skipped
                     CePoint_t cursor_end = *cursor;
-                    if(visual_top_left.y == cursor->y){
-                         visual_top_left.y++;
-                    }else{
-                         visual_bottom_right.y--;
-                    }
 
                     visual->block_top_left = (CePoint_t){0, 0};
                     visual->block_bottom_right = (CePoint_t){0, 0};
 
-                    CeRune_t* rune_string = ce_rune_node_string(vim->last_insert_rune_head);
-
                     if(view->buffer->change_node) view->buffer->change_node->change.chain = true;
                     vim->chain_undo = true;
 
-                    for(int64_t i = visual_top_left.y; i <= visual_bottom_right.y; i++){
-                         *cursor = (CePoint_t){visual_top_left.x, i};
-                         CeRune_t* itr = rune_string;
-                         while(*itr){
-                              insert_mode_handle_key(vim, view, cursor, visual, *itr, config_options, track);
-                              itr++;
+                    // the recorded insert ends with this escape, which must not be replayed
+                    int64_t replay_count = vim->last_insert_runes.count;
+                    if(replay_count > 0 && vim->last_insert_runes.runes[replay_count - 1] == 27) replay_count--;
+
+                    if(!insert_block_text(view, vim->last_insert_runes.runes, replay_count, visual_top_left,
+                                          visual_bottom_right, cursor_end)){
+                         for(int64_t i = visual_top_left.y; i <= visual_bottom_right.y; i++){
+                              if(i == cursor_end.y) continue;
+                              *cursor = (CePoint_t){visual_top_left.x, i};
+                              for(int64_t r = 0; r < replay_count; r++){
+                                   insert_mode_handle_key(vim, view, cursor, visual, vim->last_insert_runes.runes[r], config_options,
+                                                          track);
+                              }
                          }
                     }
 
-                    free(rune_string);
                     *cursor = cursor_end;
 
                     if(view->buffer->change_node) view->buffer->change_node->change.cursor_after = *cursor;
@@ -420,7 +509,7 @@ CeVimParseResult_t ce_vim_handle_key(CeVim_t* vim, CeView_t* view, CePoint_t* cu
      default:
           return CE_VIM_PARSE_INVALID;
      case CE_VIM_MODE_INSERT:
-          if(!vim->verb_last_action && track) ce_rune_node_insert(&vim->insert_rune_head, key);
+          if(!vim->verb_last_action && track) ce_rune_array_append(&vim->insert_runes, key);
           return insert_mode_handle_key(vim, view, cursor, visual, key, config_options, track);
      case CE_VIM_MODE_REPLACE:
           if(key != CE_NEWLINE && key != 27){ // escape
@@ -432,7 +521,7 @@ CeVimParseResult_t ce_vim_handle_key(CeVim_t* vim, CeView_t* view, CePoint_t* cu
               }
           }
 
-          if(!vim->verb_last_action && track) ce_rune_node_insert(&vim->insert_rune_head, key);
+          if(!vim->verb_last_action && track) ce_rune_array_append(&vim->insert_runes, key);
           return insert_mode_handle_key(vim, view, cursor, visual, key, config_options, track);
      case CE_VIM_MODE_NORMAL:
      case CE_VIM_MODE_VISUAL:
@@ -446,6 +535,8 @@ CeVimParseResult_t ce_vim_handle_key(CeVim_t* vim, CeView_t* view, CePoint_t* cu
                break;
           }
 
+          // configs can add binds straight to the array, so catch up before parsing
+          update_key_bind_table(vim);
           CeVimParseResult_t result = ce_vim_parse_action(&action, vim);
 
           if(result == CE_VIM_PARSE_COMPLETE){
@@ -455,11 +546,8 @@ CeVimParseResult_t ce_vim_handle_key(CeVim_t* vim, CeView_t* view, CePoint_t* cu
 
                     if(!vim->verb_last_action && action.repeatable){
                          vim->last_action = action;
-                         if(vim->last_insert_rune_head){
-                              free(vim->last_insert_rune_head);
-                              vim->last_insert_rune_head = NULL;
-                         }
-                         vim->insert_rune_head = NULL;
+                         ce_rune_array_clear(&vim->last_insert_runes);
+                         ce_rune_array_clear(&vim->insert_runes);
                     }
                }
           }else if(track && (result == CE_VIM_PARSE_INVALID || result == CE_VIM_PARSE_KEY_NOT_HANDLED)){
@@ -501,25 +589,23 @@ CeVimParseResult_t ce_vim_parse_action(CeVimAction_t* action, const CeVim_t* vim
 
      // parse verb
 VIM_PARSE_CONTINUE:
-     for(int64_t i = 0; i < vim->key_bind_count; ++i){
+     for(int64_t i = next_key_bind(vim, -1, *keys); i >= 0; i = next_key_bind(vim, i, *keys)){
           const CeVimKeyBind_t* key_bind = vim->key_binds + i;
-          if(*keys == key_bind->key){
-               result = key_bind->function(&build_action, vim, *keys);
-               if(result != CE_VIM_PARSE_KEY_NOT_HANDLED){
+          result = key_bind->function(&build_action, vim, *keys);
+          if(result != CE_VIM_PARSE_KEY_NOT_HANDLED){
+               keys++;
+
+               int64_t loops = 0;
+               while(result == CE_VIM_PARSE_CONSUME_ADDITIONAL_KEY){
+                    if(*keys == 0) return result;
+                    result = key_bind->function(&build_action, vim, *keys);
                     keys++;
-
-                    int64_t loops = 0;
-                    while(result == CE_VIM_PARSE_CONSUME_ADDITIONAL_KEY){
-                         if(*keys == 0) return result;
-                         result = key_bind->function(&build_action, vim, *keys);
-                         keys++;
-                         if(result == CE_VIM_PARSE_CONTINUE) goto VIM_PARSE_CONTINUE;
-                         loops++;
-                         if(loops >= 10) return CE_VIM_PARSE_INVALID;
-                    }
-
-                    break;
+                    if(result == CE_VIM_PARSE_CONTINUE) goto VIM_PARSE_CONTINUE;
+                    loops++;
+                    if(loops >= 10) return CE_VIM_PARSE_INVALID;
                }
+
+               break;
           }
      }
 
@@ -536,25 +622,23 @@ VIM_PARSE_CONTINUE:
                }
 
                // parse motion
-               for(int64_t i = 0; i < vim->key_bind_count; ++i){
+               for(int64_t i = next_key_bind(vim, -1, *keys); i >= 0; i = next_key_bind(vim, i, *keys)){
                     const CeVimKeyBind_t* key_bind = vim->key_binds + i;
-                    if(*keys == key_bind->key){
-                         result = key_bind->function(&build_action, vim, *keys);
-                         if(result != CE_VIM_PARSE_KEY_NOT_HANDLED){
-                              keys++;
-
-                              int64_t loops = 0;
-                              while(result == CE_VIM_PARSE_CONSUME_ADDITIONAL_KEY){
-                                   if(*keys == 0) return result;
-                                   result = key_bind->function(&build_action, vim, *keys);
-                                   keys++;
-                                   if(result == CE_VIM_PARSE_CONTINUE) goto VIM_PARSE_CONTINUE;
-                                   loops++;
-                                   if(loops >= 10) return CE_VIM_PARSE_INVALID;
-                              }
+                    result = key_bind->function(&build_action, vim, *keys);
+                    if(result != CE_VIM_PARSE_KEY_NOT_HANDLED){
+                         keys++;
 
-                              break;
+                         int64_t loops = 0;
+                         while(result == CE_VIM_PARSE_CONSUME_ADDITIONAL_KEY){
+                              if(*keys == 0) return result;
+                              result = key_bind->function(&build_action, vim, *keys);
+                              keys++;
+                              if(result == CE_VIM_PARSE_CONTINUE) goto VIM_PARSE_CONTINUE;
+                              loops++;
+                              if(loops >= 10) return CE_VIM_PARSE_INVALID;
                          }
+
+                         break;
                     }
                }
           }
@@ -566,6 +650,95 @@ VIM_PARSE_CONTINUE:
      return result;
 }
 
+// yank, delete or change a visual block in one pass over its lines, so the edit is a single undo step no matter
+// how many lines it covers
+static bool apply_block_action(CeVim_t* vim, const CeVimAction_t* action, CeView_t* view, CePoint_t* cursor,
+                               CeVimVisualData_t* visual){
+     bool remove = (action->verb.function != ce_vim_verb_yank);
+     CeVimYank_t* yank = vim->yanks + ce_vim_register_index(remove ? '"' : action->verb.integer);
+     ce_vim_yank_free(yank);
+     yank->type = CE_VIM_YANK_TYPE_BLOCK;
+     yank->block_line_count = (visual->block_bottom_right.y - visual->block_top_left.y) + 1;
+     yank->block = malloc(yank->block_line_count * sizeof(*yank->block));
+
+     char** new_lines = NULL;
+     if(remove) new_lines = malloc(yank->block_line_count * sizeof(*new_lines));
+     CePoint_t end_cursor = *cursor;
+     bool removed = false;
+
+     for(int64_t i = visual->block_top_left.y; i <= visual->block_bottom_right.y; i++){
+          int64_t index = i - visual->block_top_left.y;
+          char* line = view->buffer->lines[i];
+          int64_t start_x = visual->block_top_left.x;
+          int64_t end_x = visual->block_bottom_right.x;
+          int64_t line_last_index = ce_utf8_last_index(line);
+
+          // clamp the range to the line length
+          if(start_x > line_last_index) start_x = line_last_index;
+          if(end_x > line_last_index) end_x = line_last_index;
+          if(end_x == 0 && line_last_index == 0){
+               yank->block[index] = NULL;
+               if(remove) new_lines[index] = strdup(line);
+               continue;
+          }
+
+          char* start = ce_utf8_iterate_to(line, start_x);
+          char* end = ce_utf8_iterate_to(start, (end_x - start_x) + 1);
+          size_t prefix_len = start - line;
+          size_t block_len = end - start;
+          yank->block[index] = strndup(start, block_len);
+
+          if(remove){
+               size_t suffix_len = strlen(end);
+               char* new_line = malloc(prefix_len + suffix_len + 1);
+               memcpy(new_line, line, prefix_len);
+               memcpy(new_line + prefix_len, end, suffix_len + 1);
+               new_lines[index] = new_line;
+               end_cursor = (CePoint_t){start_x, i};
+               removed = true;
+          }
+     }
+
+     if(!remove){
+          visual->block_top_left = (CePoint_t){0, 0};
+          visual->block_bottom_right = (CePoint_t){0, 0};
+          vim->mode = CE_VIM_MODE_NORMAL;
+          return true;
+     }
+
+     if(!removed){
+          for(int64_t i = 0; i < yank->block_line_count; i++) free(new_lines[i]);
+          free(new_lines);
+          visual->block_top_left = (CePoint_t){0, 0};
+          visual->block_bottom_right = (CePoint_t){0, 0};
+          return true;
+     }
+
+     // the cursor lands where the last line's block started, once the lines are in place it can be clamped
+     bool success = ce_buffer_replace_lines_change(view->buffer, visual->block_top_left.y, yank->block_line_count,
+                                                   new_lines, yank->block_line_count, cursor, end_cursor,
+                                                   action->chain_undo);
+     if(!success){
+          for(int64_t i = 0; i < yank->block_line_count; i++) free(new_lines[i]);
+     }
+     free(new_lines);
+     if(!success) return false;
+
+     *cursor = ce_buffer_clamp_point(view->buffer, end_cursor, action->clamp_x);
+     if(view->buffer->change_node) view->buffer->change_node->change.cursor_after = *cursor;
+     vim->chain_undo = action->chain_undo;
+     vim->mode = CE_VIM_MODE_NORMAL;
+
+     if(action->verb.function == ce_vim_verb_change){
+          vim->chain_undo = true;
+          insert_mode(vim);
+     }else{
+          visual->block_top_left = (CePoint_t){0, 0};
+          visual->block_bottom_right = (CePoint_t){0, 0};
+     }
+     return true;
+}
+
 bool ce_vim_apply_action(CeVim_t* vim, CeVimAction_t* action, CeView_t* view, CePoint_t* cursor, CeVimVisualData_t* visual,
                          CeVimBufferData_t* buffer_data, const CeConfigOptions_t* config_options){
      if(vim->mode == CE_VIM_MODE_VISUAL_BLOCK && action->verb.function != ce_vim_verb_motion){
@@ -587,52 +760,15 @@ bool ce_vim_apply_action(CeVim_t* vim, CeVimAction_t* action, CeView_t* view, Ce
                visual->block_bottom_right.x = visual->point.x;
           }
 
-          bool success = true;
           if(action->verb.function == ce_vim_verb_yank ||
              action->verb.function == ce_vim_verb_delete ||
              action->verb.function == ce_vim_verb_change){
-               CeVimYank_t* yank = vim->yanks + ce_vim_register_index(action->verb.integer);
-               if(action->verb.function == ce_vim_verb_delete || action->verb.function == ce_vim_verb_change){
-                    yank = vim->yanks + ce_vim_register_index('"');
-               }
-               ce_vim_yank_free(yank);
-               yank->type = CE_VIM_YANK_TYPE_BLOCK;
-               yank->block_line_count = (visual->block_bottom_right.y - visual->block_top_left.y) + 1;
-               yank->block = malloc(yank->block_line_count * sizeof(*yank->block));
-
-               // copy each line into yank
-               for(int64_t i = visual->block_top_left.y; i <= visual->block_bottom_right.y; i++){
-                    CeRange_t motion_range = {(CePoint_t){visual->block_top_left.x, i},
-                                              (CePoint_t){visual->block_bottom_right.x, i}};
-                    int64_t yank_string_index = i - visual->block_top_left.y;
-                    int64_t line_last_index = ce_utf8_last_index(view->buffer->lines[i]);
-
-                    // clamp the range to the line length
-                    if(motion_range.start.x > line_last_index) motion_range.start.x = line_last_index;
-                    if(motion_range.end.x > line_last_index) motion_range.end.x = line_last_index;
-                    if(motion_range.end.x == 0 && line_last_index == 0){
-                         yank->block[yank_string_index] = NULL;
-                         continue;
-                    }
-
-                    int64_t motion_range_len = (motion_range.end.x - motion_range.start.x) + 1;
-                    yank->block[yank_string_index] = ce_buffer_dupe_string(view->buffer, motion_range.start, motion_range_len);
-               }
-
-               action->do_not_yank = true;
-
-               if(action->verb.function == ce_vim_verb_yank){
-                    visual->block_top_left = (CePoint_t){0, 0};
-                    visual->block_bottom_right = (CePoint_t){0, 0};
-                    vim->mode = CE_VIM_MODE_NORMAL;
-                    return success;
-               }
+               return apply_block_action(vim, action, view, cursor, visual);
           }
 
-          if(action->verb.function == ce_vim_verb_insert_mode ||
-             action->verb.function == ce_vim_verb_delete ||
-             action->verb.function == ce_vim_verb_change){
+          if(action->verb.function == ce_vim_verb_insert_mode){
                // run verb for each line in range
+               bool success = true;
                for(int64_t i = visual->block_top_left.y; i <= visual->block_bottom_right.y; i++){
                     CeRange_t motion_range = {(CePoint_t){visual->block_top_left.x, i},
                                               (CePoint_t){visual->block_bottom_right.x, i}};
@@ -645,8 +781,6 @@ bool ce_vim_apply_action(CeVim_t* vim, CeVimAction_t* action, CeView_t* view, Ce
 
                     if(!action->verb.function(vim, action, motion_range, view, cursor, visual, buffer_data, config_options)){
                          success = false;
-                    }else if(i != visual->block_top_left.y){
-                         if(view->buffer->change_node) view->buffer->change_node->change.chain = true;
                     }
                }
 
@@ -665,6 +799,7 @@ bool ce_vim_apply_action(CeVim_t* vim, CeVimAction_t* action, CeView_t* view, Ce
                CeVimMotionResult_t result = action->motion.function(vim, action, view, cursor, visual, config_options,
                                                                     buffer_data, &motion_range);
                if(result == CE_VIM_MOTION_RESULT_FAIL){
+                    vim->motion_failed = true;
                     return false;
                }else if(result == CE_VIM_MOTION_RESULT_SUCCESS_NO_MULTIPLY){
                     break;
@@ -1282,54 +1417,6 @@ CeRange_t ce_vim_find_string_boundaries(CeBuffer_t* buffer, CePoint_t start, cha
      return range;
 }
 
-// TODO: handle multiline comments
-static bool point_in_string_or_comment(CeBuffer_t* buffer, CePoint_t point){
-     if(!ce_buffer_contains_point(buffer, point)) return false;
-     CeRune_t in_string = 0;
-     CeRune_t in_comment = 0;
-     CeRune_t prev_rune = 0;
-     CeRune_t prev_prev_rune = 0;
-     char* str = buffer->lines[point.y];
-     int64_t rune_len;
-     for(int64_t i = 0; i <= point.x; i++){
-          CeRune_t rune = ce_utf8_decode(str, &rune_len);
-          switch(rune){
-          default:
-               break;
-          case '/':
-               if(prev_rune == rune && !in_string){
-                    in_comment = true;
-               }else if(in_comment && prev_rune == '/'){
-                    in_comment = false;
-               }
-               break;
-          case '*':
-               if(prev_rune == '/' && !in_string){
-                    in_comment = true;
-               }
-               break;
-          case '"':
-          case '\'':
-               if(in_string == rune){
-                    if(prev_rune != '\\'){
-                         in_string = 0;
-                    // handle case where backslash getting backslashed
-                    }else if(prev_prev_rune == '\\'){
-                         in_string = 0;
-                    }
-               }else if(in_string == 0){
-                    in_string = rune;
-               }
-               break;
-          }
-          prev_prev_rune = prev_rune;
-          prev_rune = rune;
-          str += rune_len;
-     }
-
-     return in_string || in_comment;
-}
-
 CeRange_t ce_vim_find_pair(CeBuffer_t* buffer, CePoint_t start, CeRune_t rune, bool inside, int level){
      CeRange_t range = {(CePoint_t){-1, -1}, (CePoint_t){-1, -1}};
      if(!ce_buffer_point_is_valid(buffer, start)) return range;
@@ -1376,60 +1463,31 @@ CeRange_t ce_vim_find_pair(CeBuffer_t* buffer, CePoint_t start, CeRune_t rune, b
           return ce_vim_find_big_word_boundaries(buffer, start);
      }
 
-     int64_t match_count = level;
-
-     // find left match
-     CePoint_t itr = start;
-     CeRune_t buffer_rune = ce_buffer_get_rune(buffer, itr);
-     // if we start on a right match, back up the starting point
-     if(buffer_rune == right_match){
-          itr = ce_buffer_advance_point(buffer, start, -1);
-     }else if(buffer_rune == left_match){
-          itr = ce_buffer_advance_point(buffer, start, 1);
-     }
-     CePoint_t prev = itr;
+     // starting on a right match makes it the end of the pair, any other start is inside the pair or is its start
+     CeRune_t buffer_rune = ce_buffer_get_rune(buffer, start);
+     bool start_on_right = (buffer_rune == right_match);
      CePoint_t new_start = range.start;
-     while(true){
-          buffer_rune = ce_buffer_get_rune(buffer, itr); // NOTE: decoding would be faster
-          if(buffer_rune == left_match && !point_in_string_or_comment(buffer, itr)){
-               match_count--;
-               if(match_count < 0){
-                    new_start = inside ? prev : itr;
-                    break;
-               }
-          }else if(buffer_rune == right_match && !point_in_string_or_comment(buffer, itr)){
-               match_count++;
-          }
-          if(itr.x == 0 && itr.y == 0) return range;
-          prev = itr;
-          itr = ce_buffer_advance_point(buffer, itr, -1);
-     }
-
-     // find right match
-     if(ce_points_equal(itr, start)){
-          itr = ce_buffer_advance_point(buffer, start, 1);
-     }else{
-          itr = start;
-     }
+     if(!ce_buffer_find_bracket_backward(buffer, start, !start_on_right, left_match, right_match, level, &new_start)) return range;
 
-     prev = itr;
-     match_count = level;
+     bool start_on_left = ce_points_equal(new_start, start);
      CePoint_t new_end = range.end;
-     CePoint_t end_of_buffer = {ce_utf8_last_index(buffer->lines[buffer->line_count - 1]), buffer->line_count - 1};
-     while(true){
-          buffer_rune = ce_buffer_get_rune(buffer, itr);
-          if(buffer_rune == right_match && !point_in_string_or_comment(buffer, itr)){
-               match_count--;
-               if(match_count < 0){
-                    new_end = inside ? prev : itr;
-                    break;
-               }
-          }else if(buffer_rune == left_match && !point_in_string_or_comment(buffer, itr)){
-               match_count++;
+     ce_buffer_find_bracket_forward(buffer, start, !start_on_left, left_match, right_match, level, &new_end);
+
+     if(inside){
+          // brackets right next to each other have nothing inside of them
+          if(new_end.x >= 0 && ce_points_equal(ce_buffer_advance_point(buffer, new_start, 1), new_end)) return range;
+
+          // a bracket right where the search started is kept, otherwise step inside of it
+          CePoint_t first_left = start;
+          if(start_on_right){
+               first_left = ce_buffer_advance_point(buffer, start, -1);
+          }else if(buffer_rune == left_match){
+               first_left = ce_buffer_advance_point(buffer, start, 1);
           }
-          if(itr.x == end_of_buffer.x && itr.y == end_of_buffer.y) break;
-          prev = itr;
-          itr = ce_buffer_advance_point(buffer, itr, 1);
+          CePoint_t first_right = start_on_left ? ce_buffer_advance_point(buffer, start, 1) : start;
+
+          if(!ce_points_equal(new_start, first_left)) new_start = ce_buffer_advance_point(buffer, new_start, 1);
+          if(new_end.x >= 0 && !ce_points_equal(new_end, first_right)) new_end = ce_buffer_advance_point(buffer, new_end, -1);
      }
 
      range.start = new_start;
@@ -1437,6 +1495,17 @@ CeRange_t ce_vim_find_pair(CeBuffer_t* buffer, CePoint_t start, CeRune_t rune, b
      return range;
 }
 
+// the opening half of ce_vim_find_pair(), indentation never needs to know where the pair is closed
+static CePoint_t find_open_bracket(CeBuffer_t* buffer, CePoint_t start, CeRune_t left_match, CeRune_t right_match){
+     CePoint_t match = {-1, -1};
+     if(!ce_buffer_point_is_valid(buffer, start)) return match;
+     bool start_on_right = (ce_buffer_get_rune(buffer, start) == right_match);
+     if(!ce_buffer_find_bracket_backward(buffer, start, !start_on_right, left_match, right_match, 0, &match)){
+          return (CePoint_t){-1, -1};
+     }
+     return match;
+}
+
 int64_t ce_vim_get_indentation(CeBuffer_t* buffer, CePoint_t point, int64_t tab_length){
      CeAppBufferData_t* buffer_data = buffer->app_data;
 
@@ -1444,18 +1513,20 @@ int64_t ce_vim_get_indentation(CeBuffer_t* buffer, CePoint_t point, int64_t tab_
         buffer_data->syntax_function == ce_syntax_highlight_cpp ||
         buffer_data->syntax_function == ce_syntax_highlight_java ||
         buffer_data->syntax_function == ce_syntax_highlight_config){
-          CeRange_t brace_range = ce_vim_find_pair(buffer, point, '{', false, 0);
-          CeRange_t paren_range = ce_vim_find_pair(buffer, point, '(', false, 0);
-          if(brace_range.start.x < 0 && paren_range.start.x < 0) return 0;
+          // the buffer's bracket index keeps per line bracket depths up to date as we type, so finding the enclosing
+          // brace and paren doesn't rescan the lines between them on every newline or '}'
+          CePoint_t brace = find_open_bracket(buffer, point, '{', '}');
+          CePoint_t paren = find_open_bracket(buffer, point, '(', ')');
+          if(brace.x < 0 && paren.x < 0) return 0;
           int64_t indent = 0;
-          if(ce_point_after(paren_range.start, brace_range.start)){
-               indent = paren_range.start.x + 1;
+          if(ce_point_after(paren, brace)){
+               indent = paren.x + 1;
           }else{
-               indent = ce_vim_soft_begin_line(buffer, brace_range.start.y);
+               indent = ce_vim_soft_begin_line(buffer, brace.y);
                // if in our indent, we are inside parens, get the indentation of where the parens started
-               paren_range = ce_vim_find_pair(buffer, (CePoint_t){indent, brace_range.start.y}, '(', false, 0);
-               if(paren_range.start.x >= 0){
-                    indent = ce_vim_soft_begin_line(buffer, paren_range.start.y);
+               paren = find_open_bracket(buffer, (CePoint_t){indent, brace.y}, '(', ')');
+               if(paren.x >= 0){
+                    indent = ce_vim_soft_begin_line(buffer, paren.y);
                }
                indent += tab_length;
           }
@@ -2047,6 +2118,17 @@ CeVimParseResult_t ce_vim_parse_verb_unindent(CeVimAction_t* action, const CeVim
      return CE_VIM_PARSE_INVALID;
 }
 
+CeVimParseResult_t ce_vim_parse_verb_filter(CeVimAction_t* action, const CeVim_t* vim, CeRune_t key){
+     if(action->verb.function == NULL){
+          action->verb.function = ce_vim_verb_filter;
+          return CE_VIM_PARSE_IN_PROGRESS;
+     }else if(action->verb.function == ce_vim_verb_filter){
+          return CE_VIM_PARSE_COMPLETE;
+     }
+
+     return CE_VIM_PARSE_INVALID;
+}
+
 CeVimParseResult_t ce_vim_parse_verb_flip_case(CeVimAction_t* action, const CeVim_t* vim, CeRune_t key){
      action->repeatable = true;
      action->motion.function = ce_vim_motion_right;
@@ -2078,24 +2160,33 @@ CeVimParseResult_t ce_vim_parse_verb_decrement_number(CeVimAction_t* action, con
      return CE_VIM_PARSE_COMPLETE;
 }
 
-static CeVimMotionResult_t motion_direction(const CeView_t* view, CePoint_t delta, const CeConfigOptions_t* config_options,
-                                            CeRange_t* motion_range){
+static int64_t action_count(const CeVimAction_t* action){
+     return action->multiplier * action->motion.multiplier;
+}
+
+// take the whole count as one move, like vim does. this isn't the same as count single steps: a shorter line in
+// between would clamp the column of a step, but only the line we land on clamps the column of one big move
+static CeVimMotionResult_t motion_direction(const CeVimAction_t* action, const CeView_t* view, CePoint_t delta,
+                                            const CeConfigOptions_t* config_options, CeRange_t* motion_range){
+     int64_t count = action_count(action);
+     delta.x *= count;
+     delta.y *= count;
      CePoint_t destination = ce_buffer_move_point(view->buffer, motion_range->end, delta, config_options->tab_width, CE_CLAMP_X_INSIDE);
      if(destination.x < 0) return CE_VIM_MOTION_RESULT_FAIL;
      motion_range->end = destination;
-     return CE_VIM_MOTION_RESULT_SUCCESS;
+     return CE_VIM_MOTION_RESULT_SUCCESS_NO_MULTIPLY;
 }
 
 CeVimMotionResult_t ce_vim_motion_left(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
                                        CeVimVisualData_t* visual, const CeConfigOptions_t* config_options,
                                        CeVimBufferData_t* buffer_data, CeRange_t* motion_range){
-     return motion_direction(view, (CePoint_t){-1, 0}, config_options, motion_range);
+     return motion_direction(action, view, (CePoint_t){-1, 0}, config_options, motion_range);
 }
 
 CeVimMotionResult_t ce_vim_motion_right(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
                                         CeVimVisualData_t* visual, const CeConfigOptions_t* config_options,
                                         CeVimBufferData_t* buffer_data, CeRange_t* motion_range){
-     return motion_direction(view, (CePoint_t){1, 0}, config_options, motion_range);
+     return motion_direction(action, view, (CePoint_t){1, 0}, config_options, motion_range);
 }
 
 CeVimMotionResult_t ce_vim_motion_up(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
@@ -2103,17 +2194,18 @@ CeVimMotionResult_t ce_vim_motion_up(CeVim_t* vim, CeVimAction_t* action, const
                                      CeVimBufferData_t* buffer_data, CeRange_t* motion_range){
      if(action->verb.function != ce_vim_verb_motion){
           if(motion_range->start.y > 0){
-               // we use start instead of end so that we can sort them consistently through a motion multiplier
-               motion_range->start.y--;
+               // we use start instead of end so that we can sort them consistently
+               motion_range->start.y -= action_count(action);
+               if(motion_range->start.y < 0) motion_range->start.y = 0;
                motion_range->start.x = 0;
                motion_range->end.x = ce_utf8_last_index(view->buffer->lines[motion_range->end.y]);
                ce_range_sort(motion_range);
           }
 
-          return CE_VIM_MOTION_RESULT_SUCCESS;
+          return CE_VIM_MOTION_RESULT_SUCCESS_NO_MULTIPLY;
      }
 
-     return motion_direction(view, (CePoint_t){0, -1}, config_options, motion_range);
+     return motion_direction(action, view, (CePoint_t){0, -1}, config_options, motion_range);
 }
 
 CeVimMotionResult_t ce_vim_motion_down(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
@@ -2121,15 +2213,16 @@ CeVimMotionResult_t ce_vim_motion_down(CeVim_t* vim, CeVimAction_t* action, cons
                                        CeVimBufferData_t* buffer_data, CeRange_t* motion_range){
      if(action->verb.function != ce_vim_verb_motion){
           if(motion_range->end.y < view->buffer->line_count - 1){
-               motion_range->end.y++;
+               motion_range->end.y += action_count(action);
+               if(motion_range->end.y >= view->buffer->line_count) motion_range->end.y = view->buffer->line_count - 1;
                motion_range->end.x = ce_utf8_last_index(view->buffer->lines[motion_range->end.y]);
                motion_range->start.x = 0;
                ce_range_sort(motion_range);
           }
-          return CE_VIM_MOTION_RESULT_SUCCESS;
+          return CE_VIM_MOTION_RESULT_SUCCESS_NO_MULTIPLY;
      }
 
-     return motion_direction(view, (CePoint_t){0, 1}, config_options, motion_range);
+     return motion_direction(action, view, (CePoint_t){0, 1}, config_options, motion_range);
 }
 
 CeVimMotionResult_t ce_vim_motion_little_word(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
@@ -2216,38 +2309,42 @@ CeVimMotionResult_t ce_vim_motion_end_line(CeVim_t* vim, CeVimAction_t* action,
 CeVimMotionResult_t ce_vim_motion_entire_line(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
                                               CeVimVisualData_t* visual, const CeConfigOptions_t* config_options,
                                               CeVimBufferData_t* buffer_data, CeRange_t* motion_range){
-     int64_t line_length = ce_utf8_strlen(view->buffer->lines[motion_range->end.y]);
+     // a count covers that many lines starting at the current one
+     int64_t last_line = motion_range->end.y + action_count(action) - 1;
+     if(last_line >= view->buffer->line_count) last_line = view->buffer->line_count - 1;
+     if(last_line < motion_range->end.y) last_line = motion_range->end.y;
+     int64_t line_length = ce_utf8_strlen(view->buffer->lines[last_line]);
      motion_range->start = (CePoint_t){0, motion_range->end.y};
-     motion_range->end = (CePoint_t){line_length, motion_range->end.y};
-     return CE_VIM_MOTION_RESULT_SUCCESS;
+     motion_range->end = (CePoint_t){line_length, last_line};
+     return CE_VIM_MOTION_RESULT_SUCCESS_NO_MULTIPLY;
 }
 
 CeVimMotionResult_t ce_vim_motion_page_up(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
                                           CeVimVisualData_t* visual, const CeConfigOptions_t* config_options,
                                           CeVimBufferData_t* buffer_data, CeRange_t* motion_range){
-     motion_range->end.y -= (view->rect.bottom - view->rect.top);
-     return CE_VIM_MOTION_RESULT_SUCCESS;
+     motion_range->end.y -= ((view->rect.bottom - view->rect.top)) * action_count(action);
+     return CE_VIM_MOTION_RESULT_SUCCESS_NO_MULTIPLY;
 }
 
 CeVimMotionResult_t ce_vim_motion_page_down(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
                                             CeVimVisualData_t* visual, const CeConfigOptions_t* config_options,
                                             CeVimBufferData_t* buffer_data, CeRange_t* motion_range){
-     motion_range->end.y += (view->rect.bottom - view->rect.top);
-     return CE_VIM_MOTION_RESULT_SUCCESS;
+     motion_range->end.y += ((view->rect.bottom - view->rect.top)) * action_count(action);
+     return CE_VIM_MOTION_RESULT_SUCCESS_NO_MULTIPLY;
 }
 
 CeVimMotionResult_t ce_vim_motion_half_page_up(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
                                                CeVimVisualData_t* visual, const CeConfigOptions_t* config_options,
                                                CeVimBufferData_t* buffer_data, CeRange_t* motion_range){
-     motion_range->end.y -= (view->rect.bottom - view->rect.top) / 2;
-     return CE_VIM_MOTION_RESULT_SUCCESS;
+     motion_range->end.y -= ((view->rect.bottom - view->rect.top) / 2) * action_count(action);
+     return CE_VIM_MOTION_RESULT_SUCCESS_NO_MULTIPLY;
 }
 
 CeVimMotionResult_t ce_vim_motion_half_page_down(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
                                                  CeVimVisualData_t* visual, const CeConfigOptions_t* config_options,
                                                  CeVimBufferData_t* buffer_data, CeRange_t* motion_range){
-     motion_range->end.y += (view->rect.bottom - view->rect.top) / 2;
-     return CE_VIM_MOTION_RESULT_SUCCESS;
+     motion_range->end.y += ((view->rect.bottom - view->rect.top) / 2) * action_count(action);
+     return CE_VIM_MOTION_RESULT_SUCCESS_NO_MULTIPLY;
 }
 
 CeVimMotionResult_t ce_vim_motion_visual(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
@@ -2411,7 +2508,7 @@ CeVimMotionResult_t ce_vim_motion_end_of_file(CeVim_t* vim, CeVimAction_t* actio
                                               CeVimVisualData_t* visual, const CeConfigOptions_t* config_options,
                                               CeVimBufferData_t* buffer_data, CeRange_t* motion_range){
      motion_range->end = ce_buffer_end_point(view->buffer);
-     return CE_VIM_MOTION_RESULT_SUCCESS;
+     return CE_VIM_MOTION_RESULT_SUCCESS_NO_MULTIPLY;
 }
 
 CeVimMotionResult_t ce_vim_motion_search_next(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor,
@@ -2527,7 +2624,7 @@ static void search_word(CeVim_t* vim, CeVimAction_t* action, const CeView_t* vie
      int64_t word_len = ce_buffer_range_len(view->buffer, motion_range->start, motion_range->end);
      char* word = ce_buffer_dupe_string(view->buffer, motion_range->start, word_len);
      int64_t search_len = word_len + 4;
-     yank->text = malloc(search_len + 1);
+     yank->text = ce_shared_string_alloc(search_len);
      snprintf(yank->text, search_len + 1, "\\b%s\\b", word); // TODO: this doesn't work on other platforms like macos
      yank->text[search_len] = 0;
      free(word);
@@ -2741,7 +2838,7 @@ void ce_vim_yank_free(CeVimYank_t* yank){
           break;
      case CE_VIM_YANK_TYPE_STRING:
      case CE_VIM_YANK_TYPE_LINE:
-          free(yank->text);
+          ce_shared_string_release(yank->text);
           yank->text = NULL;
           break;
      case CE_VIM_YANK_TYPE_BLOCK:
@@ -2805,9 +2902,10 @@ bool ce_vim_verb_delete(CeVim_t* vim, const CeVimAction_t* action, CeRange_t mot
      if(ce_point_after(motion_range.end, buffer_end) && motion_range.end.x != 0){
           delete_len = ce_buffer_range_len(view->buffer, motion_range.start, buffer_end);
      }
-     char* removed_string = ce_buffer_dupe_string(view->buffer, motion_range.start, delete_len);
+     // the undo history and the yank register share the removed text
+     char* removed_string = ce_buffer_dupe_shared_string(view->buffer, motion_range.start, delete_len);
      if(!ce_buffer_remove_string(view->buffer, motion_range.start, delete_len)){
-          free(removed_string);
+          ce_shared_string_release(removed_string);
           return false;
      }
 
@@ -2825,6 +2923,7 @@ bool ce_vim_verb_delete(CeVim_t* vim, const CeVimAction_t* action, CeRange_t mot
      CeBufferChange_t change = {};
      change.chain = action->chain_undo;
      change.insertion = false;
+     change.shared_string = true;
      change.string = removed_string;
      change.location = motion_range.start;
      change.cursor_before = *cursor;
@@ -2838,7 +2937,7 @@ bool ce_vim_verb_delete(CeVim_t* vim, const CeVimAction_t* action, CeRange_t mot
      if(!action->do_not_yank){
           CeVimYank_t* yank = vim->yanks + ce_vim_register_index('"');
           ce_vim_yank_free(yank);
-          yank->text = strdup(removed_string);
+          yank->text = ce_shared_string_acquire(removed_string);
           yank->type = yank_type;
      }
      return true;
@@ -2903,15 +3002,22 @@ bool ce_vim_verb_delete_character(CeVim_t* vim, const CeVimAction_t* action, CeR
                                   const CeConfigOptions_t* config_options){
      ce_range_sort(&motion_range);
 
-     while(!ce_point_after(motion_range.start, motion_range.end)){
-          ce_buffer_remove_string_change(view->buffer, *cursor, 1, cursor, *cursor, false);
+     // a count deletes that many characters, up to the end of the line
+     if(!action->motion.function){
+          int64_t last_index = ce_utf8_last_index(view->buffer->lines[motion_range.end.y]);
+          motion_range.end.x += action_count(action) - 1;
+          if(motion_range.end.x > last_index) motion_range.end.x = last_index;
+     }
 
-          CePoint_t new_start = ce_buffer_advance_point(view->buffer, motion_range.start, 1);
-          if(ce_points_equal(new_start, motion_range.start)) return false;
-          motion_range.start = new_start;
+     // remove the whole range as a single change, rather than a character at a time
+     int64_t remove_len = ce_buffer_range_len(view->buffer, motion_range.start, motion_range.end);
+     if(remove_len <= 0) return false;
+     CePoint_t end_cursor = motion_range.start;
+     if(!ce_buffer_remove_string_change(view->buffer, motion_range.start, remove_len, cursor, end_cursor, false)){
+          return false;
      }
 
-     *cursor = ce_buffer_clamp_point(view->buffer, motion_range.end, action->clamp_x);
+     *cursor = ce_buffer_clamp_point(view->buffer, end_cursor, action->clamp_x);
      return true;
 }
 
@@ -2960,7 +3066,7 @@ bool ce_vim_verb_yank(CeVim_t* vim, const CeVimAction_t* action, CeRange_t motio
           motion_range.end = ce_buffer_advance_point(view->buffer, motion_range.end, -1);
      }
      yank_len = ce_buffer_range_len(view->buffer, motion_range.start, motion_range.end);
-     yank->text = ce_buffer_dupe_string(view->buffer, motion_range.start, yank_len);
+     yank->text = ce_buffer_dupe_shared_string(view->buffer, motion_range.start, yank_len);
      yank->type = action->yank_type;
      vim->mode = CE_VIM_MODE_NORMAL;
      return true;
@@ -3062,7 +3168,9 @@ static bool paste_text(CeVim_t* vim, const CeVimAction_t* action, CeRange_t moti
      }
      }
 
-     char* insert_str = strdup(yank->text);
+     // the undo history shares the register's text, unless it needs rearranging below
+     char* insert_str = ce_shared_string_acquire(yank->text);
+     bool shared_string = true;
 
      // if we are inserting at the end of a file, put the newline at the beginning and insert at the end of the previous line
      if(insertion_point.x == 0 && insertion_point.y == view->buffer->line_count){
@@ -3070,6 +3178,9 @@ static bool paste_text(CeVim_t* vim, const CeVimAction_t* action, CeRange_t moti
           if(insert_len > 0){
                int64_t last_index = insert_len - 1;
                if(insert_str[last_index] == CE_NEWLINE){
+                    ce_shared_string_release(insert_str);
+                    insert_str = strdup(yank->text);
+                    shared_string = false;
                     for(int64_t i = last_index; i > 0; i--){
                          insert_str[i] = insert_str[i - 1];
                     }
@@ -3080,7 +3191,11 @@ static bool paste_text(CeVim_t* vim, const CeVimAction_t* action, CeRange_t moti
           }
      }
 
-     if(!ce_buffer_insert_string(view->buffer, insert_str, insertion_point)) return false;
+     if(!ce_buffer_insert_string(view->buffer, insert_str, insertion_point)){
+          if(shared_string) ce_shared_string_release(insert_str);
+          else free(insert_str);
+          return false;
+     }
 
      CePoint_t cursor_end = {};
 
@@ -3099,6 +3214,7 @@ static bool paste_text(CeVim_t* vim, const CeVimAction_t* action, CeRange_t moti
      CeBufferChange_t change = {};
      change.chain = action->chain_undo;
      change.insertion = true;
+     change.shared_string = shared_string;
      change.string = insert_str;
      change.location = insertion_point;
      change.cursor_before = *cursor;
@@ -3227,7 +3343,7 @@ bool ce_vim_verb_replace_mode(CeVim_t* vim, const CeVimAction_t* action, CeRange
                               CePoint_t* cursor, CeVimVisualData_t* visual, CeVimBufferData_t* buffer_data,
                               const CeConfigOptions_t* config_options){
      vim->mode = CE_VIM_MODE_REPLACE;
-     if(!vim->verb_last_action) ce_rune_node_free(&vim->insert_rune_head);
+     if(!vim->verb_last_action) ce_rune_array_clear(&vim->insert_runes);
      return true;
 }
 
@@ -3296,16 +3412,8 @@ bool ce_vim_verb_last_action(CeVim_t* vim, const CeVimAction_t* action, CeRange_
           return false;
      }
 
-     if(vim->last_insert_rune_head){
-          CeRune_t* rune_string = ce_rune_node_string(vim->last_insert_rune_head);
-          CeRune_t* itr = rune_string;
-
-          while(*itr){
-               ce_vim_handle_key(vim, view, cursor, visual, *itr, buffer_data, config_options, true);
-               itr++;
-          }
-
-          free(rune_string);
+     for(int64_t i = 0; i < vim->last_insert_runes.count; i++){
+          ce_vim_handle_key(vim, view, cursor, visual, vim->last_insert_runes.runes[i], buffer_data, config_options, true);
      }
 
      if(change_node && change_node->next) change_node->next->change.chain = false;
@@ -3409,6 +3517,16 @@ bool ce_vim_verb_indent(CeVim_t* vim, const CeVimAction_t* action, CeRange_t mot
      return true;
 }
 
+bool ce_vim_verb_filter(CeVim_t* vim, const CeVimAction_t* action, CeRange_t motion_range, CeView_t* view,
+                        CePoint_t* cursor, CeVimVisualData_t* visual, CeVimBufferData_t* buffer_data,
+                        const CeConfigOptions_t* config_options){
+     ce_range_sort(&motion_range);
+     visual->point = (CePoint_t){0, motion_range.start.y};
+     *cursor = (CePoint_t){0, motion_range.end.y};
+     vim->mode = CE_VIM_MODE_VISUAL_LINE;
+     return true;
+}
+
 bool ce_vim_verb_unindent(CeVim_t* vim, const CeVimAction_t* action, CeRange_t motion_range, CeView_t* view,
                           CePoint_t* cursor, CeVimVisualData_t* visual, CeVimBufferData_t* buffer_data,
                           const CeConfigOptions_t* config_options){
@@ -4,6 +4,8 @@
 
 #define CE_VIM_MAX_COMMAND_LEN 16
 #define CE_VIM_MAX_KEY_BINDS 256
+#define CE_VIM_KEY_BIND_TABLE_SIZE 512 // ascii and the ncurses KEY_* codes
+#define CE_VIM_KEY_BIND_HASH_SIZE 64
 
 #define CE_VIM_DECLARE_MOTION_FUNC(function_name)                                                                     \
 CeVimMotionResult_t function_name(CeVim_t* vim, CeVimAction_t* action, const CeView_t* view, const CePoint_t* cursor, \
@@ -141,13 +143,20 @@ typedef struct CeVim_t{
      CeVimMode_t mode;
      CeVimKeyBind_t key_binds[CE_VIM_MAX_KEY_BINDS];
      int64_t key_bind_count;
+     // first bind for each key, indexed directly or hashed for keys past the table, then chained in the order the
+     // binds were added. entries are a bind index + 1 so a zeroed table has no binds
+     int16_t key_bind_table[CE_VIM_KEY_BIND_TABLE_SIZE];
+     int16_t key_bind_hash[CE_VIM_KEY_BIND_HASH_SIZE];
+     int16_t key_bind_next[CE_VIM_MAX_KEY_BINDS];
+     int64_t key_bind_indexed_count; // binds are only ever added, so a different count means the table is stale
      CeRune_t current_command[CE_VIM_MAX_COMMAND_LEN];
      CeVimYank_t yanks[CE_ASCII_PRINTABLE_CHARACTERS];
      CeVimAction_t last_action;
      CeVimAction_t current_action;
-     CeRuneNode_t* insert_rune_head;
-     CeRuneNode_t* last_insert_rune_head;
+     CeRuneArray_t insert_runes;
+     CeRuneArray_t last_insert_runes;
      bool chain_undo;
+     bool motion_failed; // set when an action's motion or search fails, replaying a macro clears it and stops on it
      bool verb_last_action; // flag whether or not we are repeating our last action
      bool pasting;
      CeVimSearchMode_t search_mode;
@@ -262,6 +271,7 @@ CeVimParseResult_t ce_vim_parse_verb_g_command(CeVimAction_t* action, const CeVi
 CeVimParseResult_t ce_vim_parse_verb_indent(CeVimAction_t* action, const CeVim_t* vim, CeRune_t key);
 CeVimParseResult_t ce_vim_parse_verb_unindent(CeVimAction_t* action, const CeVim_t* vim, CeRune_t key);
 CeVimParseResult_t ce_vim_parse_verb_join(CeVimAction_t* action, const CeVim_t* vim, CeRune_t key);
+CeVimParseResult_t ce_vim_parse_verb_filter(CeVimAction_t* action, const CeVim_t* vim, CeRune_t key);
 CeVimParseResult_t ce_vim_parse_verb_flip_case(CeVimAction_t* action, const CeVim_t* vim, CeRune_t key);
 CeVimParseResult_t ce_vim_parse_verb_set_mark(CeVimAction_t* action, const CeVim_t* vim, CeRune_t key);
 CeVimParseResult_t ce_vim_parse_verb_increment_number(CeVimAction_t* action, const CeVim_t* vim, CeRune_t key);
@@ -341,6 +351,7 @@ CE_VIM_DECLARE_VERB_FUNC(ce_vim_verb_g_command);
 CE_VIM_DECLARE_VERB_FUNC(ce_vim_verb_indent);
 CE_VIM_DECLARE_VERB_FUNC(ce_vim_verb_unindent);
 CE_VIM_DECLARE_VERB_FUNC(ce_vim_verb_join);
+CE_VIM_DECLARE_VERB_FUNC(ce_vim_verb_filter); // selects the lines for the app to ask for a command to filter them through
 CE_VIM_DECLARE_VERB_FUNC(ce_vim_verb_flip_case);
 CE_VIM_DECLARE_VERB_FUNC(ce_vim_verb_set_mark);
 CE_VIM_DECLARE_VERB_FUNC(ce_vim_verb_increment_number);
@@ -9,9 +9,12 @@
 #include <assert.h>
 #include <signal.h>
 #include <errno.h>
+#include <inttypes.h>
 
 #include "ce_app.h"
 #include "ce_commands.h"
+#include "ce_draw.h"
+#include "ce_syntax_worker.h"
 
 FILE* g_ce_log = NULL;
 CeBuffer_t* g_ce_log_buffer = NULL;
@@ -21,9 +24,11 @@ int g_last_key = 0;
 
 // limit to 60 fps
 #define DRAW_USEC_LIMIT 16666
+#define YANK_PREVIEW_LINES 4
+#define YANK_PREVIEW_BLOCK_LINES 8
 
 void handle_sigint(int signal){
-     // pass
+     g_sigint_received = 1;
 }
 
 typedef struct{
@@ -85,6 +90,35 @@ static void build_buffer_list(CeBuffer_t* buffer, CeBufferNode_t* head){
      buffer->status = CE_BUFFER_STATUS_READONLY;
 }
 
+// copy at most YANK_PREVIEW_LINES lines of text into preview, ending with "..." if anything was left out, without
+// scanning past what fits
+static void build_yank_preview(char* preview, int64_t preview_size, const char* text){
+     int64_t limit = preview_size - 4; // room for "..." and the terminator
+     int64_t lines = 1;
+     int64_t len = 0;
+     while(text[len] && len < limit){
+          if(text[len] == CE_NEWLINE){
+               if(lines >= YANK_PREVIEW_LINES) break;
+               lines++;
+          }
+          len++;
+     }
+
+     bool truncated = text[len] && !(text[len] == CE_NEWLINE && text[len + 1] == 0);
+
+     // don't split a utf8 character
+     if(truncated){
+          while(len > 0 && (text[len] & 0xC0) == 0x80) len--;
+     }
+
+     memcpy(preview, text, len);
+     if(truncated){
+          memcpy(preview + len, "...", 3);
+          len += 3;
+     }
+     preview[len] = 0;
+}
+
 static void build_yank_list(CeBuffer_t* buffer, CeVimYank_t* yanks){
      char line[256];
      ce_buffer_empty(buffer);
@@ -108,8 +142,12 @@ static void build_yank_list(CeBuffer_t* buffer, CeVimYank_t* yanks){
                snprintf(line, 256, "// register '%c': type: %s\n", reg, yank_type);
                buffer_append_on_new_line(buffer, line);
                for(int64_t l = 0; l < yank->block_line_count; l++){
+                    if(l >= YANK_PREVIEW_BLOCK_LINES){
+                         buffer_append_on_new_line(buffer, "...");
+                         break;
+                    }
                     if(yank->block[l]){
-                         strncpy(line, yank->block[l], 256);
+                         build_yank_preview(line, 256, yank->block[l]);
                          buffer_append_on_new_line(buffer, line);
                     }else{
                          int64_t last_line = buffer->line_count;
@@ -120,7 +158,10 @@ static void build_yank_list(CeBuffer_t* buffer, CeVimYank_t* yanks){
                     }
                }
           }else{
-               snprintf(line, 256, "// register '%c': type: %s\n%s\n", reg, yank_type, yank->text);
+               // the preview fills whatever the header leaves, keeping room for the final newline
+               int header_len = snprintf(line, 256, "// register '%c': type: %s\n", reg, yank_type);
+               build_yank_preview(line + header_len, 256 - header_len - 1, yank->text);
+               strcat(line, "\n");
                buffer_append_on_new_line(buffer, line);
           }
      }
@@ -170,13 +211,11 @@ static void build_macro_list(CeBuffer_t* buffer, CeMacros_t* macros){
      ce_buffer_empty(buffer);
      char line[256];
      for(int64_t i = 0; i < CE_ASCII_PRINTABLE_CHARACTERS; i++){
-          CeRuneNode_t* rune_head = macros->rune_head[i];
-          if(!rune_head) continue;
-          CeRune_t* rune_string = ce_rune_node_string(rune_head);
-          char* string = ce_rune_string_to_char_string(rune_string);
+          CeRuneArray_t* macro = macros->registers + i;
+          if(!macro->count) continue;
+          char* string = ce_rune_string_to_char_string(macro->runes);
           char reg = i + '!';
           snprintf(line, 256, "// register '%c'\n%s", reg, string);
-          free(rune_string);
           free(string);
           buffer_append_on_new_line(buffer, line);
      }
@@ -213,6 +252,22 @@ static void build_mark_list(CeBuffer_t* buffer, CeVimBufferData_t* buffer_data){
      buffer->status = CE_BUFFER_STATUS_READONLY;
 }
 
+static void build_perf_list(CeBuffer_t* buffer, CePerf_t* perf){
+     ce_buffer_empty(buffer);
+     char line[256];
+     snprintf(line, 256, "%-18s %8s %8s %8s %8s %10s", "// phase (usec)", "p50", "p95", "p99", "max", "samples");
+     buffer_append_on_new_line(buffer, line);
+     for(int64_t i = 0; i < CE_PERF_PHASE_COUNT; i++){
+          CePerfHistogram_t* histogram = perf->phases + i;
+          CePerfPercentiles_t percentiles = ce_perf_percentiles(histogram);
+          snprintf(line, 256, "%-18s %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %10" PRIu64, ce_perf_phase_name(i), percentiles.p50, percentiles.p95,
+                   percentiles.p99, histogram->max, histogram->total_count);
+          buffer_append_on_new_line(buffer, line);
+     }
+
+     buffer->status = CE_BUFFER_STATUS_READONLY;
+}
+
 static void build_jump_list(CeBuffer_t* buffer, CeJumpList_t* jump_list){
      ce_buffer_empty(buffer);
      char line[256];
@@ -241,6 +296,13 @@ static void build_jump_list(CeBuffer_t* buffer, CeJumpList_t* jump_list){
      buffer->status = CE_BUFFER_STATUS_READONLY;
 }
 
+static int compare_points(const void* a, const void* b){
+     const CePoint_t* point_a = a;
+     const CePoint_t* point_b = b;
+     if(point_a->y != point_b->y) return (point_a->y > point_b->y) - (point_a->y < point_b->y);
+     return (point_a->x > point_b->x) - (point_a->x < point_b->x);
+}
+
 void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, CeVisualLineDisplayType_t visual_line_display_type,
                CeMultipleCursors_t* multiple_cursors, CeDrawColorList_t* draw_color_list, CeColorDefs_t* color_defs, CeSyntaxDef_t* syntax_defs,
                int64_t terminal_right, CeRune_t show_line_extends_passed_view_as){
@@ -266,6 +328,23 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
           }
      }
 
+     // gather the multiple cursors on screen sorted by line, so each line can walk them alongside the runes
+     CePoint_t* visible_cursors = NULL;
+     int64_t visible_cursor_count = 0;
+     int64_t visible_cursor_index = 0;
+     if(multiple_cursors && multiple_cursors->count){
+          visible_cursors = malloc(multiple_cursors->count * sizeof(*visible_cursors));
+          if(visible_cursors){
+               for(int64_t m = 0; m < multiple_cursors->count; m++){
+                    CePoint_t cursor = multiple_cursors->cursors[m];
+                    if(cursor.y < row_min || cursor.y >= row_min + view_height) continue;
+                    visible_cursors[visible_cursor_count] = cursor;
+                    visible_cursor_count++;
+               }
+               qsort(visible_cursors, visible_cursor_count, sizeof(*visible_cursors), compare_points);
+          }
+     }
+
      if(view->buffer->line_count >= 0){
           int last_bg = COLOR_DEFAULT;
           int last_fg = COLOR_DEFAULT;
@@ -278,7 +357,7 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
                CeRune_t rune = 1;
                int64_t real_y = y + view->scroll.y;
 
-               move(view->rect.top + y, view->rect.left);
+               ce_draw_move(view->rect.top + y, view->rect.left);
 
                if(!view->buffer->no_line_numbers && line_number){
                     int fg = COLOR_DEFAULT;
@@ -289,23 +368,20 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
                     }
                     fg = ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_LINE_NUMBER, fg);
                     bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_LINE_NUMBER, bg);
-                    int change_color_pair = ce_color_def_get(color_defs, fg, bg);
-                    attron(COLOR_PAIR(change_color_pair));
+                    ce_draw_color(color_defs, fg, bg);
                     int value = real_y + 1;
                     if(line_number == CE_LINE_NUMBER_RELATIVE || (line_number == CE_LINE_NUMBER_ABSOLUTE_AND_RELATIVE && view->cursor.y != real_y)){
                          value = abs((int)(view->cursor.y - real_y));
                     }
-                    printw("%*d ", line_number_size, value);
+                    ce_draw_printf("%*d ", line_number_size, value);
                }
 
-               standend();
+               ce_draw_standend();
                if(!view->buffer->no_highlight_current_line && real_y == view->cursor.y){
                     int bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_CURRENT_LINE, COLOR_DEFAULT);
-                    int change_color_pair = ce_color_def_get(color_defs, COLOR_DEFAULT, bg);
-                    attron(COLOR_PAIR(change_color_pair));
+                    ce_draw_color(color_defs, COLOR_DEFAULT, bg);
                }else if(draw_color_node && ce_point_after((CePoint_t){index, y + view->scroll.y}, draw_color_node->point)){
-                    int change_color_pair = ce_color_def_get(color_defs, draw_color_node->fg, draw_color_node->bg);
-                    attron(COLOR_PAIR(change_color_pair));
+                    ce_draw_color(color_defs, draw_color_node->fg, draw_color_node->bg);
                }
 
                if(line_index < view->buffer->line_count){
@@ -321,8 +397,7 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
                                    bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_CURRENT_LINE, bg);
                               }
 
-                              int change_color_pair = ce_color_def_get(color_defs, draw_color_node->fg, bg);
-                              attron(COLOR_PAIR(change_color_pair));
+                              ce_draw_color(color_defs, draw_color_node->fg, bg);
                               last_bg = bg;
                               last_fg = draw_color_node->fg;
                               draw_color_node = draw_color_node->next;
@@ -342,49 +417,42 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
                                   next_rune != 0){
                               int new_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_LINE_EXTENDS_PASSED_VIEW, COLOR_DEFAULT);
                               int new_fg = ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_LINE_EXTENDS_PASSED_VIEW, COLOR_DEFAULT);
-                              int change_color_pair = ce_color_def_get(color_defs, new_fg, new_bg);
-                              attron(COLOR_PAIR(change_color_pair));
-                              addch(show_line_extends_passed_view_as);
-                              standend();
+                              ce_draw_color(color_defs, new_fg, new_bg);
+                              ce_draw_rune(show_line_extends_passed_view_as);
+                              ce_draw_standend();
                               x++;
                          }else if(x >= col_min && rune > 0){
                               bool showed_one_of_the_multiple_cursors = false;
 
-                              if(multiple_cursors){
-                                   for(int64_t m = 0; m < multiple_cursors->count; m++){
-                                        if(real_y == multiple_cursors->cursors[m].y && x == multiple_cursors->cursors[m].x){
-                                             int new_bg = 0;
-                                             if(multiple_cursors->active){
-                                                  new_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_MULTIPLE_CURSOR_ACTIVE, last_bg);
-                                             }else{
-                                                  new_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_MULTIPLE_CURSOR_INACTIVE, last_bg);
-                                             }
-                                             int change_color_pair = ce_color_def_get(color_defs, last_fg, new_bg);
-                                             attron(COLOR_PAIR(change_color_pair));
-                                             showed_one_of_the_multiple_cursors = true;
-                                             break;
-                                        }
+                              // skip cursors we have already drawn passed
+                              while(visible_cursor_index < visible_cursor_count &&
+                                    (visible_cursors[visible_cursor_index].y < real_y ||
+                                     (visible_cursors[visible_cursor_index].y == real_y && visible_cursors[visible_cursor_index].x < x))){
+                                   visible_cursor_index++;
+                              }
+
+                              if(visible_cursor_index < visible_cursor_count &&
+                                 visible_cursors[visible_cursor_index].y == real_y && visible_cursors[visible_cursor_index].x == x){
+                                   int new_bg = 0;
+                                   if(multiple_cursors->active){
+                                        new_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_MULTIPLE_CURSOR_ACTIVE, last_bg);
+                                   }else{
+                                        new_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_MULTIPLE_CURSOR_INACTIVE, last_bg);
                                    }
+                                   ce_draw_color(color_defs, last_fg, new_bg);
+                                   showed_one_of_the_multiple_cursors = true;
                               }
 
                               if(rune == CE_TAB){
                                    x += tab_width;
-                                   addstr(tab_str);
-                              }else if(rune >= 0x80){
-                                   char utf8_string[CE_UTF8_SIZE + 1];
-                                   int64_t bytes_written = 0;
-                                   ce_utf8_encode(rune, utf8_string, CE_UTF8_SIZE, &bytes_written);
-                                   utf8_string[bytes_written] = 0;
-                                   addstr(utf8_string);
-                                   x++;
+                                   ce_draw_string(tab_str);
                               }else{
-                                   addch(rune);
+                                   ce_draw_rune(rune);
                                    x++;
                               }
 
                               if(showed_one_of_the_multiple_cursors){
-                                   int change_color_pair = ce_color_def_get(color_defs, last_fg, last_bg);
-                                   attron(COLOR_PAIR(change_color_pair));
+                                   ce_draw_color(color_defs, last_fg, last_bg);
                               }
                          }else if(rune == CE_TAB){
                               x += tab_width;
@@ -404,38 +472,38 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
                default:
                     break;
                case CE_VISUAL_LINE_DISPLAY_TYPE_FULL_LINE:
-                    for(; x <= col_max; x++) addch(' ');
+                    for(; x <= col_max; x++) ce_draw_rune(' ');
                     break;
                case CE_VISUAL_LINE_DISPLAY_TYPE_INCLUDE_NEWLINE:
-                    addch(' ');
+                    ce_draw_rune(' ');
                     x++;
                // intentional fall through
                case CE_VISUAL_LINE_DISPLAY_TYPE_EXCLUDE_NEWLINE:
-                    standend();
+                    ce_draw_standend();
                     if(!view->buffer->no_highlight_current_line && real_y == view->cursor.y){
                          int bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_CURRENT_LINE, COLOR_DEFAULT);
-                         int change_color_pair = ce_color_def_get(color_defs, COLOR_DEFAULT, bg);
-                         attron(COLOR_PAIR(change_color_pair));
+                         ce_draw_color(color_defs, COLOR_DEFAULT, bg);
                     }
-                    for(; x <= col_max; x++) addch(' ');
+                    for(; x <= col_max; x++) ce_draw_rune(' ');
                     break;
                }
           }
      }else{
-          standend();
+          ce_draw_standend();
      }
+
+     free(visible_cursors);
 }
 
 void draw_view_status(CeView_t* view, CeVim_t* vim, CeMacros_t* macros, CeMultipleCursors_t* multiple_cursors,
-                      CeColorDefs_t* color_defs, int64_t height_offset, int ui_fg_color, int ui_bg_color){
+                      CeColorDefs_t* color_defs, int64_t height_offset, int ui_fg_color, int ui_bg_color, CePerf_t* perf){
      // create bottom bar bg
      int64_t bottom = view->rect.bottom + height_offset;
-     int color_pair = ce_color_def_get(color_defs, ui_fg_color, ui_bg_color);
-     attron(COLOR_PAIR(color_pair));
+     ce_draw_color(color_defs, ui_fg_color, ui_bg_color);
      int64_t width = (view->rect.right - view->rect.left) + 1;
-     move(bottom, view->rect.left);
+     ce_draw_move(bottom, view->rect.left);
      for(int64_t i = 0; i < width; ++i){
-          addch(' ');
+          ce_draw_rune(' ');
      }
 
      // set the mode line
@@ -474,58 +542,87 @@ void draw_view_status(CeView_t* view, CeVim_t* vim, CeMacros_t* macros, CeMultip
      }
 
      if(vim_mode_string){
-          color_pair = ce_color_def_get(color_defs, vim_mode_fg, ui_bg_color);
-          attron(COLOR_PAIR(color_pair));
-          mvprintw(bottom, view->rect.left + 1, "%s", vim_mode_string);
+          ce_draw_color(color_defs, vim_mode_fg, ui_bg_color);
+          ce_draw_move(bottom, view->rect.left + 1);
+          ce_draw_printf("%s", vim_mode_string);
 
-          color_pair = ce_color_def_get(color_defs, ui_fg_color, ui_bg_color);
-          attron(COLOR_PAIR(color_pair));
-          printw(" %s", view->buffer->name);
+          ce_draw_color(color_defs, ui_fg_color, ui_bg_color);
+          ce_draw_printf(" %s", view->buffer->name);
      }else{
-          color_pair = ce_color_def_get(color_defs, ui_fg_color, ui_bg_color);
-          attron(COLOR_PAIR(color_pair));
-          mvprintw(bottom, view->rect.left + 1, "%s", view->buffer->name);
+          ce_draw_color(color_defs, ui_fg_color, ui_bg_color);
+          ce_draw_move(bottom, view->rect.left + 1);
+          ce_draw_printf("%s", view->buffer->name);
      }
 
      const char* status_str = buffer_status_get_str(view->buffer->status);
-     if(status_str) printw(status_str);
+     if(status_str) ce_draw_string(status_str);
 
      if(vim_mode_string && ce_macros_is_recording(macros)){
-          printw(" RECORDING %c", macros->recording);
+          ce_draw_printf(" RECORDING %c", macros->recording);
      }
 
 #ifdef ENABLE_DEBUG_KEY_PRESS_INFO
-     if(vim_mode_string) printw(" %s %d ", keyname(g_last_key), g_last_key);
+     if(vim_mode_string) ce_draw_printf(" %s %d ", keyname(g_last_key), g_last_key);
 #endif
 
+     if(vim_mode_string && perf && perf->show_hud){
+          char hud_string[128];
+          ce_perf_hud_string(perf, hud_string, sizeof(hud_string));
+          ce_draw_printf(" %s", hud_string);
+     }
+
      char cursor_pos_string[32];
      int64_t cursor_pos_string_len = snprintf(cursor_pos_string, 32, "%ld, %ld", view->cursor.x + 1, view->cursor.y + 1);
-     mvprintw(bottom, view->rect.right - (cursor_pos_string_len + 1), "%s", cursor_pos_string);
+     ce_draw_move(bottom, view->rect.right - (cursor_pos_string_len + 1));
+     ce_draw_printf("%s", cursor_pos_string);
 
      if(multiple_cursors && multiple_cursors->count){
           if(multiple_cursors->active){
-               color_pair = ce_color_def_get(color_defs, COLOR_GREEN, ui_bg_color);
+               ce_draw_color(color_defs, COLOR_GREEN, ui_bg_color);
           }else{
-               color_pair = ce_color_def_get(color_defs, COLOR_RED, ui_bg_color);
+               ce_draw_color(color_defs, COLOR_RED, ui_bg_color);
           }
 
-          attron(COLOR_PAIR(color_pair));
-
           int64_t multiple_cursor_string_len = snprintf(cursor_pos_string, 32, "(%ld)", multiple_cursors->count);
-          mvprintw(bottom, view->rect.right - (cursor_pos_string_len + 1) - (multiple_cursor_string_len + 1), "%s", cursor_pos_string);
+          ce_draw_move(bottom, view->rect.right - (cursor_pos_string_len + 1) - (multiple_cursor_string_len + 1));
+          ce_draw_printf("%s", cursor_pos_string);
      }
 }
 
-void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, CeMacros_t* macros,
+static bool view_needs_draw(CeView_t* view){
+     CeAppViewData_t* view_data = view->user_data;
+     CeAppBufferData_t* buffer_data = view->buffer->app_data;
+     int64_t syntax_generation = buffer_data ? buffer_data->syntax_span_cache.generation : 0;
+     CeViewDrawState_t state = {view->buffer, view->buffer->version, view->cursor, view->scroll, view->rect, syntax_generation};
+     CeViewDrawState_t* last = &view_data->draw_state;
+     bool changed = (last->buffer != state.buffer ||
+                     last->buffer_version != state.buffer_version ||
+                     !ce_points_equal(last->cursor, state.cursor) ||
+                     !ce_points_equal(last->scroll, state.scroll) ||
+                     memcmp(&last->rect, &state.rect, sizeof(state.rect)) != 0 ||
+                     last->syntax_generation != state.syntax_generation);
+     *last = state;
+     return changed;
+}
+
+// returns whether any view was drawn, when redraw_all is false views that haven't changed since they were last drawn are skipped
+bool draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, CeMacros_t* macros,
                  CeBuffer_t* input_buffer, CeColorDefs_t* color_defs, int64_t tab_width, CeLineNumber_t line_number,
                  CeVisualLineDisplayType_t visual_line_display_type, CeMultipleCursors_t* multiple_cursors,
                  CeLayout_t* current, CeSyntaxDef_t* syntax_defs, int64_t terminal_width, bool highlight_search,
-                 int ui_fg_color, int ui_bg_color, CeRune_t show_line_extends_passed_view_as){
+                 int ui_fg_color, int ui_bg_color, CeRune_t show_line_extends_passed_view_as, bool redraw_all,
+                 CePerf_t* perf){
+     bool drew = false;
      switch(layout->type){
      default:
           break;
      case CE_LAYOUT_TYPE_VIEW:
      {
+          // always update the draw state so it is current after a full redraw
+          bool view_changed = view_needs_draw(&layout->view);
+          if(!redraw_all && !view_changed) break;
+          drew = true;
+
           CeDrawColorList_t draw_color_list = {};
           CeAppBufferData_t* buffer_data = layout->view.buffer->app_data;
 
@@ -628,61 +725,34 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                     }
 
                     if(pattern){
-                         int64_t pattern_len = ce_utf8_strlen(pattern);
                          int64_t min = layout->view.scroll.y;
                          int64_t max = min + (layout->view.rect.bottom - layout->view.rect.top);
                          int64_t clamp_max = (layout->view.buffer->line_count - 1);
                          CE_CLAMP(min, 0, clamp_max);
                          CE_CLAMP(max, 0, clamp_max);
 
-                         if(vim->search_mode == CE_VIM_SEARCH_MODE_FORWARD ||
-                            vim->search_mode == CE_VIM_SEARCH_MODE_BACKWARD){
-                              for(int64_t i = min; i <= max; i++){
-                                   char* match = NULL;
-                                   char* itr = layout->view.buffer->lines[i];
-                                   while((match = strstr(itr, pattern))){
-                                        CePoint_t start = {ce_utf8_strlen_between(layout->view.buffer->lines[i], match) - 1, i};
-                                        CePoint_t end = {start.x + (pattern_len - 1), i};
-                                        ce_range_list_insert(&range_list, start, end);
-                                        itr = match + pattern_len;
-                                   }
-                              }
-                         }else if(vim->search_mode == CE_VIM_SEARCH_MODE_REGEX_FORWARD ||
-                                  vim->search_mode == CE_VIM_SEARCH_MODE_REGEX_BACKWARD){
-                              regex_t regex = {};
-                              int rc = regcomp(&regex, pattern, REG_EXTENDED);
-                              if(rc == 0){
-                                   const size_t match_count = 1;
-                                   regmatch_t matches[match_count];
-
-                                   for(int64_t i = min; i <= max; i++){
-                                        char* itr = layout->view.buffer->lines[i];
-                                        int64_t prev_end_x = 0;
-                                        while(itr){
-                                             rc = regexec(&regex, itr, match_count, matches, 0);
-                                             if(rc == 0){
-                                                  int64_t match_len = matches[0].rm_eo - matches[0].rm_so;
-                                                  if(match_len > 0){
-                                                       CePoint_t start = {prev_end_x + matches[0].rm_so, i};
-                                                       CePoint_t end = {start.x + (match_len - 1), i};
-                                                       ce_range_list_insert(&range_list, start, end);
-                                                       itr = ce_utf8_iterate_to(itr, matches[0].rm_so + match_len);
-                                                       prev_end_x = end.x + 1;
-                                                  }else{
-                                                       break;
-                                                  }
-                                             }else{
-                                                  break;
-                                             }
-                                        }
-                                   }
-                              }
-                         }
+                         uint64_t search_start = ce_perf_now_usec();
+                         ce_search_highlight_cache_apply(&buffer_data->search_highlight_cache, layout->view.buffer, pattern,
+                                                         vim->search_mode, min, max, &range_list);
+                         ce_perf_record_since(perf, CE_PERF_PHASE_SEARCH_HIGHLIGHT, search_start);
                     }
                }
 
-               buffer_data->syntax_function(&layout->view, &range_list, &draw_color_list, syntax_defs,
-                                            layout->view.buffer->syntax_data);
+               uint64_t syntax_start = ce_perf_now_usec();
+               if(ce_syntax_worker_can_highlight(buffer_data->syntax_function)){
+                    CeSyntaxSpanCache_t* syntax_span_cache = &buffer_data->syntax_span_cache;
+                    ce_syntax_worker_prepare(syntax_span_cache, &layout->view, buffer_data->syntax_function,
+                                             layout->view.buffer->syntax_data);
+                    ce_syntax_highlight_spans(&layout->view, &range_list, &draw_color_list, syntax_defs, syntax_span_cache);
+
+                    // whatever the worker finished while we waited is already on screen
+                    CeAppViewData_t* view_data = layout->view.user_data;
+                    view_data->draw_state.syntax_generation = syntax_span_cache->generation;
+               }else{
+                    buffer_data->syntax_function(&layout->view, &range_list, &draw_color_list, syntax_defs,
+                                                 layout->view.buffer->syntax_data);
+               }
+               ce_perf_record_since(perf, CE_PERF_PHASE_SYNTAX, syntax_start);
                ce_range_list_free(&range_list);
           }
 
@@ -690,29 +760,33 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                     terminal_width, show_line_extends_passed_view_as);
           ce_draw_color_list_free(&draw_color_list);
           draw_view_status(&layout->view, layout == current ? vim : NULL, macros, multiple_cursors, color_defs, 0,
-                           ui_fg_color, ui_bg_color);
+                           ui_fg_color, ui_bg_color, layout == current ? perf : NULL);
           int64_t rect_height = layout->view.rect.bottom - layout->view.rect.top;
-          int color_pair = ce_color_def_get(color_defs, ui_fg_color, ui_bg_color);
-          attron(COLOR_PAIR(color_pair));
+          ce_draw_color(color_defs, ui_fg_color, ui_bg_color);
           if(layout->view.rect.right < (terminal_width - 1)){
                for(int i = 0; i < rect_height; i++){
-                    mvaddch(layout->view.rect.top + i, layout->view.rect.right, ' ');
+                    ce_draw_move(layout->view.rect.top + i, layout->view.rect.right);
+                    ce_draw_rune(' ');
                }
           }
      } break;
      case CE_LAYOUT_TYPE_LIST:
           for(int64_t i = 0; i < layout->list.layout_count; i++){
-               draw_layout(layout->list.layouts[i], vim, visual, macros, input_buffer, color_defs, tab_width,
-                           line_number, visual_line_display_type, multiple_cursors, current, syntax_defs, terminal_width, highlight_search,
-                           ui_fg_color, ui_bg_color, show_line_extends_passed_view_as);
+               if(draw_layout(layout->list.layouts[i], vim, visual, macros, input_buffer, color_defs, tab_width,
+                              line_number, visual_line_display_type, multiple_cursors, current, syntax_defs, terminal_width, highlight_search,
+                              ui_fg_color, ui_bg_color, show_line_extends_passed_view_as, redraw_all, perf)){
+                    drew = true;
+               }
           }
           break;
      case CE_LAYOUT_TYPE_TAB:
-          draw_layout(layout->tab.root, vim, visual, macros, input_buffer, color_defs, tab_width, line_number,
-                      visual_line_display_type, multiple_cursors, current, syntax_defs, terminal_width, highlight_search, ui_fg_color, ui_bg_color,
-                      show_line_extends_passed_view_as);
+          drew = draw_layout(layout->tab.root, vim, visual, macros, input_buffer, color_defs, tab_width, line_number,
+                             visual_line_display_type, multiple_cursors, current, syntax_defs, terminal_width, highlight_search, ui_fg_color,
+                             ui_bg_color, show_line_extends_passed_view_as, redraw_all, perf);
           break;
      }
+
+     return drew;
 }
 
 uint64_t time_between(struct timeval previous, struct timeval current){
@@ -720,8 +794,16 @@ uint64_t time_between(struct timeval previous, struct timeval current){
             (current.tv_usec - previous.tv_usec);
 }
 
-void draw(CeApp_t* app){
-     CeColorDefs_t color_defs = {};
+// when redraw_all is false, only views whose buffer, cursor, scroll or rect changed are repainted, and if none did
+// nothing is drawn at all
+// returns whether anything was drawn
+bool draw(CeApp_t* app, bool redraw_all){
+     ce_syntax_worker_install_results();
+     ce_syntax_worker_begin_frame(APP_SYNTAX_WORKER_WAIT_USEC);
+
+     CeColorDefs_t* color_defs = &app->color_defs;
+     ce_color_defs_begin_frame(color_defs, redraw_all);
+     ce_draw_begin_frame(app->terminal_width, app->terminal_height);
 
      CeLayout_t* tab_list_layout = app->tab_list_layout;
      CeLayout_t* tab_layout = tab_list_layout->tab_list.current;
@@ -729,53 +811,55 @@ void draw(CeApp_t* app){
      CeView_t* view = &tab_layout->tab.current->view;
 
      // draw a tab bar if there is more than 1 tab
-     if(tab_list_layout->tab_list.tab_count > 1){
-          move(0, 0);
-          int color_pair = ce_color_def_get(&color_defs, app->config_options.ui_fg_color, app->config_options.ui_bg_color);
-          attron(COLOR_PAIR(color_pair));
+     if(redraw_all && tab_list_layout->tab_list.tab_count > 1){
+          ce_draw_move(0, 0);
+          ce_draw_color(color_defs, app->config_options.ui_fg_color, app->config_options.ui_bg_color);
           for(int64_t i = tab_list_layout->tab_list.rect.left; i <= tab_list_layout->tab_list.rect.right; i++){
-               addch(' ');
+               ce_draw_rune(' ');
           }
 
-          move(0, 0);
+          ce_draw_move(0, 0);
 
           for(int64_t i = 0; i < tab_list_layout->tab_list.tab_count; i++){
                if(tab_list_layout->tab_list.tabs[i] == tab_list_layout->tab_list.current){
-                    color_pair = ce_color_def_get(&color_defs, COLOR_DEFAULT, COLOR_DEFAULT);
-                    attron(COLOR_PAIR(color_pair));
+                    ce_draw_color(color_defs, COLOR_DEFAULT, COLOR_DEFAULT);
                }else{
-                    color_pair = ce_color_def_get(&color_defs, app->config_options.ui_fg_color, app->config_options.ui_bg_color);
-                    attron(COLOR_PAIR(color_pair));
+                    ce_draw_color(color_defs, app->config_options.ui_fg_color, app->config_options.ui_bg_color);
                }
 
                if(tab_list_layout->tab_list.tabs[i]->tab.current->type == CE_LAYOUT_TYPE_VIEW){
                     const char* buffer_name = tab_list_layout->tab_list.tabs[i]->tab.current->view.buffer->name;
 
-                    printw(" %s ", buffer_name);
+                    ce_draw_printf(" %s ", buffer_name);
                }else{
-                    printw(" selection ");
+                    ce_draw_printf(" selection ");
                }
           }
      }
 
-     standend();
-     draw_layout(tab_layout, &app->vim, &app->visual, &app->macros, app->input_view.buffer, &color_defs,
-                 app->config_options.tab_width, app->config_options.line_number, app->config_options.visual_line_display_type,
-                 &app->multiple_cursors, tab_layout->tab.current, app->syntax_defs, tab_list_layout->tab_list.rect.right,
-                 app->highlight_search, app->config_options.ui_fg_color, app->config_options.ui_bg_color,
-                 app->config_options.show_line_extends_passed_view_as);
+     ce_draw_standend();
+     uint64_t draw_layout_start = ce_perf_now_usec();
+     bool drew = draw_layout(tab_layout, &app->vim, &app->visual, &app->macros, app->input_view.buffer, color_defs,
+                             app->config_options.tab_width, app->config_options.line_number, app->config_options.visual_line_display_type,
+                             &app->multiple_cursors, tab_layout->tab.current, app->syntax_defs, tab_list_layout->tab_list.rect.right,
+                             app->highlight_search, app->config_options.ui_fg_color, app->config_options.ui_bg_color,
+                             app->config_options.show_line_extends_passed_view_as, redraw_all, &app->perf);
+     ce_perf_record_since(&app->perf, CE_PERF_PHASE_DRAW_LAYOUT, draw_layout_start);
+     if(!redraw_all && !drew) return false;
+
+     // the overlays below may sit on top of views we just repainted, so always draw them again
 
      if(app->input_complete_func){
           CeDrawColorList_t draw_color_list = {};
           draw_view(&app->input_view, app->config_options.tab_width, app->config_options.line_number,
-                    app->config_options.visual_line_display_type, NULL, &draw_color_list, &color_defs, app->syntax_defs,
+                    app->config_options.visual_line_display_type, NULL, &draw_color_list, color_defs, app->syntax_defs,
                     app->terminal_rect.right, app->config_options.show_line_extends_passed_view_as);
           ce_draw_color_list_free(&draw_color_list);
           int64_t new_status_bar_offset = (app->input_view.rect.bottom - app->input_view.rect.top) + 1;
-          draw_view_status(&app->input_view, &app->vim, &app->macros, &app->multiple_cursors, &color_defs, 0,
-                           app->config_options.ui_fg_color, app->config_options.ui_bg_color);
-          draw_view_status(&tab_layout->tab.current->view, NULL, &app->macros, &app->multiple_cursors, &color_defs,
-                           -new_status_bar_offset, app->config_options.ui_fg_color, app->config_options.ui_bg_color);
+          draw_view_status(&app->input_view, &app->vim, &app->macros, &app->multiple_cursors, color_defs, 0,
+                           app->config_options.ui_fg_color, app->config_options.ui_bg_color, &app->perf);
+          draw_view_status(&tab_layout->tab.current->view, NULL, &app->macros, &app->multiple_cursors, color_defs,
+                           -new_status_bar_offset, app->config_options.ui_fg_color, app->config_options.ui_bg_color, NULL);
      }
 
      CeComplete_t* complete = ce_app_is_completing(app);
@@ -806,18 +890,20 @@ void draw(CeApp_t* app){
           CeDrawColorList_t draw_color_list = {};
           CeRangeList_t range_list = {};
           CeAppBufferData_t* buffer_data = app->complete_view.buffer->app_data;
+          uint64_t syntax_start = ce_perf_now_usec();
           buffer_data->syntax_function(&app->complete_view, &range_list, &draw_color_list, app->syntax_defs,
                                        app->complete_view.buffer->syntax_data);
+          ce_perf_record_since(&app->perf, CE_PERF_PHASE_SYNTAX, syntax_start);
           ce_range_list_free(&range_list);
           draw_view(&app->complete_view, app->config_options.tab_width, app->config_options.line_number,
-                    app->config_options.visual_line_display_type, NULL, &draw_color_list, &color_defs, app->syntax_defs,
+                    app->config_options.visual_line_display_type, NULL, &draw_color_list, color_defs, app->syntax_defs,
                     app->terminal_rect.right, app->config_options.show_line_extends_passed_view_as);
           ce_draw_color_list_free(&draw_color_list);
           if(app->input_complete_func){
                int64_t new_status_bar_offset = (app->complete_view.rect.bottom - app->complete_view.rect.top) + 1 + app->input_view.buffer->line_count;
                draw_view_status(&tab_layout->tab.current->view, NULL, &app->macros, &app->multiple_cursors,
-                                &color_defs, -new_status_bar_offset, app->config_options.ui_fg_color,
-                                app->config_options.ui_bg_color);
+                                color_defs, -new_status_bar_offset, app->config_options.ui_fg_color,
+                                app->config_options.ui_bg_color, NULL);
           }
      }
 
@@ -825,23 +911,24 @@ void draw(CeApp_t* app){
           CeDrawColorList_t draw_color_list = {};
           CeRangeList_t range_list = {};
           CeAppBufferData_t* buffer_data = app->message_view.buffer->app_data;
+          uint64_t syntax_start = ce_perf_now_usec();
           buffer_data->syntax_function(&app->message_view, &range_list, &draw_color_list, app->syntax_defs,
                                        app->message_view.buffer->syntax_data);
+          ce_perf_record_since(&app->perf, CE_PERF_PHASE_SYNTAX, syntax_start);
           ce_range_list_free(&range_list);
 
           draw_view(&app->message_view, app->config_options.tab_width, app->config_options.line_number,
-                    app->config_options.visual_line_display_type, NULL, &draw_color_list, &color_defs, app->syntax_defs,
+                    app->config_options.visual_line_display_type, NULL, &draw_color_list, color_defs, app->syntax_defs,
                     app->terminal_rect.right, app->config_options.show_line_extends_passed_view_as);
           ce_draw_color_list_free(&draw_color_list);
 
           // set the specified background
           int message_len = ce_utf8_strlen(app->message_view.buffer->lines[0]);
-          int color_pair = ce_color_def_get(&color_defs, app->config_options.message_fg_color, app->config_options.message_bg_color);
-          attron(COLOR_PAIR(color_pair));
+          ce_draw_color(color_defs, app->config_options.message_fg_color, app->config_options.message_bg_color);
           int64_t view_width = ce_view_width(&app->message_view);
-          move(app->message_view.rect.top, app->message_view.rect.left + message_len);
+          ce_draw_move(app->message_view.rect.top, app->message_view.rect.left + message_len);
           for(int i = message_len; i < view_width; i++){
-               addch(' ');
+               ce_draw_rune(' ');
           }
 
      }
@@ -866,43 +953,43 @@ void draw(CeApp_t* app){
                break;
           }
 
-          int color_pair = ce_color_def_get(&color_defs, COLOR_BRIGHT_WHITE, COLOR_BRIGHT_WHITE);
-          attron(COLOR_PAIR(color_pair));
+          ce_draw_color(color_defs, COLOR_BRIGHT_WHITE, COLOR_BRIGHT_WHITE);
           for(int i = 0; i < rect_height; i++){
-               mvaddch(rect->top + i, rect->right, ' ');
-               mvaddch(rect->top + i, rect->left, ' ');
+               ce_draw_move(rect->top + i, rect->right);
+               ce_draw_rune(' ');
+               ce_draw_move(rect->top + i, rect->left);
+               ce_draw_rune(' ');
           }
 
           for(int i = 0; i < rect_width; i++){
-               mvaddch(rect->top, rect->left + i, ' ');
-               mvaddch(rect->bottom, rect->left + i, ' ');
+               ce_draw_move(rect->top, rect->left + i);
+               ce_draw_rune(' ');
+               ce_draw_move(rect->bottom, rect->left + i);
+               ce_draw_rune(' ');
           }
 
-          mvaddch(rect->bottom, rect->right, ' ');
+          ce_draw_move(rect->bottom, rect->right);
+          ce_draw_rune(' ');
 
-          move(0, 0);
+          ce_draw_move(0, 0);
      }else if(app->input_complete_func){
           CePoint_t screen_cursor = view_cursor_on_screen(&app->input_view, app->config_options.tab_width,
                                                           app->config_options.line_number);
-          move(screen_cursor.y, screen_cursor.x);
+          ce_draw_move(screen_cursor.y, screen_cursor.x);
      }else{
           CePoint_t screen_cursor = view_cursor_on_screen(view, app->config_options.tab_width,
                                                           app->config_options.line_number);
-          move(screen_cursor.y, screen_cursor.x);
+          ce_draw_move(screen_cursor.y, screen_cursor.x);
      }
 
-     refresh();
-}
-
-static int int_strneq(int* a, int* b, size_t len){
-     for(size_t i = 0; i < len; ++i){
-          if(!*a) return false;
-          if(!*b) return false;
-          if(*a != *b) return false;
-          a++;
-          b++;
+     // a color pair still used by a view we skipped was redefined, repaint everything so it shows the right colors
+     if(color_defs->evicted_pair_on_screen){
+          return draw(app, true);
      }
 
+     uint64_t refresh_start = ce_perf_now_usec();
+     ce_draw_present();
+     ce_perf_record_since(&app->perf, CE_PERF_PHASE_REFRESH, refresh_start);
      return true;
 }
 
@@ -940,6 +1027,154 @@ bool handle_input_history_key(int key, CeHistory_t* history, CeBuffer_t* input_b
      return false;
 }
 
+void app_handle_key(CeApp_t* app, CeView_t* view, int key);
+
+// chain every change made after start onto the one before it, so a single undo takes them all back. if the changes
+// were undone past start, there is nothing of ours left to chain
+static void chain_changes_since(CeBuffer_t* buffer, CeBufferChangeNode_t* start){
+     CeBufferChangeNode_t* itr = buffer->change_node;
+     while(itr && itr != start) itr = itr->prev;
+     if(!itr || !start->next) return;
+
+     for(itr = buffer->change_node; itr != start->next; itr = itr->prev){
+          itr->change.chain = true;
+     }
+}
+
+// run the macro's keys back to back. nothing draws until the whole replay is done, the edits to the buffer it started
+// in undo as one, and like vim, it stops at the first motion or search that fails
+static void app_replay_macro(CeApp_t* app, CeView_t* view, char reg, CeRuneArray_t* macro, int64_t multiplier){
+     uint64_t start_usec = ce_perf_now_usec();
+     CeBuffer_t* buffer = view ? view->buffer : NULL;
+     CeBufferChangeNode_t* start_change = buffer ? buffer->change_node : NULL;
+     int64_t key_count = 0;
+     int64_t run = 0;
+     bool failed = false;
+
+     // the keys are read straight out of the register, so nothing may record into it until we are done
+     if(!macro->count) return;
+     bool* replaying = app->macros.replaying + (reg - '!');
+     bool was_replaying = *replaying;
+     *replaying = true;
+
+     for(; run < multiplier && !failed; run++){
+          for(int64_t k = 0; k < macro->count; k++){
+               app->vim.motion_failed = false;
+               app_handle_key(app, view, macro->runes[k]);
+               key_count++;
+
+               if(app->vim.motion_failed){
+                    failed = true;
+                    break;
+               }
+
+               // commands in the macro can move us to another view
+               CeLayout_t* tab_layout = app->tab_list_layout->tab_list.current;
+               if(tab_layout->tab.current->type == CE_LAYOUT_TYPE_VIEW){
+                    view = &tab_layout->tab.current->view;
+               }
+          }
+     }
+
+     *replaying = was_replaying;
+
+     // the macro may have closed the buffer it started in
+     for(CeBufferNode_t* itr = app->buffer_node_head; itr && start_change; itr = itr->next){
+          if(itr->buffer == buffer){
+               chain_changes_since(buffer, start_change);
+               break;
+          }
+     }
+
+     uint64_t elapsed_usec = ce_perf_now_usec() - start_usec;
+     ce_perf_record(&app->perf, CE_PERF_PHASE_MACRO_REPLAY, elapsed_usec);
+
+     double keys_per_second = elapsed_usec ? ((double)(key_count) * 1000000.0) / (double)(elapsed_usec) : 0.0;
+     if(failed){
+          ce_app_message(app, "@%c stopped on run %ld of %ld after %ld keys (%.0f keys/s)", reg, run, multiplier,
+                         key_count, keys_per_second);
+     }else if(multiplier > 1){
+          ce_app_message(app, "@%c replayed %ld keys in %" PRIu64 " us (%.0f keys/s)", reg, key_count, elapsed_usec,
+                         keys_per_second);
+     }
+}
+
+// type a plain character at the primary and every secondary cursor in one pass over the buffer, rather than running
+// the key through vim once per cursor. returns false when the key needs the general per cursor path
+static bool app_insert_at_multiple_cursors(CeApp_t* app, CeView_t* view, int key){
+     if(app->vim.mode != CE_VIM_MODE_INSERT) return false;
+     if(view->buffer->status == CE_BUFFER_STATUS_READONLY) return false;
+
+     // newlines and '}' indent each line on their own, so they still go through vim one cursor at a time
+     char str[64] = {};
+     int64_t remove_offset = 0;
+     if(key == KEY_BACKSPACE){
+          remove_offset = -1;
+     }else if(key == KEY_DC){
+          remove_offset = 0;
+     }else if(key == CE_TAB){
+          if(app->config_options.insert_spaces_on_tab && !app->vim.pasting){
+               if(app->config_options.tab_width >= (int64_t)(sizeof(str))) return false;
+               memset(str, ' ', app->config_options.tab_width);
+          }else{
+               str[0] = key;
+          }
+     }else if(key >= ' ' && key <= '~' && key != '}'){
+          str[0] = key;
+     }else{
+          return false;
+     }
+
+     CeMultipleCursors_t* multiple_cursors = &app->multiple_cursors;
+     ce_multiple_cursors_sort(multiple_cursors);
+
+     // merge the primary cursor into the sorted secondary cursors
+     int64_t primary_index = 0;
+     while(primary_index < multiple_cursors->count &&
+           ce_point_after(view->cursor, multiple_cursors->cursors[primary_index])){
+          primary_index++;
+     }
+
+     int64_t point_count = multiple_cursors->count + 1;
+     CePoint_t* points = malloc(point_count * sizeof(*points));
+     if(!points) return false;
+     memcpy(points, multiple_cursors->cursors, primary_index * sizeof(*points));
+     points[primary_index] = view->cursor;
+     memcpy(points + primary_index + 1, multiple_cursors->cursors + primary_index,
+            (multiple_cursors->count - primary_index) * sizeof(*points));
+
+     bool success = false;
+     if(key == KEY_BACKSPACE || key == KEY_DC){
+          // joining lines moves the cursors after them, leave that to the one at a time path
+          success = true;
+          for(int64_t i = 0; i < point_count && success; i++){
+               points[i].x += remove_offset;
+               if(points[i].x < 0) success = false;
+          }
+          success = success && ce_buffer_remove_string_change_at_points(view->buffer, points, point_count, 1,
+                                                                         app->vim.chain_undo);
+     }else{
+          success = ce_buffer_insert_string_change_at_points(view->buffer, str, points, point_count, app->vim.chain_undo);
+     }
+
+     if(!success){
+          free(points);
+          return false;
+     }
+
+     memcpy(multiple_cursors->cursors, points, primary_index * sizeof(*points));
+     view->cursor = points[primary_index];
+     memcpy(multiple_cursors->cursors + primary_index, points + primary_index + 1,
+            (multiple_cursors->count - primary_index) * sizeof(*points));
+     free(points);
+
+     // keep vim's insert state the same as if the key went through it
+     app->vim.chain_undo = true;
+     if(!app->vim.verb_last_action) ce_rune_array_append(&app->vim.insert_runes, key);
+     app->last_vim_handle_result = CE_VIM_PARSE_COMPLETE;
+     return true;
+}
+
 void app_handle_key(CeApp_t* app, CeView_t* view, int key){
      if(key == ERR) return;
 
@@ -954,7 +1189,9 @@ void app_handle_key(CeApp_t* app, CeView_t* view, int key){
           if(end) app->macro_multiplier = parsed_multiplier;
      }
 
-     if(key == '.' && app->last_macro_register){
+     // replaying the register being recorded would record onto itself forever
+     if(key == '.' && app->last_macro_register &&
+        !(ce_macros_is_recording(&app->macros) && app->macros.recording == app->last_macro_register)){
           app->macro_multiplier = app->last_macro_multiplier;
           app->replay_macro = true;
           key = app->last_macro_register;
@@ -984,34 +1221,26 @@ void app_handle_key(CeApp_t* app, CeView_t* view, int key){
           }
 
           if(app->record_macro && !ce_macros_is_recording(&app->macros)){
-               ce_macros_begin_recording(&app->macros, key);
+               if(key >= '!' && key < '!' + CE_ASCII_PRINTABLE_CHARACTERS && app->macros.replaying[key - '!']){
+                    ce_app_message(app, "unable to record into register '%c' while it is being replayed", key);
+                    app->record_macro = false;
+               }else{
+                    ce_macros_begin_recording(&app->macros, key);
+               }
                app->macro_multiplier = 1;
                return;
           }
 
           if(app->replay_macro){
                app->replay_macro = false;
-               CeRune_t* rune_string = ce_macros_get_register_string(&app->macros, key);
-               if(rune_string){
-                    for(int64_t i = 0; i < app->macro_multiplier; i++){
-                         CeRune_t* itr = rune_string;
-                         while(*itr){
-                              app_handle_key(app, view, *itr);
-
-                              // update the view if it has changed
-                              CeLayout_t* tab_layout = app->tab_list_layout->tab_list.current;
-                              if(tab_layout->tab.current->type == CE_LAYOUT_TYPE_VIEW){
-                                   view = &tab_layout->tab.current->view;
-                              }
-                              itr++;
-                         }
-                    }
+               CeRuneArray_t* macro = ce_macros_get_register(&app->macros, key);
+               if(macro){
+                    app_replay_macro(app, view, key, macro, app->macro_multiplier);
                     app->last_macro_register = key;
                     app->last_macro_multiplier = app->macro_multiplier;
                     app->macro_multiplier = 1;
                }
 
-               free(rune_string);
                return;
           }
      }
@@ -1031,52 +1260,38 @@ void app_handle_key(CeApp_t* app, CeView_t* view, int key){
                app->keys[app->key_count] = key;
                app->key_count++;
 
-               bool no_matches = true;
-               for(int64_t i = 0; i < app->key_binds.count; ++i){
-                    if(int_strneq(app->key_binds.binds[i].keys, app->keys, app->key_count)){
-                         no_matches = false;
-                         // if we have matches, but don't completely match, then wait for more keypresses,
-                         // otherwise, execute the action
-                         if(app->key_binds.binds[i].key_count == app->key_count){
-                              CeCommand_t* command = &app->key_binds.binds[i].command;
-                              CeCommandFunc_t* command_func = NULL;
-                              CeCommandEntry_t* entry = NULL;
-                              for(int64_t c = 0; c < app->command_entry_count; ++c){
-                                   entry = app->command_entries + c;
-                                   if(strcmp(entry->name, command->name) == 0){
-                                        command_func = entry->func;
-                                        break;
-                                   }
-                              }
+               // if we have matches, but don't completely match, then wait for more keypresses,
+               // otherwise, execute the action
+               CeKeyBindNode_t* node = ce_key_binds_find(&app->key_binds, app->keys, app->key_count);
+               bool no_matches = (node == NULL);
+               if(node){
+                    if(node->bind_index < 0 || node->bind_index != node->first_bind_index) return;
 
-                              if(command_func){
-                                   CeCommandStatus_t cs = command_func(command, app);
-
-                                   app->key_count = 0;
-                                   app->vim.current_command[0] = 0;
-
-                                   switch(cs){
-                                   default:
-                                        return;
-                                   case CE_COMMAND_NO_ACTION:
-                                        break;
-                                   case CE_COMMAND_FAILURE:
-                                        ce_log("'%s' failed\n", entry->name);
-                                        return;
-                                   case CE_COMMAND_PRINT_HELP:
-                                        ce_app_message(app, "%s: %s\n", entry->name, entry->description);
-                                        return;
-                                   }
-                              }else{
-                                   ce_app_message(app, "unknown command: '%s'", command->name);
-                              }
+                    CeKeyBind_t* bind = app->key_binds.binds + node->bind_index;
+                    CeCommandEntry_t* entry = ce_app_key_bind_command_entry(app, bind);
+                    if(entry){
+                         CeCommandStatus_t cs = entry->func(&bind->command, app);
+
+                         app->key_count = 0;
+                         app->vim.current_command[0] = 0;
 
-                              app->key_count = 0;
+                         switch(cs){
+                         default:
+                              return;
+                         case CE_COMMAND_NO_ACTION:
                               break;
-                         }else{
+                         case CE_COMMAND_FAILURE:
+                              ce_log("'%s' failed\n", entry->name);
+                              return;
+                         case CE_COMMAND_PRINT_HELP:
+                              ce_app_message(app, "%s: %s\n", entry->name, entry->description);
                               return;
                          }
+                    }else{
+                         ce_app_message(app, "unknown command: '%s'", bind->command.name);
                     }
+
+                    app->key_count = 0;
                }
 
                if(no_matches){
@@ -1135,14 +1350,12 @@ void app_handle_key(CeApp_t* app, CeView_t* view, int key){
                int64_t line = view->cursor.y;
                char* macro_string = NULL;
                for(int64_t i = 0; i < CE_ASCII_PRINTABLE_CHARACTERS; i++){
-                    CeRuneNode_t* rune_node = app->macros.rune_head[i];
-                    if(rune_node){
+                    CeRuneArray_t* macro = app->macros.registers + i;
+                    if(macro->count){
                          line -= 2;
                          if(line <= 2){
                               app->edit_register = i;
-                              CeRune_t* rune_string = ce_rune_node_string(rune_node);
-                              macro_string = ce_rune_string_to_char_string(rune_string);
-                              free(rune_string);
+                              macro_string = ce_rune_string_to_char_string(macro->runes);
                               break;
                          }
                     }
@@ -1217,6 +1430,7 @@ void app_handle_key(CeApp_t* app, CeView_t* view, int key){
                        itr->buffer == app->macro_list_buffer ||
                        itr->buffer == app->mark_list_buffer ||
                        itr->buffer == app->jump_list_buffer ||
+                       itr->buffer == app->perf_list_buffer ||
                        itr->buffer == app->shell_command_buffer ||
                        itr->buffer == g_ce_log_buffer ||
                        itr->buffer == app->message_view.buffer ||
@@ -1262,44 +1476,49 @@ void app_handle_key(CeApp_t* app, CeView_t* view, int key){
                // TODO: how are we going to let this be supported through customization
                CeAppBufferData_t* buffer_data = view->buffer->app_data;
 
-               if(app->multiple_cursors.active){
-                    int64_t save_motion_column = buffer_data->vim.motion_column;
+               bool batched = app->multiple_cursors.active && app_insert_at_multiple_cursors(app, view, key);
+               if(!batched){
+                    if(app->multiple_cursors.active){
+                         int64_t save_motion_column = buffer_data->vim.motion_column;
 
-                    for(int64_t i = 0; i < app->multiple_cursors.count; i++){
-                         CeBufferChangeNode_t* before_change_node = view->buffer->change_node;
+                         for(int64_t i = 0; i < app->multiple_cursors.count; i++){
+                              CeBufferChangeNode_t* before_change_node = view->buffer->change_node;
 
-                         CeVimMode_t save_vim_mode = app->vim.mode;
+                              CeVimMode_t save_vim_mode = app->vim.mode;
 
-                         buffer_data->vim.motion_column = app->multiple_cursors.motion_columns[i];
+                              buffer_data->vim.motion_column = app->multiple_cursors.motion_columns[i];
 
-                         ce_vim_handle_key(&app->vim, view, app->multiple_cursors.cursors + i,
-                                           app->multiple_cursors.visuals + i, key, &buffer_data->vim,
-                                           &app->config_options, false);
+                              ce_vim_handle_key(&app->vim, view, app->multiple_cursors.cursors + i,
+                                                app->multiple_cursors.visuals + i, key, &buffer_data->vim,
+                                                &app->config_options, false);
 
-                         app->multiple_cursors.motion_columns[i] = buffer_data->vim.motion_column;
+                              app->multiple_cursors.motion_columns[i] = buffer_data->vim.motion_column;
 
-                         app->vim.mode = save_vim_mode;
+                              app->vim.mode = save_vim_mode;
+
+                              for(int64_t j = 0; j < app->multiple_cursors.count; j++){
+                                   if(i == j) continue;
+                                   app->multiple_cursors.cursors[j] = ce_move_point_based_on_buffer_changes(view->buffer,
+                                                                                                            before_change_node,
+                                                                                                            app->multiple_cursors.cursors[j]);
+                              }
 
-                         for(int64_t j = 0; j < app->multiple_cursors.count; j++){
-                              if(i == j) continue;
-                              app->multiple_cursors.cursors[j] = ce_move_point_based_on_buffer_changes(view->buffer,
-                                                                                                       before_change_node,
-                                                                                                       app->multiple_cursors.cursors[j]);
+                              view->cursor = ce_move_point_based_on_buffer_changes(view->buffer, before_change_node, view->cursor);
                          }
 
-                         view->cursor = ce_move_point_based_on_buffer_changes(view->buffer, before_change_node, view->cursor);
+                         buffer_data->vim.motion_column = save_motion_column;
                     }
 
-                    buffer_data->vim.motion_column = save_motion_column;
-               }
+                    CeBufferChangeNode_t* before_change_node = view->buffer->change_node;
 
-               CeBufferChangeNode_t* before_change_node = view->buffer->change_node;
+                    app->last_vim_handle_result = ce_vim_handle_key(&app->vim, view, &view->cursor, &app->visual,
+                                                                    key, &buffer_data->vim, &app->config_options, true);
 
-               app->last_vim_handle_result = ce_vim_handle_key(&app->vim, view, &view->cursor, &app->visual,
-                                                               key, &buffer_data->vim, &app->config_options, true);
+                    for(int64_t j = 0; j < app->multiple_cursors.count; j++){
+                         app->multiple_cursors.cursors[j] = ce_move_point_based_on_buffer_changes(view->buffer, before_change_node, app->multiple_cursors.cursors[j]);
+                    }
 
-               for(int64_t j = 0; j < app->multiple_cursors.count; j++){
-                    app->multiple_cursors.cursors[j] = ce_move_point_based_on_buffer_changes(view->buffer, before_change_node, app->multiple_cursors.cursors[j]);
+                    ce_multiple_cursors_sort(&app->multiple_cursors);
                }
 
                // A "jump" is one of the following commands: "'", "`", "G", "/", "?", "n",
@@ -1326,6 +1545,14 @@ void app_handle_key(CeApp_t* app, CeView_t* view, int key){
                     }
                }
 
+               // vim's !{motion}, the lines are selected, so ask for the command to filter them through
+               if(app->last_vim_handle_result == CE_VIM_PARSE_COMPLETE &&
+                  app->vim.current_action.verb.function == ce_vim_verb_filter){
+                    ce_app_input(app, "Run Command", command_input_complete_func);
+                    ce_buffer_insert_string(app->input_view.buffer, "filter ", (CePoint_t){0, 0});
+                    app->input_view.cursor = (CePoint_t){7, 0};
+               }
+
                if(app->last_vim_handle_result == CE_VIM_PARSE_COMPLETE &&
                   app->vim.current_action.repeatable){
                     app->last_macro_register = 0;
@@ -1427,23 +1654,30 @@ void print_help(char* program){
      printf("usage  : %s [options] [file]\n", program);
      printf("options:\n");
      printf("  -c <config file> path to shared object configuration\n");
+     printf("  -t               draw with vt100 escape sequences instead of ncurses\n");
 }
 
 int main(int argc, char** argv){
      const char* config_filepath = NULL;
+     CeDrawBackend_t draw_backend = CE_DRAW_BACKEND_NCURSES;
      int last_arg_index = 0;
 
      // setup signal handler
      signal(SIGINT, handle_sigint);
+     // a filter command that exits before reading all of its input shouldn't take the editor down with it
+     signal(SIGPIPE, SIG_IGN);
 
      // parse args
      {
           char c;
-          while((c = getopt(argc, argv, "c:h")) != -1){
+          while((c = getopt(argc, argv, "c:th")) != -1){
                switch(c){
                case 'c':
                     config_filepath = optarg;
                     break;
+               case 't':
+                    draw_backend = CE_DRAW_BACKEND_VT100;
+                    break;
                case 'h':
                default:
                     print_help(argv[0]);
@@ -1487,6 +1721,15 @@ int main(int argc, char** argv){
           return 1;
      }
 
+     // a truncated path would load some other directory, so go without the syntax files instead
+     char syntax_dir[PATH_MAX];
+     int syntax_dir_len = snprintf(syntax_dir, PATH_MAX, "%s/syntax", ce_dir);
+     if(syntax_dir_len > 0 && syntax_dir_len < PATH_MAX){
+          ce_syntax_languages_load_directory(syntax_dir);
+     }else{
+          ce_log("syntax directory path under '%s' is too long, not loading syntax files\n", ce_dir);
+     }
+
      // init buffers
      {
           app.buffer_list_buffer = new_buffer();
@@ -1496,6 +1739,7 @@ int main(int argc, char** argv){
           app.macro_list_buffer = new_buffer();
           app.mark_list_buffer = new_buffer();
           app.jump_list_buffer = new_buffer();
+          app.perf_list_buffer = new_buffer();
           app.shell_command_buffer = new_buffer();
           CeBuffer_t* scratch_buffer = new_buffer();
 
@@ -1513,6 +1757,8 @@ int main(int argc, char** argv){
           ce_buffer_node_insert(&app.buffer_node_head, app.mark_list_buffer);
           ce_buffer_alloc(app.jump_list_buffer, 1, "[jumps]");
           ce_buffer_node_insert(&app.buffer_node_head, app.jump_list_buffer);
+          ce_buffer_alloc(app.perf_list_buffer, 1, "[perf]");
+          ce_buffer_node_insert(&app.buffer_node_head, app.perf_list_buffer);
           ce_buffer_alloc(app.shell_command_buffer, 1, "[shell command]");
           ce_buffer_node_insert(&app.buffer_node_head, app.shell_command_buffer);
           ce_buffer_alloc(scratch_buffer, 1, "scratch");
@@ -1525,6 +1771,7 @@ int main(int argc, char** argv){
           app.macro_list_buffer->status = CE_BUFFER_STATUS_NONE;
           app.mark_list_buffer->status = CE_BUFFER_STATUS_NONE;
           app.jump_list_buffer->status = CE_BUFFER_STATUS_NONE;
+          app.perf_list_buffer->status = CE_BUFFER_STATUS_NONE;
           app.shell_command_buffer->status = CE_BUFFER_STATUS_NONE;
           scratch_buffer->status = CE_BUFFER_STATUS_NONE;
 
@@ -1535,6 +1782,7 @@ int main(int argc, char** argv){
           app.macro_list_buffer->no_line_numbers = true;
           app.mark_list_buffer->no_line_numbers = true;
           app.jump_list_buffer->no_line_numbers = true;
+          app.perf_list_buffer->no_line_numbers = true;
           app.shell_command_buffer->no_line_numbers = true;
 
           app.complete_list_buffer->no_highlight_current_line = true;
@@ -1554,6 +1802,8 @@ int main(int argc, char** argv){
           buffer_data->syntax_function = ce_syntax_highlight_c;
           buffer_data = app.jump_list_buffer->app_data;
           buffer_data->syntax_function = ce_syntax_highlight_c;
+          buffer_data = app.perf_list_buffer->app_data;
+          buffer_data->syntax_function = ce_syntax_highlight_c;
           buffer_data = app.shell_command_buffer->app_data;
           buffer_data->syntax_function = ce_syntax_highlight_c;
           buffer_data = scratch_buffer->app_data;
@@ -1602,6 +1852,9 @@ int main(int argc, char** argv){
           define_key(NULL, KEY_ENTER);       // Blow away enter
           define_key("\x0D", KEY_ENTER);     // Enter       (13) (0x0D) ASCII "CR"  NL Carriage Return
           define_key("\x7F", KEY_BACKSPACE); // Backspace  (127) (0x7F) ASCII "DEL" Delete
+
+          // input still comes through curses, only drawing goes through the backend
+          ce_draw_init(draw_backend);
      }
 
      ce_app_init_default_commands(&app);
@@ -1637,6 +1890,7 @@ int main(int argc, char** argv){
      if(config_filepath){
           if(!user_config_init(&app.user_config, config_filepath)) return 1;
           app.user_config.init_func(&app);
+          ce_app_resolve_key_binds(&app);
      }else{
           // default config
 
@@ -1653,6 +1907,7 @@ int main(int argc, char** argv){
           config_options->cycle_next_completion_key = ce_ctrl_key('n');
           config_options->cycle_prev_completion_key = ce_ctrl_key('p');
           config_options->show_line_extends_passed_view_as = '>';
+          config_options->shell_command_redraw_fps = APP_DEFAULT_SHELL_COMMAND_REDRAW_FPS;
 
           // keybinds
           CeKeyBindDef_t normal_mode_bind_defs[] = {
@@ -1681,6 +1936,7 @@ int main(int argc, char** argv){
           };
 
           ce_convert_bind_defs(&app.key_binds, normal_mode_bind_defs, sizeof(normal_mode_bind_defs) / sizeof(normal_mode_bind_defs[0]));
+          ce_app_resolve_key_binds(&app);
 
           // syntax
           {
@@ -1743,11 +1999,18 @@ int main(int argc, char** argv){
 
      pipe(g_shell_command_ready_fds);
 
-     draw(&app);
+     // the syntax worker wakes us through the same pipe as shell commands once it has highlighted something
+     if(!ce_syntax_worker_init(ce_app_wake_main_loop)){
+          ce_log("failed to start syntax worker, highlighting on the main thread\n");
+     }
+
+     draw(&app, true);
 
      // init draw thread
      struct timeval current_draw_time = {};
      uint64_t time_since_last_message = 0;
+     uint64_t last_draw_time = 0;
+     bool shell_command_draw_pending = false;
 
      // main loop
      while(!app.quit){
@@ -1771,22 +2034,34 @@ int main(int argc, char** argv){
                break;
           case -1:
                assert(errno == EINTR);
-          case 0:
                continue;
+          case 0:
+               // shell command output that came in over our frame budget still needs to be drawn
+               if(!shell_command_draw_pending) continue;
+               break;
           }
 
+          uint64_t frame_start = ce_perf_now_usec();
           bool check_stdin = false;
 
           if(poll_rc < 0 || input_fds[0].revents != 0){
                check_stdin = true;
           }
 
+          bool shell_command_ready = shell_command_draw_pending;
+          bool redraw_all = false;
+
           if(input_fds[1].revents != 0){
+               shell_command_ready = true;
                char buffer[BUFSIZ];
                int rc;
                do{
                     rc = read(g_shell_command_ready_fds[0], buffer, BUFSIZ);
                }while(rc == -1 && errno == EINTR);
+
+               // let the shell command thread wake us up again
+               atomic_store(&g_shell_command_wakeup_pending, false);
+
                if(rc < 0){
                     ce_log("failed to read from shell command ready fd: '%s'\n", strerror(errno));
                     errno = 0;
@@ -1798,6 +2073,7 @@ int main(int argc, char** argv){
                time_since_last_message = time_between(app.message_time, current_draw_time);
                if(time_since_last_message > app.config_options.message_display_time_usec){
                     app.message_mode = false;
+                    redraw_all = true;
                }
           }
 
@@ -1823,7 +2099,28 @@ int main(int argc, char** argv){
 #endif
 
           // handle input from the user
+          uint64_t handle_key_start = ce_perf_now_usec();
           app_handle_key(&app, view, key);
+          if(key != ERR) ce_perf_record_since(&app.perf, CE_PERF_PHASE_HANDLE_KEY, handle_key_start);
+
+          // any key can change modes, overlays or the layout, so repaint everything
+          if(key != ERR) redraw_all = true;
+
+          // nothing happened on this wakeup
+          if(!redraw_all && !shell_command_ready) continue;
+
+          // only redraw for shell command output as often as the frame budget allows, keys always redraw right away
+          if(!redraw_all){
+               int64_t redraw_fps = app.config_options.shell_command_redraw_fps;
+               if(redraw_fps <= 0) redraw_fps = APP_DEFAULT_SHELL_COMMAND_REDRAW_FPS;
+               if((frame_start - last_draw_time) < (uint64_t)(1000000 / redraw_fps)){
+                    shell_command_draw_pending = true;
+                    continue;
+               }
+          }
+
+          shell_command_draw_pending = false;
+          last_draw_time = frame_start;
 
           // update refs to view and tab_layout
           tab_layout = app.tab_list_layout->tab_list.current;
@@ -1848,31 +2145,38 @@ int main(int argc, char** argv){
                if(app.input_complete_func) input_view_overlay(&app.input_view, view);
           }
 
-          // update any list buffers if they are in view
-          if(ce_layout_buffer_in_view(tab_layout, app.buffer_list_buffer)){
-               build_buffer_list(app.buffer_list_buffer, app.buffer_node_head);
-          }
+          // update any list buffers if they are in view, rebuilding them bumps their version which forces a repaint,
+          // so only do it when a key could have changed what they list
+          if(redraw_all){
+               if(ce_layout_buffer_in_view(tab_layout, app.buffer_list_buffer)){
+                    build_buffer_list(app.buffer_list_buffer, app.buffer_node_head);
+               }
 
-          if(ce_layout_buffer_in_view(tab_layout, app.bind_list_buffer)){
-               build_bind_list(app.bind_list_buffer, &app.key_binds);
-          }
+               if(ce_layout_buffer_in_view(tab_layout, app.bind_list_buffer)){
+                    build_bind_list(app.bind_list_buffer, &app.key_binds);
+               }
 
-          if(ce_layout_buffer_in_view(tab_layout, app.yank_list_buffer)){
-               build_yank_list(app.yank_list_buffer, app.vim.yanks);
-          }
+               if(ce_layout_buffer_in_view(tab_layout, app.yank_list_buffer)){
+                    build_yank_list(app.yank_list_buffer, app.vim.yanks);
+               }
 
-          if(ce_layout_buffer_in_view(tab_layout, app.macro_list_buffer)){
-               build_macro_list(app.macro_list_buffer, &app.macros);
-          }
+               if(ce_layout_buffer_in_view(tab_layout, app.macro_list_buffer)){
+                    build_macro_list(app.macro_list_buffer, &app.macros);
+               }
 
-          if(view && ce_layout_buffer_in_view(tab_layout, app.mark_list_buffer)){
-               CeAppBufferData_t* buffer_data = view->buffer->app_data;
-               build_mark_list(app.mark_list_buffer, &buffer_data->vim);
-          }
+               if(view && ce_layout_buffer_in_view(tab_layout, app.mark_list_buffer)){
+                    CeAppBufferData_t* buffer_data = view->buffer->app_data;
+                    build_mark_list(app.mark_list_buffer, &buffer_data->vim);
+               }
 
-          if(view && ce_layout_buffer_in_view(tab_layout, app.jump_list_buffer)){
-               CeAppViewData_t* view_data = view->user_data;
-               build_jump_list(app.jump_list_buffer, &view_data->jump_list);
+               if(view && ce_layout_buffer_in_view(tab_layout, app.jump_list_buffer)){
+                    CeAppViewData_t* view_data = view->user_data;
+                    build_jump_list(app.jump_list_buffer, &view_data->jump_list);
+               }
+
+               if(ce_layout_buffer_in_view(tab_layout, app.perf_list_buffer)){
+                    build_perf_list(app.perf_list_buffer, &app.perf);
+               }
           }
 
           if(view){
@@ -1891,7 +2195,9 @@ int main(int argc, char** argv){
                }
           }
 
-          draw(&app);
+          // only frames that reach the terminal count, skipped draws would drag the percentiles down
+          if(draw(&app, redraw_all)) ce_perf_record_since(&app.perf, CE_PERF_PHASE_FRAME, frame_start);
+          if(key != ERR) ce_perf_record_since(&app.perf, CE_PERF_PHASE_KEY_LATENCY, handle_key_start);
      }
 
      // cleanup
@@ -1903,13 +2209,7 @@ int main(int argc, char** argv){
      ce_macros_free(&app.macros);
      ce_complete_free(&app.input_complete);
 
-     CeKeyBinds_t* binds = &app.key_binds;
-     for(int64_t i = 0; i < binds->count; ++i){
-          ce_command_free(&binds->binds[i].command);
-          if(!binds->binds[i].key_count) continue;
-          free(binds->binds[i].keys);
-     }
-     free(binds->binds);
+     ce_key_binds_free(&app.key_binds);
 
      free(app.command_entries);
 
@@ -1920,8 +2220,11 @@ int main(int argc, char** argv){
 
      ce_app_clear_filepath_cache(&app);
 
+     ce_syntax_worker_free();
      ce_buffer_node_free(&app.buffer_node_head);
+     ce_syntax_languages_free();
 
+     ce_draw_free();
      endwin();
      return 0;
 }
@@ -360,6 +360,321 @@ TEST(buffer_remove_string_end_of_line_to_beginning_of_line){
      EXPECT(strcmp(buffer.lines[0], "if(a){}") == 0);
 }
 
+TEST(buffer_version_changes_on_edit){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, g_multiline_string, g_name);
+
+     int64_t version = buffer.version;
+     ce_buffer_get_rune(&buffer, (CePoint_t){3, 1});
+     EXPECT(buffer.version == version);
+
+     EXPECT(ce_buffer_insert_string(&buffer, "TACOS", (CePoint_t){3, 1}));
+     EXPECT(buffer.version > version);
+
+     version = buffer.version;
+     EXPECT(ce_buffer_remove_string(&buffer, (CePoint_t){3, 1}, 5));
+     EXPECT(buffer.version > version);
+
+     version = buffer.version;
+     ce_buffer_free(&buffer);
+     EXPECT(buffer.version > version);
+}
+
+TEST(buffer_edit_invalidates_lexer_states_after_line){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, g_multiline_string, g_name);
+     EXPECT(buffer.lexer_state_cache.valid_count == 0);
+
+     buffer.lexer_state_cache.valid_count = 3;
+     EXPECT(ce_buffer_insert_string(&buffer, "TACOS", (CePoint_t){3, 1}));
+     EXPECT(buffer.lexer_state_cache.valid_count == 2);
+
+     EXPECT(ce_buffer_remove_lines(&buffer, 0, 1));
+     EXPECT(buffer.lexer_state_cache.valid_count == 1);
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(buffer_edit_lowers_unchanged_line_count){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, g_multiline_string, g_name);
+     EXPECT(buffer.unchanged_line_count == 0);
+
+     buffer.unchanged_line_count = buffer.line_count;
+     EXPECT(ce_buffer_insert_string(&buffer, "TACOS", (CePoint_t){3, 2}));
+     EXPECT(buffer.unchanged_line_count == 2);
+
+     EXPECT(ce_buffer_remove_string(&buffer, (CePoint_t){0, 1}, 1));
+     EXPECT(buffer.unchanged_line_count == 1);
+
+     EXPECT(ce_buffer_insert_string(&buffer, "TACOS", (CePoint_t){0, 2}));
+     EXPECT(buffer.unchanged_line_count == 1);
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(buffer_find_bracket_skips_strings_and_comments){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "if(a){\n     b(\")\", ')');\n     /* }\n     ) */ c();\n}", g_name);
+
+     CePoint_t match = {};
+     EXPECT(ce_buffer_find_bracket_backward(&buffer, (CePoint_t){5, 3}, true, '{', '}', 0, &match));
+     EXPECT(match.x == 5 && match.y == 0);
+     EXPECT(ce_buffer_find_bracket_forward(&buffer, (CePoint_t){5, 0}, false, '{', '}', 0, &match));
+     EXPECT(match.x == 0 && match.y == 4);
+     EXPECT(ce_buffer_find_bracket_forward(&buffer, (CePoint_t){6, 1}, false, '(', ')', 0, &match));
+     EXPECT(match.x == 15 && match.y == 1);
+
+     // closing the block comment early exposes the brackets after it
+     EXPECT(ce_buffer_insert_string(&buffer, " */", (CePoint_t){7, 2}));
+     EXPECT(ce_buffer_find_bracket_forward(&buffer, (CePoint_t){5, 0}, false, '{', '}', 0, &match));
+     EXPECT(match.x == 11 && match.y == 2);
+
+     EXPECT(ce_buffer_remove_lines(&buffer, 2, 1));
+     EXPECT(ce_buffer_find_bracket_forward(&buffer, (CePoint_t){5, 0}, false, '{', '}', 0, &match));
+     EXPECT(match.x == 0 && match.y == 3);
+     EXPECT(ce_buffer_find_bracket_backward(&buffer, (CePoint_t){0, 3}, false, '{', '}', 0, &match));
+     EXPECT(match.x == 5 && match.y == 0);
+     EXPECT(!ce_buffer_find_bracket_backward(&buffer, (CePoint_t){0, 3}, false, '{', '}', 1, &match));
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(buffer_undo_and_redo_long_chain){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "", g_name);
+
+     // as long as a replayed macro might chain together
+     const int64_t change_count = 20000;
+     CePoint_t cursor = {0, 0};
+     for(int64_t i = 0; i < change_count; i++){
+          CePoint_t cursor_after = {cursor.x + 1, 0};
+          EXPECT(ce_buffer_insert_string_change(&buffer, strdup("a"), cursor, &cursor, cursor_after, i > 0));
+     }
+     EXPECT(strlen(buffer.lines[0]) == (size_t)(change_count));
+
+     EXPECT(ce_buffer_undo(&buffer, &cursor));
+     EXPECT(buffer.lines[0][0] == 0);
+     EXPECT(cursor.x == 0);
+
+     EXPECT(ce_buffer_redo(&buffer, &cursor));
+     EXPECT(strlen(buffer.lines[0]) == (size_t)(change_count));
+     EXPECT(cursor.x == change_count);
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(buffer_insert_string_change_at_points){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "abc\nde", g_name);
+
+     CePoint_t points[4] = {{0, 0}, {2, 0}, {3, 0}, {1, 1}};
+     EXPECT(ce_buffer_insert_string_change_at_points(&buffer, "xy", points, 4, false));
+     EXPECT(strcmp(buffer.lines[0], "xyabxycxy") == 0);
+     EXPECT(strcmp(buffer.lines[1], "dxye") == 0);
+     EXPECT(ce_points_equal(points[0], (CePoint_t){2, 0}));
+     EXPECT(ce_points_equal(points[1], (CePoint_t){6, 0}));
+     EXPECT(ce_points_equal(points[2], (CePoint_t){9, 0}));
+     EXPECT(ce_points_equal(points[3], (CePoint_t){3, 1}));
+
+     // all of the insertions are recorded as one change sharing the string
+     EXPECT(buffer.change_node && buffer.change_node->prev && !buffer.change_node->prev->prev);
+     EXPECT(buffer.change_node->change.point_count == 4);
+     EXPECT(strcmp(buffer.change_node->change.string, "xy") == 0);
+
+     // every insertion comes back out in a single undo
+     CePoint_t cursor = {};
+     EXPECT(ce_buffer_undo(&buffer, &cursor));
+     EXPECT(strcmp(buffer.lines[0], "abc") == 0);
+     EXPECT(strcmp(buffer.lines[1], "de") == 0);
+
+     EXPECT(ce_buffer_redo(&buffer, &cursor));
+     EXPECT(strcmp(buffer.lines[0], "xyabxycxy") == 0);
+     EXPECT(strcmp(buffer.lines[1], "dxye") == 0);
+
+     // unsorted points are rejected without touching the buffer
+     CePoint_t unsorted[2] = {{1, 1}, {0, 0}};
+     EXPECT(!ce_buffer_insert_string_change_at_points(&buffer, "z", unsorted, 2, false));
+     EXPECT(strcmp(buffer.lines[0], "xyabxycxy") == 0);
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(buffer_remove_string_change_at_points){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "ab\u00e9cd\nefg", g_name);
+
+     CePoint_t points[4] = {{0, 0}, {2, 0}, {4, 0}, {1, 1}};
+     EXPECT(ce_buffer_remove_string_change_at_points(&buffer, points, 4, 1, false));
+     EXPECT(strcmp(buffer.lines[0], "bc") == 0);
+     EXPECT(strcmp(buffer.lines[1], "eg") == 0);
+     EXPECT(ce_points_equal(points[0], (CePoint_t){0, 0}));
+     EXPECT(ce_points_equal(points[1], (CePoint_t){1, 0}));
+     EXPECT(ce_points_equal(points[2], (CePoint_t){2, 0}));
+     EXPECT(ce_points_equal(points[3], (CePoint_t){1, 1}));
+     EXPECT(buffer.change_node->change.point_count == 4);
+     EXPECT(strcmp(buffer.change_node->change.string, "a\u00e9df") == 0);
+
+     // a point past the edits shifts back over every removal before it on its line
+     CePoint_t moved = ce_move_point_based_on_buffer_changes(&buffer, buffer.change_node->prev, (CePoint_t){5, 0});
+     EXPECT(ce_points_equal(moved, (CePoint_t){2, 0}));
+
+     CePoint_t cursor = {};
+     EXPECT(ce_buffer_undo(&buffer, &cursor));
+     EXPECT(strcmp(buffer.lines[0], "ab\u00e9cd") == 0);
+     EXPECT(strcmp(buffer.lines[1], "efg") == 0);
+
+     EXPECT(ce_buffer_redo(&buffer, &cursor));
+     EXPECT(strcmp(buffer.lines[0], "bc") == 0);
+     EXPECT(strcmp(buffer.lines[1], "eg") == 0);
+
+     // overlapping removals and removals off the end of a line are rejected without touching the buffer
+     CePoint_t overlapping[2] = {{0, 0}, {1, 0}};
+     EXPECT(!ce_buffer_remove_string_change_at_points(&buffer, overlapping, 2, 2, false));
+     CePoint_t past_end[1] = {{2, 0}};
+     EXPECT(!ce_buffer_remove_string_change_at_points(&buffer, past_end, 1, 1, false));
+     EXPECT(strcmp(buffer.lines[0], "bc") == 0);
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(buffer_replace_lines_change){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "first\nabc\n\ndef\nlast", g_name);
+
+     char** new_lines = malloc(3 * sizeof(*new_lines));
+     new_lines[0] = strdup("ac");
+     new_lines[1] = strdup("x");
+     new_lines[2] = strdup("");
+     CePoint_t cursor = {1, 1};
+     EXPECT(ce_buffer_replace_lines_change(&buffer, 1, 3, new_lines, 3, &cursor, (CePoint_t){0, 3}, false));
+     free(new_lines);
+     EXPECT(buffer.line_count == 5);
+     EXPECT(strcmp(buffer.lines[0], "first") == 0);
+     EXPECT(strcmp(buffer.lines[1], "ac") == 0);
+     EXPECT(strcmp(buffer.lines[2], "x") == 0);
+     EXPECT(strcmp(buffer.lines[3], "") == 0);
+     EXPECT(strcmp(buffer.lines[4], "last") == 0);
+     EXPECT(ce_points_equal(cursor, (CePoint_t){0, 3}));
+
+     EXPECT(ce_buffer_undo(&buffer, &cursor));
+     EXPECT(buffer.line_count == 5);
+     EXPECT(strcmp(buffer.lines[1], "abc") == 0);
+     EXPECT(strcmp(buffer.lines[2], "") == 0);
+     EXPECT(strcmp(buffer.lines[3], "def") == 0);
+     EXPECT(strcmp(buffer.lines[4], "last") == 0);
+     EXPECT(ce_points_equal(cursor, (CePoint_t){1, 1}));
+
+     EXPECT(ce_buffer_redo(&buffer, &cursor));
+     EXPECT(strcmp(buffer.lines[1], "ac") == 0);
+     EXPECT(strcmp(buffer.lines[3], "") == 0);
+     EXPECT(ce_points_equal(cursor, (CePoint_t){0, 3}));
+
+
+     // growing and shrinking the range moves the lines after it
+     new_lines = malloc(4 * sizeof(*new_lines));
+     new_lines[0] = strdup("1");
+     new_lines[1] = strdup("2");
+     new_lines[2] = strdup("3");
+     new_lines[3] = strdup("4");
+     EXPECT(ce_buffer_replace_lines_change(&buffer, 1, 2, new_lines, 4, &cursor, (CePoint_t){0, 1}, false));
+     free(new_lines);
+     EXPECT(buffer.line_count == 7);
+     EXPECT(strcmp(buffer.lines[4], "4") == 0);
+     EXPECT(strcmp(buffer.lines[5], "") == 0);
+     EXPECT(strcmp(buffer.lines[6], "last") == 0);
+
+     new_lines = malloc(sizeof(*new_lines));
+     new_lines[0] = strdup("one");
+     EXPECT(ce_buffer_replace_lines_change(&buffer, 0, 6, new_lines, 1, &cursor, (CePoint_t){0, 0}, false));
+     free(new_lines);
+     EXPECT(buffer.line_count == 2);
+     EXPECT(strcmp(buffer.lines[0], "one") == 0);
+     EXPECT(strcmp(buffer.lines[1], "last") == 0);
+
+     EXPECT(ce_buffer_undo(&buffer, &cursor));
+     EXPECT(ce_buffer_undo(&buffer, &cursor));
+     EXPECT(buffer.line_count == 5);
+     EXPECT(strcmp(buffer.lines[1], "ac") == 0);
+     EXPECT(strcmp(buffer.lines[2], "x") == 0);
+     EXPECT(strcmp(buffer.lines[4], "last") == 0);
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(buffer_sort_lines_change){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "first\nb 10\nA 9\nb 10\na -3\nlast", g_name);
+
+     CeSortOptions_t options = {};
+     CePoint_t cursor = {2, 3};
+     EXPECT(ce_buffer_sort_lines_change(&buffer, 1, 4, &options, &cursor, (CePoint_t){0, 1}, false));
+     EXPECT(buffer.line_count == 6);
+     EXPECT(strcmp(buffer.lines[1], "A 9") == 0);
+     EXPECT(strcmp(buffer.lines[2], "a -3") == 0);
+     EXPECT(strcmp(buffer.lines[3], "b 10") == 0);
+     EXPECT(strcmp(buffer.lines[4], "b 10") == 0);
+     EXPECT(strcmp(buffer.lines[5], "last") == 0);
+     EXPECT(ce_points_equal(cursor, (CePoint_t){0, 1}));
+
+     // numeric sorting on the second column, dropping repeats
+     options.numeric = true;
+     options.unique = true;
+     options.reverse = true;
+     options.key_column = 2;
+     EXPECT(ce_buffer_sort_lines_change(&buffer, 1, 4, &options, &cursor, (CePoint_t){0, 1}, false));
+     EXPECT(buffer.line_count == 5);
+     EXPECT(strcmp(buffer.lines[1], "b 10") == 0);
+     EXPECT(strcmp(buffer.lines[2], "A 9") == 0);
+     EXPECT(strcmp(buffer.lines[3], "a -3") == 0);
+     EXPECT(strcmp(buffer.lines[4], "last") == 0);
+
+     // each sort undoes in one step
+     EXPECT(ce_buffer_undo(&buffer, &cursor));
+     EXPECT(buffer.line_count == 6);
+     EXPECT(strcmp(buffer.lines[1], "A 9") == 0);
+     EXPECT(strcmp(buffer.lines[4], "b 10") == 0);
+     EXPECT(ce_buffer_undo(&buffer, &cursor));
+     EXPECT(strcmp(buffer.lines[1], "b 10") == 0);
+     EXPECT(strcmp(buffer.lines[2], "A 9") == 0);
+     EXPECT(strcmp(buffer.lines[4], "a -3") == 0);
+     EXPECT(strcmp(buffer.lines[5], "last") == 0);
+     EXPECT(ce_points_equal(cursor, (CePoint_t){2, 3}));
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(buffer_sort_lines_change_unique_on_key){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "x 2\ny 1\nx 2\nz 1", g_name);
+
+     // lines with equal keys count as repeats even when the lines themselves differ
+     CeSortOptions_t options = {};
+     options.numeric = true;
+     options.unique = true;
+     options.key_column = 2;
+     CePoint_t cursor = {};
+     EXPECT(ce_buffer_sort_lines_change(&buffer, 0, 4, &options, &cursor, (CePoint_t){0, 0}, false));
+     EXPECT(buffer.line_count == 2);
+     EXPECT(strcmp(buffer.lines[0], "y 1") == 0);
+     EXPECT(strcmp(buffer.lines[1], "x 2") == 0);
+
+     ce_buffer_load_string(&buffer, "b=1\na=2\nc=1\nno key", g_name);
+     regex_t regex;
+     EXPECT(regcomp(&regex, "=", REG_EXTENDED) == 0);
+     options = (CeSortOptions_t){};
+     options.unique = true;
+     options.key_regex = &regex;
+     EXPECT(ce_buffer_sort_lines_change(&buffer, 0, 4, &options, &cursor, (CePoint_t){0, 0}, false));
+     regfree(&regex);
+     EXPECT(buffer.line_count == 3);
+     EXPECT(strcmp(buffer.lines[0], "no key") == 0);
+     EXPECT(strcmp(buffer.lines[1], "b=1") == 0);
+     EXPECT(strcmp(buffer.lines[2], "a=2") == 0);
+
+     ce_buffer_free(&buffer);
+}
+
 TEST(buffer_dupe_string_portion_of_line){
      CeBuffer_t buffer = {};
      ce_buffer_load_string(&buffer, g_multiline_string, g_name);
@@ -395,6 +710,28 @@ TEST(buffer_dupe_string_entire_line_multiple_plus_newline){
      EXPECT(strcmp(dupe, "0123456789\nabcdefghij\n") == 0);
 }
 
+TEST(buffer_dupe_shared_string){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, g_multiline_string, g_name);
+     char* dupe = ce_buffer_dupe_shared_string(&buffer, (CePoint_t){3, 0}, 10);
+     EXPECT(strcmp(dupe, "3456789\nab") == 0);
+
+     // the undo history holds its own reference
+     CeBufferChange_t change = {};
+     change.insertion = true;
+     change.shared_string = true;
+     change.string = ce_shared_string_acquire(dupe);
+     change.location = (CePoint_t){0, 0};
+     change.cursor_before = (CePoint_t){0, 0};
+     change.cursor_after = (CePoint_t){0, 0};
+     EXPECT(ce_buffer_change(&buffer, &change));
+
+     ce_buffer_free(&buffer);
+     EXPECT(strcmp(dupe, "3456789\nab") == 0);
+     ce_shared_string_release(dupe);
+     ce_shared_string_release(NULL);
+}
+
 TEST(buffer_dupe_string_across_line){
      CeBuffer_t buffer = {};
      ce_buffer_load_string(&buffer, g_multiline_string, g_name);
@@ -581,6 +918,29 @@ TEST(util_visible_index_to_string_index){
      EXPECT(ce_util_visible_index_to_string_index(tabbed_string, 33, tab_width) == 12);
 }
 
+TEST(rune_array_append_set_and_clear){
+     CeRuneArray_t array = {};
+     for(CeRune_t rune = 1; rune <= 100; rune++){
+          EXPECT(ce_rune_array_append(&array, rune));
+     }
+     EXPECT(array.count == 100);
+     EXPECT(array.runes[0] == 1 && array.runes[99] == 100);
+     EXPECT(array.runes[100] == 0);
+
+     // setting from the array's own runes copies before letting go of them
+     EXPECT(ce_rune_array_set(&array, array.runes + 98));
+     EXPECT(array.count == 2);
+     EXPECT(array.runes[0] == 99 && array.runes[1] == 100 && array.runes[2] == 0);
+
+     ce_rune_array_clear(&array);
+     EXPECT(array.count == 0 && array.runes[0] == 0);
+     EXPECT(ce_rune_array_append(&array, 'q'));
+     EXPECT(array.count == 1 && array.runes[0] == 'q' && array.runes[1] == 0);
+
+     ce_rune_array_free(&array);
+     EXPECT(array.runes == NULL && array.count == 0);
+}
+
 int main()
 {
      g_ce_log_buffer = malloc(sizeof(*g_ce_log_buffer));
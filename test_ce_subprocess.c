@@ -0,0 +1,160 @@
+#include "test.h"
+#include "ce_subprocess.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define LARGE_LINE_COUNT 200000
+
+static char** alloc_numbered_lines(int64_t line_count){
+     char** lines = malloc(line_count * sizeof(*lines));
+     for(int64_t i = 0; i < line_count; i++){
+          char line[32];
+          // count down so sort has to reorder everything
+          snprintf(line, sizeof(line), "%08ld", (long)(line_count - i));
+          lines[i] = strdup(line);
+     }
+     return lines;
+}
+
+static void free_lines(char** lines, int64_t line_count){
+     for(int64_t i = 0; i < line_count; i++) free(lines[i]);
+     free(lines);
+}
+
+static bool stop_after_calls(void* user_data){
+     int* calls_left = user_data;
+     if(*calls_left <= 0) return true;
+     (*calls_left)--;
+     return false;
+}
+
+TEST(filter_lines_sort_streams_large_input){
+     char** input_lines = alloc_numbered_lines(LARGE_LINE_COUNT);
+     char** output_lines = NULL;
+     int64_t output_line_count = 0;
+
+     CeSubprocess_t subprocess;
+     EXPECT(ce_subprocess_open(&subprocess, "sort"));
+     EXPECT(ce_subprocess_filter_lines(&subprocess, input_lines, LARGE_LINE_COUNT, &output_lines, &output_line_count,
+                                       NULL, NULL));
+     int status = ce_subprocess_close(&subprocess);
+     EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+     EXPECT(output_line_count == LARGE_LINE_COUNT);
+     if(output_line_count == LARGE_LINE_COUNT){
+          EXPECT(strcmp(output_lines[0], "00000001") == 0);
+          EXPECT(strcmp(output_lines[LARGE_LINE_COUNT - 1], input_lines[0]) == 0);
+          bool ordered = true;
+          for(int64_t i = 1; i < output_line_count; i++){
+               if(strcmp(output_lines[i - 1], output_lines[i]) > 0) ordered = false;
+          }
+          EXPECT(ordered);
+     }
+
+     free_lines(output_lines, output_line_count);
+     free_lines(input_lines, LARGE_LINE_COUNT);
+}
+
+TEST(filter_lines_head_closes_stdin_early){
+     char** input_lines = alloc_numbered_lines(LARGE_LINE_COUNT);
+     char** output_lines = NULL;
+     int64_t output_line_count = 0;
+
+     // head exits after the first line, so the rest of the writes hit EPIPE
+     CeSubprocess_t subprocess;
+     EXPECT(ce_subprocess_open(&subprocess, "head -1"));
+     EXPECT(ce_subprocess_filter_lines(&subprocess, input_lines, LARGE_LINE_COUNT, &output_lines, &output_line_count,
+                                       NULL, NULL));
+     int status = ce_subprocess_close(&subprocess);
+     EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+     EXPECT(output_line_count == 1);
+     if(output_line_count == 1) EXPECT(strcmp(output_lines[0], input_lines[0]) == 0);
+
+     free_lines(output_lines, output_line_count);
+     free_lines(input_lines, LARGE_LINE_COUNT);
+}
+
+TEST(filter_lines_writes_all_input_after_stdout_closes){
+     char** input_lines = alloc_numbered_lines(LARGE_LINE_COUNT);
+     char** output_lines = NULL;
+     int64_t output_line_count = 0;
+
+     char path[] = "/tmp/test_ce_subprocess_XXXXXX";
+     int fd = mkstemp(path);
+     EXPECT(fd >= 0);
+     close(fd);
+
+     // stderr shares the stdout pipe, the shell moving both to the file closes it before cat reads anything
+     char command[128];
+     snprintf(command, sizeof(command), "exec > %s 2>&1; cat", path);
+     CeSubprocess_t subprocess;
+     EXPECT(ce_subprocess_open(&subprocess, command));
+     EXPECT(ce_subprocess_filter_lines(&subprocess, input_lines, LARGE_LINE_COUNT, &output_lines, &output_line_count,
+                                       NULL, NULL));
+     int status = ce_subprocess_close(&subprocess);
+     EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+     EXPECT(output_line_count == 0);
+
+     FILE* file = fopen(path, "r");
+     EXPECT(file);
+     int64_t line_count = 0;
+     bool matches = true;
+     char line[32];
+     while(file && fgets(line, sizeof(line), file)){
+          line[strcspn(line, "\n")] = 0;
+          if(line_count >= LARGE_LINE_COUNT || strcmp(line, input_lines[line_count]) != 0) matches = false;
+          line_count++;
+     }
+     if(file) fclose(file);
+     unlink(path);
+
+     EXPECT(line_count == LARGE_LINE_COUNT);
+     EXPECT(matches);
+
+     free_lines(output_lines, output_line_count);
+     free_lines(input_lines, LARGE_LINE_COUNT);
+}
+
+TEST(filter_lines_keeps_partial_last_line){
+     char** output_lines = NULL;
+     int64_t output_line_count = 0;
+
+     CeSubprocess_t subprocess;
+     EXPECT(ce_subprocess_open(&subprocess, "printf 'a\\nb'"));
+     EXPECT(ce_subprocess_filter_lines(&subprocess, NULL, 0, &output_lines, &output_line_count, NULL, NULL));
+     ce_subprocess_close(&subprocess);
+
+     EXPECT(output_line_count == 2);
+     if(output_line_count == 2){
+          EXPECT(strcmp(output_lines[0], "a") == 0);
+          EXPECT(strcmp(output_lines[1], "b") == 0);
+     }
+
+     free_lines(output_lines, output_line_count);
+}
+
+TEST(filter_lines_stops_when_asked){
+     char** output_lines = NULL;
+     int64_t output_line_count = 0;
+     int calls_left = 3;
+
+     CeSubprocess_t subprocess;
+     EXPECT(ce_subprocess_open(&subprocess, "sleep 1000"));
+     EXPECT(!ce_subprocess_filter_lines(&subprocess, NULL, 0, &output_lines, &output_line_count,
+                                        stop_after_calls, &calls_left));
+     int status = ce_subprocess_close(&subprocess);
+     EXPECT(WIFSIGNALED(status));
+
+     free_lines(output_lines, output_line_count);
+}
+
+int main()
+{
+     // the editor ignores SIGPIPE so a filter that exits early can't take it down, do the same here
+     signal(SIGPIPE, SIG_IGN);
+     RUN_TESTS();
+}
@@ -0,0 +1,98 @@
+#include "test.h"
+#include "ce_syntax.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+FILE* g_ce_log = NULL;
+CeBuffer_t* g_ce_log_buffer = NULL;
+
+// highlighting a view that starts on the last line lexes every line above it
+static void highlight_to_last_line(CeBuffer_t* buffer){
+     CeView_t view = {};
+     view.buffer = buffer;
+     view.rect = (CeRect_t){0, 80, 0, 0};
+     view.scroll.y = buffer->line_count - 1;
+     view.cursor = (CePoint_t){-1, -1};
+
+     CeSyntaxDef_t syntax_defs[CE_SYNTAX_COLOR_COUNT] = {};
+     CeRangeList_t range_list = {};
+     CeDrawColorList_t draw_color_list = {};
+     ce_syntax_highlight_c(&view, &range_list, &draw_color_list, syntax_defs, NULL);
+     ce_draw_color_list_free(&draw_color_list);
+     ce_range_list_free(&range_list);
+}
+
+TEST(lexer_states_recomputed_after_edit_inside_comment){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "a;\n/* start\ninside\nend */\nb;\nc;", "test.c");
+
+     CeLexLineFunc_t* lex_line = NULL;
+     void* lex_data = NULL;
+     EXPECT(ce_syntax_get_lexer(ce_syntax_highlight_c, NULL, &lex_line, &lex_data));
+
+     highlight_to_last_line(&buffer);
+     CeLexerStateCache_t* cache = &buffer.lexer_state_cache;
+     EXPECT(cache->lex_line == lex_line);
+     EXPECT(cache->valid_count == 6);
+     if(cache->valid_count == 6){
+          EXPECT(!cache->states[1]);
+          EXPECT(cache->states[2] && cache->states[3]);
+          EXPECT(!cache->states[4] && !cache->states[5]);
+     }
+
+     // closing the comment early only drops the states of the lines after the edit
+     EXPECT(ce_buffer_insert_string(&buffer, "*/ ", (CePoint_t){0, 2}));
+     EXPECT(cache->valid_count == 3);
+
+     highlight_to_last_line(&buffer);
+     EXPECT(cache->valid_count == 6);
+     if(cache->valid_count == 6){
+          EXPECT(cache->states[2]);
+          EXPECT(!cache->states[3]);
+          EXPECT(!cache->states[4] && !cache->states[5]);
+     }
+
+     // reopening it carries the comment down again
+     EXPECT(ce_buffer_remove_string(&buffer, (CePoint_t){0, 2}, 3));
+     EXPECT(cache->valid_count == 3);
+
+     highlight_to_last_line(&buffer);
+     EXPECT(cache->valid_count == 6);
+     if(cache->valid_count == 6) EXPECT(cache->states[3]);
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(range_list_insert_sorted_rejects_overlaps){
+     CeRangeList_t list = {};
+     EXPECT(ce_range_list_insert_sorted(&list, (CePoint_t){5, 1}, (CePoint_t){8, 1}));
+     EXPECT(ce_range_list_insert_sorted(&list, (CePoint_t){0, 0}, (CePoint_t){3, 0}));
+     EXPECT(ce_range_list_insert_sorted(&list, (CePoint_t){0, 3}, (CePoint_t){2, 4}));
+     EXPECT(ce_range_list_insert_sorted(&list, (CePoint_t){0, 1}, (CePoint_t){4, 1}));
+
+     // overlapping the range before, the range after or containing one
+     EXPECT(!ce_range_list_insert_sorted(&list, (CePoint_t){3, 0}, (CePoint_t){6, 0}));
+     EXPECT(!ce_range_list_insert_sorted(&list, (CePoint_t){6, 0}, (CePoint_t){0, 1}));
+     EXPECT(!ce_range_list_insert_sorted(&list, (CePoint_t){0, 2}, (CePoint_t){9, 5}));
+     EXPECT(!ce_range_list_insert_sorted(&list, (CePoint_t){6, 1}, (CePoint_t){7, 1}));
+     EXPECT(list.node_count == 4);
+
+     CePoint_t expected_starts[] = {{0, 0}, {0, 1}, {5, 1}, {0, 3}};
+     int64_t count = 0;
+     for(CeRangeNode_t* itr = list.head; itr; itr = itr->next){
+          if(count < 4) EXPECT(ce_points_equal(itr->range.start, expected_starts[count]));
+          count++;
+     }
+     EXPECT(count == 4);
+     EXPECT(list.tail && ce_points_equal(list.tail->range.start, expected_starts[3]));
+
+     ce_range_list_free(&list);
+}
+
+int main()
+{
+     setlocale(LC_ALL, "");
+     RUN_TESTS();
+}
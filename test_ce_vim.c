@@ -0,0 +1,130 @@
+#include "test.h"
+#include "ce_vim.h"
+#include "ce_app.h"
+#include "ce_commands.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+FILE* g_ce_log = NULL;
+CeBuffer_t* g_ce_log_buffer = NULL;
+
+static void run_keys(CeBuffer_t* buffer, CePoint_t cursor, const char* keys){
+     CeView_t view = {};
+     view.buffer = buffer;
+     view.rect = (CeRect_t){0, 120, 0, 40};
+     view.cursor = cursor;
+
+     CeVim_t vim = {};
+     ce_vim_init(&vim);
+
+     CeConfigOptions_t config_options = {};
+     config_options.tab_width = 5;
+     config_options.insert_spaces_on_tab = true;
+
+     CeVimVisualData_t visual = {};
+     CeVimBufferData_t buffer_data = {};
+     for(const char* key = keys; *key; key++){
+          ce_vim_handle_key(&vim, &view, &view.cursor, &visual, *key, &buffer_data, &config_options, true);
+     }
+
+     ce_vim_free(&vim);
+}
+
+TEST(find_pair_inside){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "a(xy)b", "test.c");
+
+     CeRange_t range = ce_vim_find_pair(&buffer, (CePoint_t){1, 0}, '(', true, 0);
+     EXPECT(range.start.x == 2 && range.start.y == 0);
+     EXPECT(range.end.x == 3 && range.end.y == 0);
+
+     range = ce_vim_find_pair(&buffer, (CePoint_t){2, 0}, ')', true, 0);
+     EXPECT(range.start.x == 2 && range.end.x == 3);
+
+     range = ce_vim_find_pair(&buffer, (CePoint_t){1, 0}, '(', false, 0);
+     EXPECT(range.start.x == 1 && range.end.x == 4);
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(find_pair_inside_empty){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "a()b", "test.c");
+
+     CeRange_t range = ce_vim_find_pair(&buffer, (CePoint_t){1, 0}, '(', true, 0);
+     EXPECT(range.start.x < 0);
+
+     range = ce_vim_find_pair(&buffer, (CePoint_t){2, 0}, ')', true, 0);
+     EXPECT(range.start.x < 0);
+
+     range = ce_vim_find_pair(&buffer, (CePoint_t){1, 0}, '(', false, 0);
+     EXPECT(range.start.x == 1 && range.end.x == 2);
+
+     ce_buffer_free(&buffer);
+}
+
+TEST(delete_inside_parens){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "a(xy)b", "test.c");
+     run_keys(&buffer, (CePoint_t){1, 0}, "di(");
+     EXPECT(strcmp(buffer.lines[0], "a()b") == 0);
+     ce_buffer_free(&buffer);
+}
+
+TEST(delete_inside_empty_parens){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "a()b", "test.c");
+     run_keys(&buffer, (CePoint_t){1, 0}, "di(");
+     EXPECT(strcmp(buffer.lines[0], "a()b") == 0);
+
+     run_keys(&buffer, (CePoint_t){2, 0}, "di)");
+     EXPECT(strcmp(buffer.lines[0], "a()b") == 0);
+     ce_buffer_free(&buffer);
+}
+
+static CeCommandStatus_t run_sort_command(CeBuffer_t* buffer, const char* string){
+     CeApp_t* app = calloc(1, sizeof(*app));
+     app->tab_list_layout = ce_layout_tab_list_init(ce_layout_tab_init(buffer, (CeRect_t){0, 120, 0, 40}));
+
+     CeCommandStatus_t status = CE_COMMAND_FAILURE;
+     CeCommand_t command = {};
+     if(ce_command_parse(&command, string)){
+          status = command_vim_sort(&command, app);
+          ce_command_free(&command);
+     }
+
+     ce_layout_free(&app->tab_list_layout);
+     free(app);
+     return status;
+}
+
+TEST(sort_command_regex_key_with_space){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "a key 3\nb key 1\nc key 2", "test.c");
+
+     // the tokenizer splits '/key /' in two, the sort still has to see the whole regex
+     EXPECT(run_sort_command(&buffer, "sort /key /") == CE_COMMAND_SUCCESS);
+     EXPECT(buffer.line_count == 3);
+     if(buffer.line_count == 3){
+          EXPECT(strcmp(buffer.lines[0], "b key 1") == 0);
+          EXPECT(strcmp(buffer.lines[1], "c key 2") == 0);
+          EXPECT(strcmp(buffer.lines[2], "a key 3") == 0);
+     }
+
+     // flags after the regex still apply
+     EXPECT(run_sort_command(&buffer, "sort /y / r") == CE_COMMAND_SUCCESS);
+     if(buffer.line_count == 3){
+          EXPECT(strcmp(buffer.lines[0], "a key 3") == 0);
+          EXPECT(strcmp(buffer.lines[2], "b key 1") == 0);
+     }
+
+     ce_buffer_free(&buffer);
+}
+
+int main()
+{
+     setlocale(LC_ALL, "");
+     RUN_TESTS();
+}